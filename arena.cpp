@@ -0,0 +1,46 @@
+#include <algorithm>
+#include "arena.hpp"
+
+monotonic_arena::~monotonic_arena() {
+	for (auto& c : chunks)
+		::operator delete(c.data);
+}
+
+void* monotonic_arena::grow(size_t bytes, size_t align) {
+	// следующий уже выделенный кусок, если он подходит, иначе новый
+	while (active + 1u < chunks.size()) {
+		++active;
+		head = chunks[active].data;
+		end = head + chunks[active].size;
+		if (bytes + align <= chunks[active].size)
+			return allocate(bytes, align);
+	}
+
+	size_t size = std::max(chunk_size, bytes + align);
+	chunks.push_back({ static_cast<char*>(::operator new(size)), size });
+	active = chunks.size() - 1u;
+	head = chunks[active].data;
+	end = head + size;
+
+	return allocate(bytes, align);
+}
+
+void monotonic_arena::reset() {
+	peak = std::max(peak, used);
+	used = 0u;
+
+	// несколько кусков заменяются одним на весь пик, чтобы шаг умещался без переходов
+	if (chunks.size() > 1u) {
+		size_t total{};
+		for (auto& c : chunks) {
+			total += c.size;
+			::operator delete(c.data);
+		}
+		chunks.clear();
+		chunks.push_back({ static_cast<char*>(::operator new(total)), total });
+	}
+
+	active = 0u;
+	head = chunks.empty() ? nullptr : chunks.front().data;
+	end = chunks.empty() ? nullptr : head + chunks.front().size;
+}
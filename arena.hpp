@@ -0,0 +1,133 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// монотонная арена: выделение сдвигом указателя, освобождение - только reset() целиком.
+// Интегратор делает её текущей на время шага, и временные Vector/Matrix
+// внутри шага берут память из арены вместо кучи
+class monotonic_arena {
+private:
+	struct chunk {
+		char* data;
+		size_t size;
+	};
+
+	std::vector<chunk> chunks;
+	size_t active = 0u;
+	char* head = nullptr;
+	char* end = nullptr;
+	size_t chunk_size;
+	size_t used = 0u;
+	size_t peak = 0u;
+
+	void* grow(size_t bytes, size_t align);
+public:
+	explicit monotonic_arena(size_t chunk_size = 64u * 1024u) noexcept : chunk_size(chunk_size) {};
+	monotonic_arena(const monotonic_arena&) = delete;
+	monotonic_arena& operator=(const monotonic_arena&) = delete;
+	~monotonic_arena();
+
+	void* allocate(size_t bytes, size_t align) {
+		uintptr_t ptr = (uintptr_t(head) + align - 1u) & ~uintptr_t(align - 1u);
+		if (head && ptr + bytes <= uintptr_t(end)) {
+			used += ptr + bytes - uintptr_t(head);
+			head = (char*)(ptr + bytes);
+			return (void*)ptr;
+		}
+		return grow(bytes, align);
+	}
+
+	// всё выделенное с прошлого reset() становится недействительным
+	void reset();
+	size_t bytes_used() const noexcept { return used; };
+	size_t bytes_peak() const noexcept { return peak; };
+
+	// арена, из которой берут память вновь создаваемые Vector/Matrix текущего потока
+	static monotonic_arena*& current() noexcept {
+		thread_local monotonic_arena* arena = nullptr;
+		return arena;
+	}
+};
+
+// делает арену текущей до конца области видимости
+class arena_scope {
+private:
+	monotonic_arena* previous;
+public:
+	explicit arena_scope(monotonic_arena& arena) noexcept : previous(monotonic_arena::current()) {
+		monotonic_arena::current() = &arena;
+	}
+	arena_scope(const arena_scope&) = delete;
+	arena_scope& operator=(const arena_scope&) = delete;
+	~arena_scope() { monotonic_arena::current() = previous; };
+};
+
+// счётчики выделений текущего потока (для тестов и bench)
+struct allocation_stats {
+	uint64_t heap_allocations = 0u;
+	uint64_t heap_bytes = 0u;
+	uint64_t arena_allocations = 0u;
+	uint64_t arena_bytes = 0u;
+};
+
+inline allocation_stats& allocation_counters() noexcept {
+	thread_local allocation_stats stats;
+	return stats;
+}
+
+// аллокатор Vector/Matrix по умолчанию: запоминает текущую арену в момент создания
+// контейнера, без арены работает с кучей. Аллокатор не переносится при копировании
+// и присваивании, поэтому присваивание долгоживущему объекту копирует данные в его память;
+// перемещающий конструктор Vector/Matrix забирает память вместе с аллокатором источника,
+// поэтому объект из арены нельзя перемещением выносить за пределы её области - только присваивать
+template<typename T>
+class arena_allocator {
+private:
+	monotonic_arena* arena;
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::false_type;
+	using propagate_on_container_move_assignment = std::false_type;
+	using propagate_on_container_swap = std::false_type;
+	using is_always_equal = std::false_type;
+
+	arena_allocator() noexcept : arena(monotonic_arena::current()) {};
+	explicit arena_allocator(monotonic_arena* arena) noexcept : arena(arena) {};
+	template<typename U> arena_allocator(const arena_allocator<U>& other) noexcept : arena(other.get_arena()) {};
+
+	monotonic_arena* get_arena() const noexcept { return arena; };
+
+	T* allocate(size_t n) {
+		allocation_stats& stats = allocation_counters();
+		if (arena) {
+			++stats.arena_allocations;
+			stats.arena_bytes += n * sizeof(T);
+			return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+		}
+		++stats.heap_allocations;
+		stats.heap_bytes += n * sizeof(T);
+		return static_cast<T*>(::operator new(n * sizeof(T)));
+	}
+
+	void deallocate(T* ptr, size_t) noexcept {
+		if (!arena)
+			::operator delete(ptr);
+	}
+
+	// копия создаётся в памяти той арены, что текущая в момент копирования
+	arena_allocator select_on_container_copy_construction() const noexcept { return arena_allocator(); };
+
+	template<typename U>
+	bool operator==(const arena_allocator<U>& other) const noexcept { return arena == other.get_arena(); };
+	template<typename U>
+	bool operator!=(const arena_allocator<U>& other) const noexcept { return arena != other.get_arena(); };
+};
+
+template<typename T, typename Alloc = arena_allocator<T>>
+class Vector;
+
+template<typename T, typename Alloc = arena_allocator<T>>
+class Matrix;
@@ -0,0 +1,256 @@
+#include <chrono>
+#include <cstring>
+#include "async_writer.hpp"
+#include "column_codec.hpp"
+#include "profile.hpp"
+
+static const char delta_magic[4] = { 'L', 'R', '5', 'D' };
+
+static std::vector<result_table::column_info> layout_columns(const result_table& layout) {
+	std::vector<result_table::column_info> output;
+	for (uint64_t col = 0u; col < layout.cols(); ++col)
+		output.push_back(layout.info(col));
+	return output;
+}
+
+async_writer::async_writer(const char* filename, const std::vector<result_table::column_info>& columns, writer_format format,
+	uint64_t block_rows, uint64_t blocks) :
+	columns(columns), format(format), block_rows(block_rows ? block_rows : 1u), storage(std::max<uint64_t>(blocks, 2u)),
+	full_blocks(storage.size()), free_blocks(storage.size()), previous(columns.size()) {
+	if (columns.empty())
+		throw std::logic_error("async writer columns");
+
+	out.open(filename, format == writer_format::text ? std::ios::trunc : std::ios::trunc | std::ios::binary);
+	if (!out.is_open())
+		throw std::logic_error("async writer");
+
+	for (auto& b : storage) {
+		b.values.resize(this->block_rows * columns.size());
+		free_blocks.try_push(&b);
+	}
+
+	if (format == writer_format::gorilla) {
+		std::string header;
+		write_encoded_header(header, columns);
+		out.write(header.data(), header.size());
+	}
+
+	// заголовок: сигнатура, число столбцов, имя и тип каждого
+	if (format == writer_format::delta_varint) {
+		std::string header(delta_magic, sizeof(delta_magic));
+		put_varint(header, columns.size());
+		for (const auto& info : columns) {
+			put_varint(header, info.name.size());
+			header += info.name;
+			header.push_back(char(info.type));
+		}
+		out.write(header.data(), header.size());
+	}
+
+	worker = std::thread(&async_writer::run, this);
+}
+
+async_writer::async_writer(const char* filename, const result_table& layout, writer_format format, uint64_t block_rows, uint64_t blocks) :
+	async_writer(filename, layout_columns(layout), format, block_rows, blocks) {};
+
+async_writer::~async_writer() {
+	try {
+		close();
+	}
+	catch (...) {
+	}
+}
+
+void async_writer::acquire() {
+	if (free_blocks.try_pop(current))
+		return;
+
+	// все блоки в очереди на запись: диск не успевает за расчётом
+	LR5_SCOPE("writer/stall");
+	++stall_count;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!free_blocks.try_pop(current)) {
+		if (failed.load(std::memory_order_acquire))
+			std::rethrow_exception(error);
+		wake.wait_for(lock, std::chrono::milliseconds(1));
+	}
+}
+
+void async_writer::submit() {
+	// кольцо вмещает все блоки, переполнение невозможно
+	full_blocks.try_push(current);
+	current = nullptr;
+	wake.notify_all();
+}
+
+void async_writer::push_row(const double* values) {
+	if (!current)
+		acquire();
+
+	memcpy(current->values.data() + current->rows * columns.size(), values, columns.size() * sizeof(double));
+	++submitted;
+
+	if (++current->rows == block_rows)
+		submit();
+}
+
+void async_writer::push_rows(const result_table& table, uint64_t first, uint64_t last) {
+	if (table.cols() != columns.size())
+		throw std::logic_error("async writer columns");
+
+	for (uint64_t row = first; row < last; ++row) {
+		if (!current)
+			acquire();
+
+		double* values = current->values.data() + current->rows * columns.size();
+		for (uint64_t col = 0u; col < columns.size(); ++col)
+			values[col] = table.value(row, col);
+		++submitted;
+
+		if (++current->rows == block_rows)
+			submit();
+	}
+}
+
+void async_writer::flush() {
+	if (current && current->rows)
+		submit();
+}
+
+void async_writer::close() {
+	if (closed)
+		return;
+	closed = true;
+
+	flush();
+	stopping.store(true, std::memory_order_release);
+	wake.notify_all();
+	worker.join();
+
+	written = uint64_t(out.tellp());
+	out.close();
+	LR5_COUNT("writer/bytes_written", written);
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void async_writer::run() {
+	std::string buffer;
+	block* b = nullptr;
+
+	try {
+		for (;;) {
+			if (full_blocks.try_pop(b)) {
+				write_block(*b, buffer);
+				b->rows = 0u;
+				free_blocks.try_push(b);
+				wake.notify_all();
+				continue;
+			}
+
+			if (stopping.load(std::memory_order_acquire) && full_blocks.empty())
+				break;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait_for(lock, std::chrono::milliseconds(1), [this] { return !full_blocks.empty() || stopping.load(); });
+		}
+
+		// завершающий блок из 0 строк
+		if (format == writer_format::gorilla)
+			out.put('\0');
+	}
+	catch (...) {
+		error = std::current_exception();
+		failed.store(true, std::memory_order_release);
+		wake.notify_all();
+	}
+}
+
+void async_writer::write_block(const block& b, std::string& buffer) {
+	LR5_SCOPE("writer/write_block");
+	const uint64_t width = columns.size();
+
+	if (format == writer_format::text) {
+		// формат как у result_table::write_row
+		for (uint64_t row = 0u; row < b.rows; ++row) {
+			const double* values = b.values.data() + row * width;
+			for (uint64_t col = 0u; col < width; ++col) {
+				if (col)
+					out << ' ';
+				if (columns[col].type == column_type::int32)
+					out << int32_t(values[col]);
+				else
+					out << values[col];
+			}
+			out << '\n';
+		}
+	}
+	else if (format == writer_format::gorilla) {
+		buffer.clear();
+		put_varint(buffer, b.rows);
+		for (uint64_t col = 0u; col < width; ++col)
+			encode_column(b.values.data() + col, width, b.rows, columns[col].type, buffer, mantissa_bits);
+		out.write(buffer.data(), buffer.size());
+	}
+	else {
+		// блок: число строк, затем столбцы подряд; разность с предыдущим значением столбца - в zigzag varint
+		buffer.clear();
+		put_varint(buffer, b.rows);
+		for (uint64_t col = 0u; col < width; ++col) {
+			column_type type = columns[col].type;
+			uint64_t prev = previous[col];
+
+			for (uint64_t row = 0u; row < b.rows; ++row) {
+				uint64_t bits = column_bits(b.values[row * width + col], type);
+				int64_t delta = int64_t(bits - prev);
+				put_varint(buffer, (uint64_t(delta) << 1) ^ uint64_t(delta >> 63));
+				prev = bits;
+			}
+			previous[col] = prev;
+		}
+		out.write(buffer.data(), buffer.size());
+	}
+
+	if (!out)
+		throw std::logic_error("async writer write");
+}
+
+void read_delta_varint(std::istream& in, result_table& table) {
+	char magic[sizeof(delta_magic)];
+	if (!in.read(magic, sizeof(magic)) || memcmp(magic, delta_magic, sizeof(magic)) != 0)
+		throw std::logic_error("read delta varint");
+
+	uint64_t count{};
+	if (!get_varint(in, count))
+		throw std::logic_error("read delta varint");
+
+	std::vector<result_table::column_info> columns(count);
+	for (auto& info : columns) {
+		uint64_t size{};
+		if (!get_varint(in, size))
+			throw std::logic_error("read delta varint");
+
+		info.name.resize(size);
+		char type{};
+		if (!in.read(&info.name[0], size) || !in.get(type))
+			throw std::logic_error("read delta varint");
+		info.type = column_type(type);
+	}
+
+	table = result_table(columns);
+	std::vector<uint64_t> previous(count);
+	uint64_t rows{};
+
+	while (get_varint(in, rows))
+		for (uint64_t col = 0u; col < count; ++col)
+			for (uint64_t row = 0u; row < rows; ++row) {
+				uint64_t code{};
+				if (!get_varint(in, code))
+					throw std::logic_error("read delta varint");
+
+				previous[col] += (code >> 1) ^ (0u - (code & 1u));
+				table.append(col, column_value(previous[col], columns[col].type));
+			}
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "result_table.hpp"
+
+// кольцо для одного поставщика и одного потребителя без блокировок:
+// head меняет только поставщик, tail - только потребитель; счётчики растут, индекс - по маске
+template<typename V>
+class spsc_ring {
+private:
+	std::vector<V> slots;
+	uint64_t mask;
+	alignas(64) std::atomic<uint64_t> head{ 0u };
+	alignas(64) std::atomic<uint64_t> tail{ 0u };
+public:
+	// ёмкость округляется вверх до степени двойки
+	spsc_ring(uint64_t capacity);
+
+	uint64_t capacity() const noexcept { return slots.size(); };
+	bool empty() const noexcept { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); };
+
+	bool try_push(const V& value) noexcept;
+	bool try_pop(V& value) noexcept;
+};
+
+template<typename V>
+spsc_ring<V>::spsc_ring(uint64_t capacity) {
+	uint64_t size = 1u;
+	while (size < capacity)
+		size <<= 1;
+
+	slots.resize(size);
+	mask = size - 1u;
+}
+
+template<typename V>
+bool spsc_ring<V>::try_push(const V& value) noexcept {
+	uint64_t h = head.load(std::memory_order_relaxed);
+	if (h - tail.load(std::memory_order_acquire) == slots.size())
+		return false;
+
+	slots[h & mask] = value;
+	head.store(h + 1u, std::memory_order_release);
+	return true;
+}
+
+template<typename V>
+bool spsc_ring<V>::try_pop(V& value) noexcept {
+	uint64_t t = tail.load(std::memory_order_relaxed);
+	if (t == head.load(std::memory_order_acquire))
+		return false;
+
+	value = slots[t & mask];
+	tail.store(t + 1u, std::memory_order_release);
+	return true;
+}
+
+enum class writer_format : uint8_t {
+	text,         // как load_res2file: значения через пробел, строка на строку таблицы
+	delta_varint, // двоичный: разности соседних значений столбца в zigzag varint
+	gorilla,      // двоичный, column_codec: XOR для float, разность второго порядка для int32; читается read_encoded
+};
+
+// запись строк результатов в отдельном потоке: поставщик (поток интегрирования) копирует строки
+// в блок, заполненный блок уходит потоку записи через spsc_ring, пустые блоки возвращаются
+// через второе кольцо. Форматирование, сжатие и запись на диск - только в потоке записи;
+// поставщик ждёт, лишь если все blocks блоков ещё не записаны
+class async_writer {
+private:
+	struct block {
+		std::vector<double> values; // строки подряд, cols значений на строку
+		uint64_t rows = 0u;
+	};
+
+	std::vector<result_table::column_info> columns;
+	writer_format format;
+	uint64_t block_rows;
+	unsigned mantissa_bits = 52u;
+
+	std::vector<block> storage;
+	spsc_ring<block*> full_blocks, free_blocks;
+	block* current = nullptr;
+
+	std::ofstream out;
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::atomic<bool> stopping{ false };
+	std::atomic<bool> failed{ false };
+	std::exception_ptr error;
+	bool closed = false;
+
+	uint64_t submitted = 0u;
+	uint64_t stall_count = 0u;
+	uint64_t written = 0u;
+	std::vector<uint64_t> previous; // delta_varint: последнее значение столбца в предыдущем блоке
+
+	void submit();
+	void acquire();
+	void run();
+	void write_block(const block& b, std::string& buffer);
+public:
+	async_writer(const char* filename, const std::vector<result_table::column_info>& columns, writer_format format = writer_format::text,
+		uint64_t block_rows = 4096u, uint64_t blocks = 2u);
+	// столбцы - как у таблицы модели
+	async_writer(const char* filename, const result_table& layout, writer_format format = writer_format::text,
+		uint64_t block_rows = 4096u, uint64_t blocks = 2u);
+	~async_writer();
+
+	async_writer(const async_writer&) = delete;
+	async_writer& operator=(const async_writer&) = delete;
+
+	uint64_t cols() const noexcept { return columns.size(); };
+	// gorilla: мантисса float64 округляется до mantissa_bits бит; задаётся до первой строки
+	void set_mantissa_bits(unsigned bits) noexcept { mantissa_bits = bits < 52u ? bits : 52u; };
+
+	void push_row(const double* values);
+	void push_rows(const result_table& table, uint64_t first, uint64_t last);
+	// отдать неполный блок потоку записи
+	void flush();
+	// дождаться записи, закрыть файл; ошибка потока записи выбрасывается здесь
+	void close();
+
+	uint64_t rows() const noexcept { return submitted; };
+	// сколько раз поставщик ждал свободный блок
+	uint64_t stalls() const noexcept { return stall_count; };
+	// размер файла, известен после close
+	uint64_t bytes() const noexcept { return written; };
+};
+
+// чтение файла writer_format::delta_varint
+void read_delta_varint(std::istream& in, result_table& table);
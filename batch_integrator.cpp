@@ -0,0 +1,288 @@
+#include <limits>
+#include "batch_integrator.hpp"
+
+template<typename T>
+batch_model<T>::batch_model(const std::vector<Vector<T>>& init, T t0, T t1, T inc) : sample_inc(inc), t0(t0), t1(t1) {
+	if (init.empty())
+		throw std::logic_error("batch lanes");
+
+	n = init.front().dimension();
+	w = init.size();
+	x0.resize(n * w);
+
+	for (uint64_t lane = 0u; lane < w; ++lane) {
+		if (init[lane].dimension() != n)
+			throw std::logic_error("batch dimension");
+		for (uint64_t count = 0u; count < n; ++count)
+			x0[count * w + lane] = init[lane].at(count);
+	}
+};
+
+template<typename T>
+earth_move_batch<T>::earth_move_batch(const std::vector<Vector<T>>& init, T t0, T t1, T inc) : batch_model<T>(init, t0, t1, inc) {
+	if (this->n != 6u)
+		throw std::logic_error("earth_move_batch dimension");
+
+	res.assign(this->w, result_table({
+		{ "x", column_type::float64 },
+		{ "y", column_type::float64 },
+		{ "z", column_type::float64 },
+	}));
+};
+
+// притяжение Солнца для w полос; массивы не пересекаются - иначе цикл не векторизуется
+// из-за проверок на наложение во время выполнения
+template<typename T>
+static void sun_gravity(const T* __restrict x, const T* __restrict y, const T* __restrict z, T* __restrict ax, T* __restrict ay, T* __restrict az, uint64_t w, T mu) {
+	// без ветвлений и вызовов, кроме sqrt: цикл по полосам векторизуется
+	for (uint64_t lane = 0u; lane < w; ++lane) {
+		T modul = sqrt(x[lane] * x[lane] + y[lane] * y[lane] + z[lane] * z[lane]);
+		T r3 = modul * modul * modul;
+
+		ax[lane] = -mu * x[lane] / r3;
+		ay[lane] = -mu * y[lane] / r3;
+		az[lane] = -mu * z[lane] / r3;
+	}
+}
+
+template<typename T>
+void earth_move_batch<T>::get_right(const T* X, const T*, T* dX) const {
+	LR5_SCOPE("earth_sun/batch_right");
+	const uint64_t w = this->w;
+
+	for (uint64_t count = 0u; count < 3 * w; ++count)
+		dX[count] = X[3 * w + count];
+
+	sun_gravity(X, X + w, X + 2 * w, dX + 3 * w, dX + 4 * w, dX + 5 * w, w, mu_s);
+}
+
+template<typename T>
+void earth_move_batch<T>::add_result(uint64_t lane, const Vector<T>& X, T) {
+	result_table& table = res.at(lane);
+
+	if (table.rows() == 0u)
+		table.reserve(uint64_t((this->get_t1() - this->get_t0()) / this->get_step()) + 1u);
+
+	for (uint64_t count = 0u; count < 3u; ++count)
+		table.append(count, X.at(count));
+}
+
+template<typename T>
+void batch_integrator<T>::stage(uint64_t s, const batch_model<T>& system) {
+	// x = x0 + h * sum_j a(s, j) * k(j): порядок операций тот же, что в DormandPrinceIntegrator;
+	// число стадий s известно только во время выполнения, поэтому внутренний цикл - всегда по полосам
+	using tableau = dormand_prince<T>;
+	for (uint64_t count = 0u; count < n; ++count) {
+		T* xr = x.data() + count * w;
+		const T* x0r = x0.data() + count * w;
+
+		for (uint64_t lane = 0u; lane < w; ++lane)
+			xr[lane] = k[0][count * w + lane] * tableau::a[s][0];
+		for (uint64_t j = 1u; j < s; ++j) {
+			const T* kr = k[j].data() + count * w;
+			const T a = tableau::a[s][j];
+			for (uint64_t lane = 0u; lane < w; ++lane)
+				xr[lane] += a * kr[lane];
+		}
+		for (uint64_t lane = 0u; lane < w; ++lane)
+			xr[lane] = x0r[lane] + xr[lane] * h[lane];
+	}
+
+	for (uint64_t lane = 0u; lane < w; ++lane)
+		tc[lane] = ts[lane] + tableau::c[s] * h[lane];
+
+	system.get_right(x.data(), tc.data(), k[s].data());
+}
+
+template<typename T>
+void batch_integrator<T>::sample(uint64_t lane, batch_model<T>& system, T span) {
+	const T step = system.get_step();
+	const T e = elapsed[lane].value();
+
+	// точка в t1 в выдачу не попадает, как и в DormandPrinceIntegrator
+	Vector<T>& X = lane_state;
+	while ((last[lane] ? next_sample[lane] < span : next_sample[lane] - e < h[lane]) && (next_sample[lane] - span <= step)) {
+		T theta = (next_sample[lane] - e) / h[lane];
+		T d[6];
+		dormand_prince<T>::weights(theta, d);
+
+		for (uint64_t count = 0u; count < n; ++count) {
+			const uint64_t index = count * w + lane;
+			T acc = 0;
+			for (uint64_t j = 0u; j < 6u; ++j)
+				acc += d[j] * k[j][index];
+			X.at(count) = x0[index] + h[lane] * acc;
+		}
+
+		system.add_result(lane, X, system.get_t0() + next_sample[lane]);
+		next_sample[lane] += step;
+	}
+}
+
+template<typename T>
+void batch_integrator<T>::run(batch_model<T>& system) {
+	LR5_SCOPE("batch/run");
+	n = system.dimension();
+	w = system.lanes();
+
+	const uint64_t size = n * w;
+	const T t0 = system.get_t0();
+	const T span = system.get_t1() - t0;
+	const bool output = system.get_step() > 0;
+	using tableau = dormand_prince<T>;
+
+	for (auto& stage_k : k)
+		stage_k.assign(size, 0);
+	x0 = system.get_init();
+	x0_err.assign(size, 0);
+	x1.assign(size, 0);
+	x.assign(size, 0);
+	dx.assign(size, 0);
+	lane_state = Vector<T>(n);
+
+	h.assign(w, 0);
+	h_new.assign(w, 1e-5l);
+	error.assign(w, 0);
+	ts.assign(w, t0);
+	tc.assign(w, t0);
+	elapsed.assign(w, compensated<T>());
+	next_sample.assign(w, system.get_step());
+	active.assign(w, 1u);
+	last.assign(w, 0u);
+	accepted.assign(w, 0u);
+	rejected.assign(w, 0u);
+
+	T v{ 1 };
+	T u;
+	while (1 + v > 1) {
+		u = v;
+		v /= 2;
+	}
+	const T floor_abs = std::max<T>(T(1e-5l), T(2) * u / eps);
+
+	system.get_right(x0.data(), ts.data(), k[0].data());
+	uint64_t remaining = span > 0 ? w : 0u;
+
+	while (remaining) {
+		LR5_SCOPE("batch/step");
+
+		// последний шаг полосы заканчивается ровно в t1; закончившие полосы идут с h = 0
+		T common = std::numeric_limits<T>::max();
+		for (uint64_t lane = 0u; lane < w; ++lane) {
+			if (!active[lane]) {
+				h[lane] = 0;
+				continue;
+			}
+			T rest = (span - elapsed[lane].sum) - elapsed[lane].err;
+			last[lane] = rest <= h_new[lane];
+			h[lane] = last[lane] ? rest : h_new[lane];
+			common = std::min(common, h[lane]);
+			ts[lane] = t0 + elapsed[lane].value();
+		}
+
+		if (shared_step)
+			for (uint64_t lane = 0u; lane < w; ++lane)
+				if (active[lane]) {
+					last[lane] = last[lane] && h[lane] == common;
+					h[lane] = common;
+				}
+
+		for (uint64_t s = 1u; s < 6u; ++s)
+			stage(s, system);
+
+		for (uint64_t count = 0u; count < n; ++count) {
+			const uint64_t row = count * w;
+
+			for (uint64_t lane = 0u; lane < w; ++lane) {
+				T acc = k[0][row + lane] * tableau::b[0];
+				for (uint64_t j = 1u; j < 6u; ++j)
+					acc += tableau::b[j] * k[j][row + lane];
+				dx[row + lane] = acc * h[lane];
+				x1[row + lane] = x0[row + lane] + dx[row + lane];
+			}
+		}
+
+		// FSAL: седьмая стадия в точке x1 становится первой на следующем шаге полосы
+		for (uint64_t lane = 0u; lane < w; ++lane)
+			tc[lane] = ts[lane] + h[lane];
+		system.get_right(x1.data(), tc.data(), k[6].data());
+
+		std::fill(error.begin(), error.end(), T(0));
+		for (uint64_t count = 0u; count < n; ++count) {
+			const uint64_t row = count * w;
+
+			for (uint64_t lane = 0u; lane < w; ++lane) {
+				T acc = k[0][row + lane] * tableau::b1[0];
+				for (uint64_t j = 1u; j < 7u; ++j)
+					acc += tableau::b1[j] * k[j][row + lane];
+				T xe = x0[row + lane] + acc * h[lane];
+
+				T max = std::max<T>({ floor_abs, abs(x0[row + lane]), abs(x1[row + lane]) });
+				T e = h[lane] * (x1[row + lane] - xe) / max;
+				error[lane] += e * e;
+			}
+		}
+
+		T worst = 0;
+		for (uint64_t lane = 0u; lane < w; ++lane) {
+			error[lane] = sqrt(error[lane] / n);
+			if (active[lane])
+				worst = std::max(worst, error[lane]);
+		}
+
+		for (uint64_t lane = 0u; lane < w; ++lane) {
+			if (!active[lane])
+				continue;
+
+			T lane_error = shared_step ? worst : error[lane];
+			h_new[lane] = h[lane] / std::max<T>(0.1l, std::min<T>(5.0l, pow(lane_error / eps, T(1.0l / 5.0l)) / 0.9l));
+
+			if (lane_error > eps) {
+				++rejected[lane];
+				continue;
+			}
+
+			++accepted[lane];
+			if (output)
+				sample(lane, system, span);
+
+			if (last[lane]) {
+				elapsed[lane] = compensated<T>(span);
+				active[lane] = 0u;
+				--remaining;
+			}
+			else
+				elapsed[lane] += h[lane];
+
+			// x0 += dx с компенсацией, k0 = k6 - только для принятых полос
+			for (uint64_t count = 0u; count < n; ++count) {
+				const uint64_t index = count * w + lane;
+				two_sum(x0[index], dx[index] + x0_err[index], x0[index], x0_err[index]);
+				k[0][index] = k[6][index];
+			}
+		}
+
+		if (shared_step && worst > eps)
+			LR5_COUNT("batch/rejected", 1u);
+		else
+			LR5_COUNT("batch/accepted", 1u);
+	}
+}
+
+template<typename T>
+Vector<T> batch_integrator<T>::state(uint64_t lane) const {
+	if (lane >= w)
+		throw std::logic_error("batch lane");
+
+	Vector<T> output(n);
+	for (uint64_t count = 0u; count < n; ++count)
+		output.at(count) = x0[count * w + lane];
+	return output;
+}
+
+template class batch_model<double>;
+template class batch_model<long double>;
+template class earth_move_batch<double>;
+template class earth_move_batch<long double>;
+template class batch_integrator<double>;
+template class batch_integrator<long double>;
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include "model.hpp"
+#include "compensated.hpp"
+#include "dormand_prince.hpp"
+
+// W траекторий одной системы с разными начальными условиями (полосы);
+// состояние хранится по компонентам (SoA): X[i * W + lane] - стадии метода идут подряд по полосам
+template<typename T>
+class batch_model {
+protected:
+	uint64_t n, w;
+	std::vector<T> x0;
+	T sample_inc, t0, t1;
+public:
+	batch_model(const std::vector<Vector<T>>& init, T t0, T t1, T inc);
+	virtual ~batch_model() {};
+
+	uint64_t dimension() const noexcept { return n; };
+	uint64_t lanes() const noexcept { return w; };
+	T get_t0() const noexcept { return t0; };
+	T get_t1() const noexcept { return t1; };
+	T get_step() const noexcept { return sample_inc; };
+	const std::vector<T>& get_init() const noexcept { return x0; };
+
+	// правая часть для всех полос сразу, t[lane] - время полосы
+	virtual void get_right(const T* X, const T* t, T* dX) const = 0;
+	// выдача полосы на сетке sample_inc (sample_inc <= 0 - без выдачи)
+	virtual void add_result(uint64_t, const Vector<T>&, T) {};
+	virtual const char* rhs_id() const noexcept = 0;
+};
+
+// earth_move_model для ансамбля начальных условий; выдача - положение Земли по полосам
+template<typename T>
+class earth_move_batch : public batch_model<T> {
+protected:
+	const T mu_s = 132712.43994e15;
+	std::vector<result_table> res;
+public:
+	earth_move_batch(const std::vector<Vector<T>>& init, T t0, T t1, T inc);
+
+	const result_table& get_result(uint64_t lane) const { return res.at(lane); };
+
+	void get_right(const T* X, const T* t, T* dX) const override;
+	void add_result(uint64_t lane, const Vector<T>& X, T t) override;
+	const char* rhs_id() const noexcept override { return "earth_sun"; };
+};
+
+// метод Дормана - Принса для W полос в ногу: каждая стадия - один вызов правой части на все полосы.
+// По умолчанию у каждой полосы свой шаг, принятие шага - по маске (отвергнутые полосы повторяют шаг,
+// закончившие простаивают); shared_step - общий шаг и общая сетка времени, шаг отвергается целиком
+template<typename T>
+class batch_integrator {
+protected:
+	T eps;
+	bool shared_step = false;
+
+	uint64_t n = 0u, w = 0u;
+	std::vector<T> k[7];
+	std::vector<T> x0, x0_err, x1, x, dx;
+	std::vector<T> h, h_new, error, ts, tc;
+	std::vector<compensated<T>> elapsed;
+	std::vector<T> next_sample;
+	std::vector<uint8_t> active, last;
+	std::vector<uint64_t> accepted, rejected;
+	Vector<T> lane_state; // выдача полосы, создаётся один раз на run
+
+	void stage(uint64_t s, const batch_model<T>& system);
+	void sample(uint64_t lane, batch_model<T>& system, T span);
+public:
+	batch_integrator(T eps) : eps(eps) {};
+
+	void set_shared_step(bool shared) noexcept { shared_step = shared; };
+	void run(batch_model<T>& system);
+
+	// состояние полосы после run (в t1)
+	Vector<T> state(uint64_t lane) const;
+	uint64_t accepted_steps(uint64_t lane) const { return accepted.at(lane); };
+	uint64_t rejected_steps(uint64_t lane) const { return rejected.at(lane); };
+};
@@ -0,0 +1,494 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <thread>
+#include "model.hpp"
+#include "integrator.hpp"
+#include "nbody.hpp"
+#include "cr3bp.hpp"
+#include "batch_integrator.hpp"
+#include "trajectory_cache.hpp"
+#include "monte_carlo.hpp"
+#include "unscented.hpp"
+#include "dense_trajectory.hpp"
+#include "column_codec.hpp"
+
+// счётчик выделений памяти: заменяет глобальные operator new/delete, в том числе с выравниванием и размером
+static std::atomic<uint64_t> allocations{ 0 };
+
+// освобождение вне строки: встроенный free() в operator delete GCC принимает
+// за освобождение памяти operator new не той функцией (-Wmismatched-new-delete)
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void release(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void release_aligned(void* ptr) noexcept {
+#if defined(_MSC_VER)
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+void* operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	size_t alignment = static_cast<size_t>(align);
+	// aligned_alloc требует размер, кратный выравниванию
+	size = (size + alignment - 1u) / alignment * alignment;
+#if defined(_MSC_VER)
+	void* ptr = _aligned_malloc(size ? size : alignment, alignment);
+#else
+	void* ptr = std::aligned_alloc(alignment, size ? size : alignment);
+#endif
+	if (ptr)
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+	return operator new(size, align);
+}
+
+void operator delete(void* ptr) noexcept {
+	release(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	release(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	release(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+	release(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+	release_aligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+	release_aligned(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+	release_aligned(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+	release_aligned(ptr);
+}
+
+// модель, считающая вызовы правой части
+template<typename M>
+class counting_model : public M {
+public:
+	mutable uint64_t calls = 0;
+
+	using M::M;
+
+	Vector<real_t> get_right(const Vector<real_t>& X, real_t t) const override {
+		++calls;
+		return M::get_right(X, t);
+	}
+};
+
+struct bench_result {
+	std::string name;
+	uint64_t iterations;
+	double ns_per_op;
+	double allocs_per_op;
+	double rhs_per_s;
+};
+
+static volatile double sink;
+static double min_time = 0.2;
+
+template<typename F>
+static bench_result measure(const std::string& name, F&& f) {
+	using clock = std::chrono::steady_clock;
+
+	uint64_t iterations = 0u;
+	uint64_t rhs_calls = 0u;
+	uint64_t allocs_before = allocations.load();
+	auto start = clock::now();
+	double elapsed{};
+
+	do {
+		rhs_calls += f();
+		++iterations;
+		elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	} while (elapsed < min_time);
+
+	uint64_t allocs = allocations.load() - allocs_before;
+
+	return { name, iterations, elapsed * 1e9 / iterations, double(allocs) / iterations, rhs_calls / elapsed };
+}
+
+// орбита Аренсторфа для ограниченной задачи трёх тел model_t::get_right
+static uint64_t bench_cr3bp() {
+	counting_model<model_t<real_t>> model(Vector<real_t>({ 0.994, 0.0, 0.0, -2.00158510637908252240537862224l }), 0.0, 17.0652165601579625588917206249l, 0.01);
+	DormandPrinceIntegrator<real_t> integrator(1e-10l);
+	integrator.run(model);
+	return model.calls;
+}
+
+static uint64_t bench_earth_move() {
+	real_t t0 = 2460310.50 * 86400.0;
+	real_t t1 = t0 + 30.0 * 86400.0;
+	counting_model<earth_move_model<real_t>> model(Vector<real_t>({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 }), t0, t1, t1 - t0);
+	DormandPrinceIntegrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+	integrator.run(model);
+	return model.calls;
+}
+
+static uint64_t bench_sundial() {
+	counting_model<sundial_model<real_t>> model(rad(55), rad(37), get_JDN(2024, 3, 15, 0, 0, 0));
+	DormandPrinceIntegrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+	integrator.run(model);
+	return model.calls;
+}
+
+static uint64_t bench_sundial_adaptive() {
+	counting_model<sundial_model<real_t>> model(rad(55), rad(37), get_JDN(2024, 3, 15, 0, 0, 0));
+	model.set_adaptive(1e-3);
+	DormandPrinceIntegrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+	integrator.run(model);
+	return model.calls;
+}
+
+static uint64_t bench_blag_time() {
+	counting_model<blag_time_model<real_t>> model;
+	DormandPrinceIntegrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+	integrator.run(model);
+	return model.calls;
+}
+
+// ансамбль из 8 начальных условий Земли: по одному и пакетом
+static std::vector<Vector<real_t>> earth_ensemble(uint64_t count) {
+	std::vector<Vector<real_t>> output;
+	for (uint64_t lane = 0u; lane < count; ++lane)
+		output.push_back(Vector<real_t>({ -2.6005047996994e10 + 1e6 * lane, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3 + 0.5 * lane, -2.043123e3 }));
+	return output;
+}
+
+static uint64_t bench_earth_move_x8() {
+	real_t t0 = 2460310.50 * 86400.0;
+	real_t t1 = t0 + 30.0 * 86400.0;
+	uint64_t calls = 0u;
+	for (const auto& init : earth_ensemble(8)) {
+		counting_model<earth_move_model<real_t>> model(init, t0, t1, t1 - t0);
+		DormandPrinceIntegrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+		integrator.run(model);
+		calls += model.calls;
+	}
+	return calls;
+}
+
+static uint64_t bench_earth_move_batch(bool shared) {
+	real_t t0 = 2460310.50 * 86400.0;
+	real_t t1 = t0 + 30.0 * 86400.0;
+	earth_move_batch<real_t> model(earth_ensemble(8), t0, t1, t1 - t0);
+	batch_integrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+	integrator.set_shared_step(shared);
+	integrator.run(model);
+
+	// правая часть считается для всех полос на каждой стадии
+	uint64_t steps = 0u;
+	for (uint64_t lane = 0u; lane < 8u; ++lane)
+		steps = std::max(steps, integrator.accepted_steps(lane) + integrator.rejected_steps(lane));
+	return 8u * (6u * steps + 1u);
+}
+
+// ковариация Земли через 30 суток по 13 сигма-точкам, СКО 10 км и 1 мм/с
+static uint64_t bench_unscented() {
+	real_t t0 = 2460310.50 * 86400.0;
+	real_t t1 = t0 + 30.0 * 86400.0;
+	gaussian_state<real_t> initial{ earth_ensemble(1).front(), Matrix<real_t>(6, 6) };
+	for (uint64_t axis = 0u; axis < 3u; ++axis) {
+		initial.covariance.at(axis, axis) = 1e8;
+		initial.covariance.at(3 + axis, 3 + axis) = 1e-6;
+	}
+
+	unscented_propagator<real_t> propagator(scalar_traits<real_t>::tolerance);
+	gaussian_state<real_t> output = propagator.propagate(initial, [&](const std::vector<Vector<real_t>>& init) {
+		return std::unique_ptr<batch_model<real_t>>(new earth_move_batch<real_t>(init, t0, t1, t1 - t0));
+	});
+	sink = output.covariance.at(0, 0);
+	return 0u;
+}
+
+// гало-орбита у L1 системы Земля - Луна: коррекция с матрицей чувствительности
+static uint64_t bench_halo() {
+	periodic_orbit_solver<real_t> solver(0.012150585609624l);
+	sink = solver.correct(orbit_family::halo, Vector<real_t>({ 0.8234l, 0.0l, 0.0224l, 0.0l, 0.1343l, 0.0l })).period;
+	return 0u;
+}
+
+// 16 независимых ляпуновских орбит по всем ядрам
+static uint64_t bench_lyapunov_batch() {
+	periodic_orbit_solver<real_t> solver(0.012150585609624l);
+	solver.set_threads(std::max(1u, std::thread::hardware_concurrency()));
+
+	std::vector<Vector<real_t>> guesses;
+	for (uint64_t count = 0u; count < 16u; ++count)
+		guesses.push_back(Vector<real_t>({ real_t(0.822l + 0.0005l * count), 0.0l, 0.0l, 0.0l, real_t(0.141l - 0.005l * count), 0.0l }));
+
+	sink = solver.correct(orbit_family::lyapunov, guesses).back().period;
+	return 0u;
+}
+
+static uint64_t bench_nbody() {
+	real_t jd = 2460310.5;
+	counting_model<nbody_model<real_t>> model(solar_system<real_t>(jd), jd * 86400.0, (jd + 30.0) * 86400.0, 3600.0);
+	DormandPrinceIntegrator<real_t> integrator(1e-13l);
+	integrator.run(model);
+	return model.calls;
+}
+
+// Солнце, планеты и рой из лёгких тел на кольце между Марсом и Юпитером
+static std::vector<nbody_body<real_t>> test_swarm(uint64_t count) {
+	std::vector<nbody_body<real_t>> output = solar_system<real_t>(2460310.5, false);
+	for (uint64_t body = output.size(); body < count; ++body) {
+		real_t angle = 2.399963l * body;
+		real_t radius = (2.2l + 1.1l * (body % 97u) / 97.0l) * 1.495978707e11l;
+		output.push_back({ "a" + std::to_string(body), 1e8l, Vector<real_t>({ radius * cos(angle), radius * sin(angle), real_t(1e9l * (body % 13u)) }),
+			Vector<real_t>({ real_t(-1.8e4l * sin(angle)), real_t(1.8e4l * cos(angle)), 0.0l }) });
+	}
+	return output;
+}
+
+static Matrix<real_t> test_matrix(uint64_t size) {
+	Matrix<real_t> output(size, size);
+	for (uint64_t row = 0u; row < size; ++row)
+		for (uint64_t col = 0u; col < size; ++col)
+			output.at(row, col) = (row == col) ? size + 1.0 : 1.0 / (row + col + 1.0);
+	return output;
+}
+
+int main(int argc, char** argv) {
+	const char* json_file = nullptr;
+	const char* filter = "";
+
+	for (int count = 1; count < argc; ++count) {
+		if (!strcmp(argv[count], "--json") && count + 1 < argc)
+			json_file = argv[++count];
+		else if (!strcmp(argv[count], "--filter") && count + 1 < argc)
+			filter = argv[++count];
+		else if (!strcmp(argv[count], "--min-time") && count + 1 < argc)
+			min_time = atof(argv[++count]);
+		else {
+			std::cout << "usage: bench [--json <file>] [--filter <substring>] [--min-time <s>]" << '\n';
+			return 1;
+		}
+	}
+
+	const Matrix<real_t> M6 = test_matrix(6);
+	const Vector<real_t> a({ 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 });
+	const Vector<real_t> b({ 6.0, 5.0, 4.0, 3.0, 2.0, 1.0 });
+	const Vector<real_t> a3({ 1.0, 2.0, 3.0 });
+	const Vector<real_t> b3({ 3.0, -1.0, 2.0 });
+	const Quartenion q1(0.3, Vector<double>({ 1.0, 2.0, 3.0 }));
+	const Quartenion q2(1.1, Vector<double>({ -1.0, 0.5, 2.0 }));
+	const Vector<double> r({ 1.0, 0.0, 0.0 });
+
+	const julian_date j2024 = julian_date::from_calendar(2024, 1, 1);
+	const earth_orientation orientation(utc_to_tt(j2024));
+	double sink_t = 0.0;
+
+	const real_t jd = 2460310.5;
+	nbody_model<real_t> planets(solar_system<real_t>(jd), jd * 86400.0, jd * 86400.0, 1.0);
+	nbody_model<real_t> swarm(test_swarm(1024), jd * 86400.0, jd * 86400.0, 1.0);
+	nbody_model<real_t> swarm_threads(test_swarm(1024), jd * 86400.0, jd * 86400.0, 1.0);
+	swarm_threads.set_threads(std::max(1u, std::thread::hardware_concurrency()));
+
+	counter_rng rng(1u, 0u);
+	running_stats stats;
+	p2_quantile median(0.5);
+
+	blag_time_model<real_t> blag;
+	DormandPrinceIntegrator<real_t>(scalar_traits<real_t>::tolerance).run(blag);
+
+	// смена места наблюдения: траектория за год уже в кэше, пересчитывается только наблюдатель
+	incremental_runner<real_t> runner(scalar_traits<real_t>::tolerance);
+	blag_time_model<real_t> site_blag;
+	runner.run(site_blag);
+	bool site_toggle = false;
+
+	// траектория Земли за 30 суток без сетки выдачи: 10^4 произвольных моментов за запрос
+	const real_t traj_t0 = 2460310.50 * 86400.0;
+	earth_move_model<real_t> traj_model(Vector<real_t>({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 }),
+		traj_t0, traj_t0 + 30.0 * 86400.0, 30.0 * 86400.0);
+	DormandPrinceIntegrator<real_t> traj_integrator(scalar_traits<real_t>::tolerance);
+	dense_trajectory<real_t> trajectory = traj_integrator.trajectory(traj_model);
+	trajectory.extend(traj_model.get_t1());
+	std::vector<real_t> traj_times(10000u), traj_states(10000u * trajectory.dimension());
+	for (uint64_t count = 0u; count < traj_times.size(); ++count)
+		traj_times[count] = traj_t0 + 30.0 * 86400.0 * ((count * 7919u) % 10000u) / 10000.0;
+
+	// столбцы res1 (тень за сутки): сжатые по отдельности и как есть
+	sundial_model<real_t> sundial(rad(55), rad(37), get_JDN(2024, 3, 15, 0, 0, 0));
+	DormandPrinceIntegrator<real_t>(scalar_traits<real_t>::tolerance).run(sundial);
+	const result_table& shadow = sundial.get_result();
+	std::vector<double> shadow_raw(shadow.rows() * shadow.cols()), shadow_out(shadow_raw.size());
+	std::vector<std::string> shadow_encoded(shadow.cols());
+	for (uint64_t col = 0u; col < shadow.cols(); ++col) {
+		for (uint64_t row = 0u; row < shadow.rows(); ++row)
+			shadow_raw[col * shadow.rows() + row] = shadow.value(row, col);
+		std::string chunk;
+		encode_column(shadow_raw.data() + col * shadow.rows(), 1u, shadow.rows(), shadow.info(col).type, chunk);
+		const char* data = chunk.data();
+		uint64_t size{};
+		get_varint(data, chunk.data() + chunk.size(), size);
+		shadow_encoded[col].assign(data, size);
+	}
+
+	std::vector<std::pair<std::string, std::function<uint64_t()>>> cases = {
+		{ "integrator/cr3bp_arenstorf", bench_cr3bp },
+		{ "integrator/earth_move_30d", bench_earth_move },
+		{ "integrator/sundial", bench_sundial },
+		{ "integrator/sundial_adaptive", bench_sundial_adaptive },
+		{ "integrator/blag_time", bench_blag_time },
+		{ "integrator/nbody_30d", bench_nbody },
+		{ "incremental/blag_site_change", [&] {
+			site_toggle = !site_toggle;
+			site_blag.set_site(site_toggle ? rad(59.94) : 0.97302106, site_toggle ? rad(30.31) : 0.65624380);
+			sink = double(runner.run(site_blag));
+			return 0u;
+		} },
+		{ "trajectory/earth_move_30d", [&] {
+			earth_move_model<real_t> model(traj_model.get_init(), traj_model.get_t0(), traj_model.get_t1(), traj_model.get_step());
+			DormandPrinceIntegrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+			dense_trajectory<real_t> trajectory = integrator.trajectory(model);
+			trajectory.extend(model.get_t1());
+			sink = double(trajectory.size());
+			return 0u;
+		} },
+		{ "trajectory/query_1e4", [&] {
+			trajectory.state(traj_times.data(), traj_times.size(), traj_states.data());
+			sink = double(traj_states[0]);
+			return 0u;
+		} },
+		{ "batch/earth_move_30d_x8_serial", bench_earth_move_x8 },
+		{ "batch/earth_move_30d_x8", [] { return bench_earth_move_batch(false); } },
+		{ "batch/earth_move_30d_x8_shared", [] { return bench_earth_move_batch(true); } },
+		{ "batch/unscented_earth_move_30d", bench_unscented },
+		{ "cr3bp/halo_correct", bench_halo },
+		{ "cr3bp/lyapunov_batch_16", bench_lyapunov_batch },
+		{ "nbody/rhs_11", [&] { sink = planets.get_right(planets.get_init(), 0.0).at(33); return 1u; } },
+		{ "nbody/rhs_1024", [&] { sink = swarm.get_right(swarm.get_init(), 0.0).at(3072); return 1u; } },
+		{ "nbody/rhs_1024_threads", [&] { sink = swarm_threads.get_right(swarm_threads.get_init(), 0.0).at(3072); return 1u; } },
+		{ "montecarlo/rng_normal", [&] { sink = rng.normal(); return 0u; } },
+		{ "montecarlo/welford_p2_add", [&] { double x = rng.uniform(); stats.add(x); median.add(x); sink = median.value(); return 0u; } },
+		{ "matrix/multiply_6x6", [&] { Matrix<real_t> m(M6); m.multiply(M6); sink = m(0, 0); return 0u; } },
+		{ "matrix/inverse_6x6", [&] { sink = (!M6)(0, 0); return 0u; } },
+		{ "matrix/cholesky_6x6", [&] { sink = M6.cholesky()(5, 5); return 0u; } },
+		{ "matrix/determinate_6x6", [&] { sink = M6.determinate(); return 0u; } },
+		{ "vector/add_6", [&] { sink = (a + b).at(0); return 0u; } },
+		{ "vector/axpy_6", [&] { sink = (a + 0.5 * b).at(0); return 0u; } },
+		{ "vector/dot_6", [&] { sink = a * b; return 0u; } },
+		{ "vector/cross_3", [&] { sink = (a3 ^ b3).at(0); return 0u; } },
+		{ "quartenion/multiply", [&] { sink = (q1 * q2).scal(); return 0u; } },
+		{ "quartenion/rotate", [&] { sink = r.rotateByQuartenion(q1).at(0); return 0u; } },
+		{ "orientation/gast_direct", [&] { sink = gast(utc_to_ut1(j2024, 0.0), utc_to_tt(j2024 + (sink_t += 60.0))); return 0u; } },
+		{ "orientation/sidereal_angle", [&] { sink = orientation.sidereal_angle(sink_t += 60.0); return 0u; } },
+		{ "orientation/precession_nutation", [&] { double pn[9]; orientation.precession_nutation(sink_t += 60.0, pn); sink = pn[1]; return 0u; } },
+		{ "funcm/legendre_8_4", [&] { sink = Legendre(0.7l, 8, 4); return 0u; } },
+		{ "model/load_res2file_365", [&] {
+			std::cout.setstate(std::ios::failbit);
+			blag.load_res2file("bench_res2.txt");
+			std::cout.clear();
+			return 0u;
+		} },
+		{ "codec/encode_res1", [&] {
+			std::string out;
+			for (uint64_t col = 0u; col < shadow.cols(); ++col)
+				encode_column(shadow_raw.data() + col * shadow.rows(), 1u, shadow.rows(), shadow.info(col).type, out);
+			sink = double(out.size());
+			return 0u;
+		} },
+		{ "codec/decode_res1", [&] {
+			for (uint64_t col = 0u; col < shadow.cols(); ++col)
+				decode_column(shadow_encoded[col].data(), shadow_encoded[col].size(), shadow.info(col).type, shadow.rows(), shadow_out.data() + col * shadow.rows());
+			sink = shadow_out.back();
+			return 0u;
+		} },
+		{ "codec/memcpy_res1", [&] {
+			memcpy(shadow_out.data(), shadow_raw.data(), shadow_raw.size() * sizeof(double));
+			sink = shadow_out.back();
+			return 0u;
+		} },
+		{ "model/async_writer_365", [&] {
+			async_writer output("bench_res2.txt", blag.get_result());
+			output.push_rows(blag.get_result(), 0u, blag.get_result().rows());
+			output.close();
+			return 0u;
+		} },
+		{ "model/async_writer_delta_365", [&] {
+			async_writer output("bench_res2.txt", blag.get_result(), writer_format::delta_varint);
+			output.push_rows(blag.get_result(), 0u, blag.get_result().rows());
+			output.close();
+			return 0u;
+		} },
+	};
+
+	std::vector<bench_result> results;
+
+	for (auto& bench : cases) {
+		if (bench.first.find(filter) == std::string::npos)
+			continue;
+
+		bench_result result = measure(bench.first, bench.second);
+		results.push_back(result);
+
+		printf("%-28s %10llu it %14.1f ns/op %10.1f allocs/op", result.name.c_str(), (unsigned long long)result.iterations, result.ns_per_op, result.allocs_per_op);
+		if (result.rhs_per_s > 0)
+			printf(" %12.0f rhs/s", result.rhs_per_s);
+		printf("\n");
+	}
+
+	std::remove("bench_res2.txt");
+
+	if (json_file) {
+		std::ofstream f(json_file, std::ios::trunc);
+
+		if (!f.is_open())
+			throw std::logic_error("bench json");
+
+		f << std::setprecision(10);
+		f << "{\n  \"scalar\": \"" << scalar_traits<real_t>::name << "\",\n  \"benchmarks\": [\n";
+		for (uint64_t count = 0u; count < results.size(); ++count) {
+			const auto& result = results.at(count);
+			f << "    { \"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+				<< ", \"ns_per_op\": " << result.ns_per_op << ", \"allocs_per_op\": " << result.allocs_per_op
+				<< ", \"rhs_calls_per_s\": " << result.rhs_per_s << " }" << (count + 1 < results.size() ? "," : "") << '\n';
+		}
+		f << "  ]\n}\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <iostream>
+#include <stdexcept>
+#include "vector.hpp"
+
+template<typename T>
+inline void write_binary(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+inline void read_binary(std::istream& in, T& value) {
+	if (!in.read(reinterpret_cast<char*>(&value), sizeof(T)))
+		throw std::logic_error("read binary");
+}
+
+template<typename T>
+inline void write_binary(std::ostream& out, const Vector<T>& vec) {
+	write_binary(out, uint64_t(vec.dimension()));
+	for (uint64_t count = 0u; count < vec.dimension(); ++count)
+		write_binary(out, vec.at(count));
+}
+
+template<typename T>
+inline void read_binary(std::istream& in, Vector<T>& vec) {
+	uint64_t size{};
+	read_binary(in, size);
+
+	vec.resize(size);
+	for (uint64_t count = 0u; count < size; ++count)
+		read_binary(in, vec.at(count));
+}
+
+template<typename T>
+inline void write_binary(std::ostream& out, const Matrix<T>& mat) {
+	write_binary(out, mat.rows());
+	write_binary(out, mat.cols());
+	for (uint64_t row = 0u; row < mat.rows(); ++row)
+		for (uint64_t col = 0u; col < mat.cols(); ++col)
+			write_binary(out, mat.at(row, col));
+}
+
+template<typename T>
+inline void read_binary(std::istream& in, Matrix<T>& mat) {
+	uint64_t rows{}, cols{};
+	read_binary(in, rows);
+	read_binary(in, cols);
+
+	mat.resize(rows, cols);
+	for (uint64_t row = 0u; row < rows; ++row)
+		for (uint64_t col = 0u; col < cols; ++col)
+			read_binary(in, mat.at(row, col));
+}
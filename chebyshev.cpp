@@ -0,0 +1,221 @@
+#include "chebyshev.hpp"
+#include <algorithm>
+
+template<typename T>
+static Vector<T> segments_state(const std::vector<dense_segment<T>>& segments, T t) {
+	auto found = std::upper_bound(segments.begin(), segments.end(), t,
+		[](T value, const dense_segment<T>& segment) { return value < segment.t0.to_seconds(); });
+
+	if (found == segments.begin())
+		throw std::out_of_range("segments state");
+
+	return (found - 1)->state(t);
+}
+
+template<typename T>
+chebyshev_ephemeris chebyshev_ephemeris::fit(const std::vector<dense_segment<T>>& segments, long double t_begin, long double t_end, double interval, uint64_t degree) {
+	using namespace math_const;
+
+	if (segments.empty() || degree < 2 || degree > max_degree || interval <= 0)
+		throw std::logic_error("chebyshev fit");
+
+	if (t_begin < segments.front().t0.to_seconds() || t_end > segments.back().t0.to_seconds() + segments.back().h || t_end <= t_begin)
+		throw std::out_of_range("chebyshev fit");
+
+	chebyshev_ephemeris output;
+	output.t_begin = t_begin;
+	output.t_end = t_end;
+	output.interval = interval;
+	output.degree = degree;
+	// неполный последний отрезок тоже аппроксимируется; остаток на уровне округления отрезка не добавляет
+	output.count = std::max<uint64_t>(1u, uint64_t(ceil(double((t_end - t_begin) / interval) - 1e-9)));
+	output.coeffs.resize(output.count * 3 * (degree + 1));
+	output.errors.resize(output.count);
+	output.velocity_errors.resize(output.count);
+
+	const uint64_t nodes = degree + 1;
+
+	for (uint64_t segment = 0u; segment < output.count; ++segment) {
+		long double a = t_begin + segment * (long double)interval;
+		double length = segment + 1u == output.count ? double(t_end - a) : interval;
+		double* c = &output.coeffs.at(segment * 3 * nodes);
+
+		// узлы Чебышёва-Гаусса: коэффициенты получаются дискретным косинус-преобразованием
+		for (uint64_t node = 0u; node < nodes; ++node) {
+			double arg = π * (node + 0.5) / nodes;
+			long double t = a + (long double)length * (cos(arg) + 1.0) / 2.0;
+
+			Vector<T> X = segments_state<T>(segments, t);
+
+			for (uint64_t k = 0u; k < nodes; ++k) {
+				double Tk = cos(k * arg) * 2.0 / nodes;
+				for (uint64_t axis = 0u; axis < 3u; ++axis)
+					c[axis * nodes + k] += X.at(axis) * Tk;
+			}
+		}
+
+		for (uint64_t axis = 0u; axis < 3u; ++axis)
+			c[axis * nodes] /= 2.0;
+
+		// оценка погрешности по точкам между узлами, включая оба конца отрезка;
+		// конец считается рядом этого отрезка, следующий ещё не построен
+		double error{}, velocity_error{};
+		for (uint64_t check = 0u; check <= 2u * nodes; ++check) {
+			long double t = a + (long double)length * check / (2.0l * nodes);
+
+			Vector<T> X = segments_state<T>(segments, t);
+			double r[3], v[3];
+			output.evaluate(segment, double(check) / nodes - 1.0, length, r, v);
+
+			double dr = sqrt(pow(r[0] - double(X.at(0)), 2) + pow(r[1] - double(X.at(1)), 2) + pow(r[2] - double(X.at(2)), 2));
+			double dv = sqrt(pow(v[0] - double(X.at(3)), 2) + pow(v[1] - double(X.at(4)), 2) + pow(v[2] - double(X.at(5)), 2));
+			error = std::max(error, dr);
+			velocity_error = std::max(velocity_error, dv);
+		}
+		output.errors.at(segment) = error;
+		output.velocity_errors.at(segment) = velocity_error;
+	}
+
+	return output;
+}
+
+uint64_t chebyshev_ephemeris::locate(long double t, long double& start, double& length) const {
+	if (count == 0u || t < t_begin || t > t_end)
+		throw std::out_of_range("chebyshev ephemeris");
+
+	uint64_t index = std::min(uint64_t(double(t - t_begin) / interval), count - 1u);
+	start = t_begin + index * (long double)interval;
+	length = index + 1u == count ? double(t_end - start) : interval;
+	return index;
+}
+
+void chebyshev_ephemeris::position(long double t, double* r) const {
+	long double start;
+	double length;
+	uint64_t index = locate(t, start, length);
+	double x = 2.0 * double(t - start) / length - 1.0;
+
+	const uint64_t nodes = degree + 1;
+	const double* c = coeffs.data() + index * 3 * nodes;
+
+	double T[max_degree + 1];
+	T[0] = 1.0;
+	T[1] = x;
+	for (uint64_t k = 2u; k < nodes; ++k)
+		T[k] = 2.0 * x * T[k - 1] - T[k - 2];
+
+	for (uint64_t axis = 0u; axis < 3u; ++axis) {
+		double sum{};
+		for (uint64_t k = 0u; k < nodes; ++k)
+			sum += c[axis * nodes + k] * T[k];
+		r[axis] = sum;
+	}
+}
+
+void chebyshev_ephemeris::state(long double t, double* r, double* v) const {
+	long double start;
+	double length;
+	uint64_t index = locate(t, start, length);
+	evaluate(index, 2.0 * double(t - start) / length - 1.0, length, r, v);
+}
+
+void chebyshev_ephemeris::evaluate(uint64_t index, double x, double length, double* r, double* v) const {
+	const uint64_t nodes = degree + 1;
+	const double* c = coeffs.data() + index * 3 * nodes;
+
+	double T[max_degree + 1], dT[max_degree + 1];
+	T[0] = 1.0;
+	T[1] = x;
+	dT[0] = 0.0;
+	dT[1] = 1.0;
+	for (uint64_t k = 2u; k < nodes; ++k) {
+		T[k] = 2.0 * x * T[k - 1] - T[k - 2];
+		dT[k] = 2.0 * T[k - 1] + 2.0 * x * dT[k - 1] - dT[k - 2];
+	}
+
+	// dx/dt = 2 / длина отрезка
+	const double scale = 2.0 / length;
+
+	for (uint64_t axis = 0u; axis < 3u; ++axis) {
+		double sum{}, dsum{};
+		for (uint64_t k = 0u; k < nodes; ++k) {
+			sum += c[axis * nodes + k] * T[k];
+			dsum += c[axis * nodes + k] * dT[k];
+		}
+		r[axis] = sum;
+		if (v)
+			v[axis] = dsum * scale;
+	}
+}
+
+Vector<double> chebyshev_ephemeris::position(long double t) const {
+	Vector<double> output(3);
+	double r[3];
+	position(t, r);
+
+	for (uint64_t axis = 0u; axis < 3u; ++axis)
+		output.at(axis) = r[axis];
+
+	return output;
+}
+
+double chebyshev_ephemeris::max_error() const noexcept {
+	return errors.empty() ? 0.0 : *std::max_element(errors.begin(), errors.end());
+}
+
+double chebyshev_ephemeris::max_velocity_error() const noexcept {
+	return velocity_errors.empty() ? 0.0 : *std::max_element(velocity_errors.begin(), velocity_errors.end());
+}
+
+void chebyshev_ephemeris::save(const char* filename) const {
+	std::ofstream f(filename, std::ios::binary | std::ios::trunc);
+
+	if (!f.is_open())
+		throw std::logic_error("save ephemeris");
+
+	f.write("LR5E", 4);
+	write_binary(f, uint32_t(3));
+	write_binary(f, t_begin);
+	write_binary(f, t_end);
+	write_binary(f, interval);
+	write_binary(f, degree);
+	write_binary(f, count);
+	f.write(reinterpret_cast<const char*>(coeffs.data()), coeffs.size() * sizeof(double));
+	f.write(reinterpret_cast<const char*>(errors.data()), errors.size() * sizeof(double));
+	f.write(reinterpret_cast<const char*>(velocity_errors.data()), velocity_errors.size() * sizeof(double));
+}
+
+void chebyshev_ephemeris::load(const char* filename) {
+	std::ifstream f(filename, std::ios::binary);
+
+	if (!f.is_open())
+		throw std::logic_error("load ephemeris");
+
+	char magic[4]{};
+	uint32_t version{};
+
+	f.read(magic, 4);
+	read_binary(f, version);
+	if (std::string(magic, 4) != "LR5E" || version != 3)
+		throw std::logic_error("load ephemeris");
+
+	read_binary(f, t_begin);
+	read_binary(f, t_end);
+	read_binary(f, interval);
+	read_binary(f, degree);
+	read_binary(f, count);
+
+	if (degree > max_degree || count == 0u || t_end <= t_begin)
+		throw std::logic_error("load ephemeris");
+
+	coeffs.resize(count * 3 * (degree + 1));
+	errors.resize(count);
+	velocity_errors.resize(count);
+	if (!f.read(reinterpret_cast<char*>(coeffs.data()), coeffs.size() * sizeof(double)) ||
+		!f.read(reinterpret_cast<char*>(errors.data()), errors.size() * sizeof(double)) ||
+		!f.read(reinterpret_cast<char*>(velocity_errors.data()), velocity_errors.size() * sizeof(double)))
+		throw std::logic_error("load ephemeris");
+}
+
+template chebyshev_ephemeris chebyshev_ephemeris::fit(const std::vector<dense_segment<double>>& segments, long double t_begin, long double t_end, double interval, uint64_t degree);
+template chebyshev_ephemeris chebyshev_ephemeris::fit(const std::vector<dense_segment<long double>>& segments, long double t_begin, long double t_end, double interval, uint64_t degree);
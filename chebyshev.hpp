@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include "integrator.hpp"
+
+// эфемерида из отрезков полиномов Чебышёва равной длины (как в DE JPL), последний отрезок укорочен до t_end:
+// коэффициенты хранятся по [отрезок][ось][степень], скорость - производная ряда.
+// Вне [t_begin, t_end] оценки погрешности нет - запрос выбрасывает std::out_of_range
+class chebyshev_ephemeris {
+public:
+	static constexpr uint64_t max_degree = 31;
+private:
+	long double t_begin = 0;
+	long double t_end = 0;
+	double interval = 0;
+	uint64_t degree = 0;
+	uint64_t count = 0;
+	std::vector<double> coeffs;
+	std::vector<double> errors;
+	std::vector<double> velocity_errors;
+
+	// ряд отрезка index в точке x из [-1, 1]; v может быть nullptr
+	void evaluate(uint64_t index, double x, double length, double* r, double* v) const;
+public:
+	chebyshev_ephemeris() noexcept {};
+
+	template<typename T>
+	static chebyshev_ephemeris fit(const std::vector<dense_segment<T>>& segments, long double t_begin, long double t_end, double interval, uint64_t degree);
+
+	void position(long double t, double* r) const;
+	void state(long double t, double* r, double* v) const;
+	Vector<double> position(long double t) const;
+
+	long double get_t_begin() const noexcept { return t_begin; };
+	long double get_t_end() const noexcept { return t_end; };
+	uint64_t segments() const noexcept { return count; };
+	uint64_t bytes() const noexcept { return coeffs.size() * sizeof(double); };
+	double max_error() const noexcept;
+	// оценка погрешности скорости из state(): производная ряда сходится медленнее самого ряда
+	double max_velocity_error() const noexcept;
+	// отрезок, содержащий t, его начало и длина
+	uint64_t locate(long double t, long double& start, double& length) const;
+	double error(uint64_t segment) const { return errors.at(segment); };
+	double velocity_error(uint64_t segment) const { return velocity_errors.at(segment); };
+
+	void save(const char* filename) const;
+	void load(const char* filename);
+};
@@ -0,0 +1,460 @@
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "column_codec.hpp"
+#include "profile.hpp"
+
+static const char encoded_magic[4] = { 'L', 'R', '5', 'G' };
+
+static unsigned leading_zeros(uint64_t x) noexcept {
+#if defined(__GNUC__)
+	return x ? unsigned(__builtin_clzll(x)) : 64u;
+#else
+	unsigned count = 0u;
+	for (uint64_t mask = uint64_t(1) << 63; mask && !(x & mask); mask >>= 1)
+		++count;
+	return count;
+#endif
+}
+
+static unsigned trailing_zeros(uint64_t x) noexcept {
+#if defined(__GNUC__)
+	return x ? unsigned(__builtin_ctzll(x)) : 64u;
+#else
+	unsigned count = 0u;
+	for (uint64_t mask = 1u; mask && !(x & mask); mask <<= 1)
+		++count;
+	return count;
+#endif
+}
+
+void put_varint(std::string& out, uint64_t value) {
+	while (value >= 0x80u) {
+		out.push_back(char(uint8_t(value) | 0x80u));
+		value >>= 7;
+	}
+	out.push_back(char(value));
+}
+
+bool get_varint(std::istream& in, uint64_t& value) {
+	value = 0u;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int c = in.get();
+		if (c == std::char_traits<char>::eof())
+			return false;
+
+		value |= uint64_t(c & 0x7F) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	throw std::logic_error("read varint");
+}
+
+bool get_varint(const char*& data, const char* end, uint64_t& value) {
+	value = 0u;
+	for (int shift = 0; shift < 64 && data < end; shift += 7) {
+		uint8_t c = uint8_t(*data++);
+
+		value |= uint64_t(c & 0x7F) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+void bit_writer::store() {
+	char bytes[8];
+	for (unsigned byte = 0u; byte < 8u; ++byte)
+		bytes[byte] = char(word >> (56u - 8u * byte));
+	out.append(bytes, sizeof(bytes));
+}
+
+void bit_writer::put(uint64_t bits, unsigned count) {
+	if (count == 0u)
+		return;
+	if (count < 64u)
+		bits &= (uint64_t(1) << count) - 1u;
+
+	if (used + count < 64u) {
+		word = (word << count) | bits;
+		used += count;
+		return;
+	}
+
+	// слово заполняется, остаток переходит в следующее
+	unsigned first = 64u - used;
+	unsigned rest = count - first;
+	word = first == 64u ? bits >> rest : (word << first) | (bits >> rest);
+	store();
+
+	word = rest ? bits & ((uint64_t(1) << rest) - 1u) : 0u;
+	used = rest;
+}
+
+void bit_writer::finish() {
+	if (used == 0u)
+		return;
+
+	word <<= 64u - used;
+	for (unsigned byte = 0u; byte < (used + 7u) / 8u; ++byte)
+		out.push_back(char(word >> (56u - 8u * byte)));
+
+	word = 0u;
+	used = 0u;
+}
+
+static uint64_t load_big_endian(const uint8_t* data) noexcept {
+	uint64_t word;
+	memcpy(&word, data, sizeof(word));
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	return __builtin_bswap64(word);
+#else
+	uint64_t output = 0u;
+	for (unsigned byte = 0u; byte < 8u; ++byte)
+		output = (output << 8) | data[byte];
+	return output;
+#endif
+}
+
+// после подкачки доступно не меньше 57 бит; слово читается целиком, а забираются только целые байты -
+// биты следующего байта за available совпадают с теми, что придут при следующей подкачке
+void bit_reader::refill() noexcept {
+	if (end - data >= 8) {
+		bits |= load_big_endian(data) >> available;
+		unsigned bytes = (63u - available) >> 3;
+		data += bytes;
+		available += bytes << 3;
+		return;
+	}
+
+	while (available <= 56u) {
+		if (data < end)
+			bits |= uint64_t(*data++) << (56u - available);
+		available += 8u;
+	}
+}
+
+uint64_t bit_reader::get(unsigned count) noexcept {
+	if (count == 0u)
+		return 0u;
+
+	if (count > 56u) {
+		uint64_t high = get(count - 32u);
+		return (high << 32) | get(32u);
+	}
+
+	if (available < count)
+		refill();
+
+	uint64_t output = bits >> (64u - count);
+	bits <<= count;
+	available -= count;
+	return output;
+}
+
+bool bit_reader::bit() noexcept {
+	if (available == 0u)
+		refill();
+
+	bool output = (bits >> 63) != 0u;
+	bits <<= 1;
+	--available;
+	return output;
+}
+
+// '0' - значение не изменилось; '10' - значащие биты в окне предыдущего значения;
+// '11', 5 бит нулей слева, 6 бит длины - 1, значащие биты - новое окно
+void gorilla_encode(const uint64_t* bits, uint64_t count, std::string& out) {
+	if (count == 0u)
+		return;
+
+	bit_writer writer(out);
+	writer.put(bits[0], 64u);
+
+	uint64_t previous = bits[0];
+	unsigned lead = 64u, trail = 64u;
+
+	for (uint64_t index = 1u; index < count; ++index) {
+		uint64_t x = bits[index] ^ previous;
+		previous = bits[index];
+
+		if (x == 0u) {
+			writer.put(0u, 1u);
+			continue;
+		}
+
+		unsigned l = std::min(leading_zeros(x), 31u);
+		unsigned t = trailing_zeros(x);
+
+		if (lead + trail < 64u && l >= lead && t >= trail) {
+			writer.put(2u, 2u);
+			writer.put(x >> trail, 64u - lead - trail);
+			continue;
+		}
+
+		lead = l;
+		trail = t;
+		unsigned length = 64u - lead - trail;
+		writer.put(3u, 2u);
+		writer.put(lead, 5u);
+		writer.put(length - 1u, 6u);
+		writer.put(x >> trail, length);
+	}
+
+	writer.finish();
+}
+
+// разбор строго последовательный (окно следующего значения зависит от предыдущего),
+// поэтому без векторизации: биты читаются словами, на значение - одна-две выборки окна
+void gorilla_decode(const char* data, uint64_t size, uint64_t* bits, uint64_t count) {
+	if (count == 0u)
+		return;
+
+	bit_reader reader(data, size);
+	uint64_t previous = reader.get(64u);
+	bits[0] = previous;
+
+	unsigned lead = 0u, trail = 0u;
+
+	for (uint64_t index = 1u; index < count; ++index) {
+		if (reader.bit()) {
+			if (reader.bit()) {
+				lead = unsigned(reader.get(5u));
+				trail = 64u - lead - (unsigned(reader.get(6u)) + 1u);
+			}
+			previous ^= reader.get(64u - lead - trail) << trail;
+		}
+		bits[index] = previous;
+	}
+}
+
+// разность второго порядка в zigzag: '0' - ноль, '10' + 7 бит, '110' + 9, '1110' + 12, '1111' + 64
+void dod_encode(const int64_t* values, uint64_t count, std::string& out) {
+	if (count == 0u)
+		return;
+
+	bit_writer writer(out);
+	writer.put(uint64_t(values[0]), 64u);
+
+	int64_t delta = 0;
+	for (uint64_t index = 1u; index < count; ++index) {
+		int64_t next = int64_t(uint64_t(values[index]) - uint64_t(values[index - 1u]));
+		int64_t dod = int64_t(uint64_t(next) - uint64_t(delta));
+		uint64_t z = (uint64_t(dod) << 1) ^ uint64_t(dod >> 63);
+		delta = next;
+
+		if (z == 0u)
+			writer.put(0u, 1u);
+		else if (z < (1u << 7)) {
+			writer.put(2u, 2u);
+			writer.put(z, 7u);
+		}
+		else if (z < (1u << 9)) {
+			writer.put(6u, 3u);
+			writer.put(z, 9u);
+		}
+		else if (z < (1u << 12)) {
+			writer.put(14u, 4u);
+			writer.put(z, 12u);
+		}
+		else {
+			writer.put(15u, 4u);
+			writer.put(z, 64u);
+		}
+	}
+
+	writer.finish();
+}
+
+void dod_decode(const char* data, uint64_t size, int64_t* values, uint64_t count) {
+	if (count == 0u)
+		return;
+
+	bit_reader reader(data, size);
+	values[0] = int64_t(reader.get(64u));
+
+	uint64_t delta = 0u;
+	for (uint64_t index = 1u; index < count; ++index) {
+		uint64_t z = 0u;
+		if (reader.bit()) {
+			if (!reader.bit())
+				z = reader.get(7u);
+			else if (!reader.bit())
+				z = reader.get(9u);
+			else if (!reader.bit())
+				z = reader.get(12u);
+			else
+				z = reader.get(64u);
+		}
+
+		delta += (z >> 1) ^ (0u - (z & 1u));
+		values[index] = int64_t(uint64_t(values[index - 1u]) + delta);
+	}
+}
+
+uint64_t column_bits(double value, column_type type) noexcept {
+	switch (type) {
+	case column_type::float32: {
+		float f = float(value);
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		return bits;
+	}
+	case column_type::float64: {
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+	case column_type::int32:
+		return uint64_t(int64_t(value));
+	}
+	return 0u;
+}
+
+double column_value(uint64_t bits, column_type type) noexcept {
+	switch (type) {
+	case column_type::float32: {
+		uint32_t low = uint32_t(bits);
+		float f;
+		memcpy(&f, &low, sizeof(f));
+		return f;
+	}
+	case column_type::float64: {
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	case column_type::int32:
+		return double(int64_t(bits));
+	}
+	return 0.0;
+}
+
+void encode_column(const double* values, uint64_t stride, uint64_t count, column_type type, std::string& out, unsigned mantissa_bits) {
+	LR5_SCOPE("codec/encode_column");
+	std::vector<uint64_t> bits(count);
+	for (uint64_t row = 0u; row < count; ++row)
+		bits[row] = column_bits(values[row * stride], type);
+
+	// округление мантиссы до ближайшего: младшие биты обнуляются, перенос переходит в порядок
+	if (type == column_type::float64 && mantissa_bits < 52u) {
+		const unsigned drop = 52u - mantissa_bits;
+		const uint64_t half = uint64_t(1) << (drop - 1u);
+		const uint64_t mask = ~((uint64_t(1) << drop) - 1u);
+		const uint64_t exponent = uint64_t(0x7FF) << 52;
+
+		for (auto& b : bits)
+			if ((b & exponent) != exponent)
+				b = (b + half) & mask;
+	}
+
+	std::string chunk;
+	if (type == column_type::int32)
+		dod_encode(reinterpret_cast<const int64_t*>(bits.data()), count, chunk);
+	else
+		gorilla_encode(bits.data(), count, chunk);
+
+	put_varint(out, chunk.size());
+	out += chunk;
+}
+
+void decode_column(const char* data, uint64_t size, column_type type, uint64_t count, double* values) {
+	LR5_SCOPE("codec/decode_column");
+	std::vector<uint64_t> bits(count);
+
+	if (type == column_type::int32)
+		dod_decode(data, size, reinterpret_cast<int64_t*>(bits.data()), count);
+	else
+		gorilla_decode(data, size, bits.data(), count);
+
+	for (uint64_t row = 0u; row < count; ++row)
+		values[row] = column_value(bits[row], type);
+}
+
+void write_encoded_header(std::string& out, const std::vector<result_table::column_info>& columns) {
+	out.append(encoded_magic, sizeof(encoded_magic));
+	put_varint(out, columns.size());
+	for (const auto& info : columns) {
+		put_varint(out, info.name.size());
+		out += info.name;
+		out.push_back(char(info.type));
+	}
+}
+
+std::vector<result_table::column_info> read_encoded_header(std::istream& in) {
+	char magic[sizeof(encoded_magic)];
+	if (!in.read(magic, sizeof(magic)) || memcmp(magic, encoded_magic, sizeof(magic)) != 0)
+		throw std::logic_error("read encoded");
+
+	uint64_t count{};
+	if (!get_varint(in, count))
+		throw std::logic_error("read encoded");
+
+	std::vector<result_table::column_info> columns(count);
+	for (auto& info : columns) {
+		uint64_t size{};
+		char type{};
+		if (!get_varint(in, size))
+			throw std::logic_error("read encoded");
+
+		info.name.resize(size);
+		if (!in.read(&info.name[0], size) || !in.get(type))
+			throw std::logic_error("read encoded");
+		info.type = column_type(type);
+	}
+
+	return columns;
+}
+
+void write_encoded(std::ostream& out, const result_table& table, unsigned mantissa_bits) {
+	std::vector<result_table::column_info> columns;
+	for (uint64_t col = 0u; col < table.cols(); ++col)
+		columns.push_back(table.info(col));
+
+	std::string buffer;
+	write_encoded_header(buffer, columns);
+
+	const uint64_t rows = table.rows();
+	std::vector<double> values(rows);
+
+	if (rows) {
+		put_varint(buffer, rows);
+		for (uint64_t col = 0u; col < table.cols(); ++col) {
+			for (uint64_t row = 0u; row < rows; ++row)
+				values[row] = table.value(row, col);
+			encode_column(values.data(), 1u, rows, columns[col].type, buffer, mantissa_bits);
+		}
+	}
+	put_varint(buffer, 0u);
+
+	out.write(buffer.data(), buffer.size());
+}
+
+void read_encoded(std::istream& in, result_table& table) {
+	std::vector<result_table::column_info> columns = read_encoded_header(in);
+	table = result_table(columns);
+
+	std::string chunk;
+	std::vector<double> values;
+	uint64_t rows{};
+
+	// поток записи, закрытый с ошибкой, может не дописать завершающий блок
+	while (get_varint(in, rows) && rows) {
+		values.resize(rows);
+		table.reserve(table.rows() + rows);
+
+		for (uint64_t col = 0u; col < columns.size(); ++col) {
+			uint64_t size{};
+			if (!get_varint(in, size))
+				throw std::logic_error("read encoded");
+
+			chunk.resize(size);
+			if (size && !in.read(&chunk[0], size))
+				throw std::logic_error("read encoded");
+
+			decode_column(chunk.data(), size, columns[col].type, rows, values.data());
+			for (uint64_t row = 0u; row < rows; ++row)
+				table.append(col, values[row]);
+		}
+	}
+}
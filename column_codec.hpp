@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "result_table.hpp"
+
+// сжатие столбцов траектории: соседние значения гладкого столбца близки.
+// float32/float64 - XOR с предыдущим значением (Gorilla, Pelkonen и др., 2015): совпадающие знак, порядок
+// и старшие биты мантиссы дают длинный ряд нулей слева, пишутся только значащие биты между нулями;
+// int32 (время на равномерной сетке) - разность второго порядка, для шага 60 с это один бит на строку
+
+void put_varint(std::string& out, uint64_t value);
+bool get_varint(std::istream& in, uint64_t& value);
+bool get_varint(const char*& data, const char* end, uint64_t& value);
+
+// биты старшими вперёд, запись и чтение по 64-битным словам
+class bit_writer {
+private:
+	std::string& out;
+	uint64_t word = 0u;
+	unsigned used = 0u;
+
+	void store();
+public:
+	explicit bit_writer(std::string& out) noexcept : out(out) {};
+
+	void put(uint64_t bits, unsigned count);
+	// дописать неполное слово (до целого байта)
+	void finish();
+};
+
+// непрочитанные биты - в старших разрядах bits, подкачка по 8 байт; за концом данных - нули
+class bit_reader {
+private:
+	const uint8_t* data;
+	const uint8_t* end;
+	uint64_t bits = 0u;
+	unsigned available = 0u;
+
+	void refill() noexcept;
+public:
+	bit_reader(const char* data, uint64_t size) noexcept :
+		data(reinterpret_cast<const uint8_t*>(data)), end(reinterpret_cast<const uint8_t*>(data) + size) {};
+
+	uint64_t get(unsigned count) noexcept;
+	bool bit() noexcept;
+};
+
+// bits - двоичные представления значений; count значений
+void gorilla_encode(const uint64_t* bits, uint64_t count, std::string& out);
+void gorilla_decode(const char* data, uint64_t size, uint64_t* bits, uint64_t count);
+
+void dod_encode(const int64_t* values, uint64_t count, std::string& out);
+void dod_decode(const char* data, uint64_t size, int64_t* values, uint64_t count);
+
+// значение столбца как целое: двоичное представление для float32/float64, само число для int32
+uint64_t column_bits(double value, column_type type) noexcept;
+double column_value(uint64_t bits, column_type type) noexcept;
+
+// столбец count значений с шагом stride: длина в varint и сжатые данные.
+// mantissa_bits < 52 - мантисса float64 округляется до mantissa_bits бит (с потерей точности)
+void encode_column(const double* values, uint64_t stride, uint64_t count, column_type type, std::string& out, unsigned mantissa_bits = 52u);
+// сжатые данные столбца без длины
+void decode_column(const char* data, uint64_t size, column_type type, uint64_t count, double* values);
+
+// поток сжатых блоков: сигнатура, столбцы (имя и тип); блок - число строк и столбцы подряд, блок из 0 строк - конец
+void write_encoded_header(std::string& out, const std::vector<result_table::column_info>& columns);
+std::vector<result_table::column_info> read_encoded_header(std::istream& in);
+void write_encoded(std::ostream& out, const result_table& table, unsigned mantissa_bits = 52u);
+void read_encoded(std::istream& in, result_table& table);
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <math.h>
+
+// точная сумма a + b = s + e (TwoSum, Кнут)
+template<typename T>
+inline void two_sum(T a, T b, T& s, T& e) noexcept {
+	s = a + b;
+	T bb = s - a;
+	e = (a - (s - bb)) + (b - bb);
+}
+
+// сумма с компенсацией ошибки округления
+template<typename T>
+struct compensated {
+	T sum = 0;
+	T err = 0;
+
+	compensated() noexcept {};
+	compensated(T value) noexcept : sum(value) {};
+
+	compensated& operator+=(T value) noexcept {
+		T e;
+		two_sum(sum, value + err, sum, e);
+		err = e;
+		return *this;
+	}
+
+	T value() const noexcept { return sum + err; };
+};
+
+// момент времени в виде (сутки, секунды от начала суток):
+// секунды остаются малыми, поэтому шаги по времени не теряются на фоне 2.1e11 с
+template<typename T>
+struct split_epoch {
+	int64_t day = 0;
+	compensated<T> seconds;
+
+	static split_epoch from_seconds(T t) noexcept {
+		split_epoch output;
+		output.day = int64_t(floor(t / 86400));
+		output.seconds = compensated<T>(t - T(output.day) * 86400);
+		output.normalize();
+		return output;
+	}
+
+	void normalize() noexcept {
+		while (seconds.sum >= 86400) {
+			seconds.sum -= 86400;
+			++day;
+		}
+		while (seconds.sum < 0) {
+			seconds.sum += 86400;
+			--day;
+		}
+	}
+
+	split_epoch& operator+=(T dt) noexcept {
+		seconds += dt;
+		normalize();
+		return *this;
+	}
+
+	// разность в секундах
+	T operator-(const split_epoch& other) const noexcept {
+		return T(day - other.day) * 86400 + (seconds.sum - other.seconds.sum) + (seconds.err - other.seconds.err);
+	}
+
+	T to_seconds() const noexcept { return T(day) * 86400 + seconds.value(); };
+};
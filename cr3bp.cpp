@@ -0,0 +1,326 @@
+#include <atomic>
+#include <thread>
+#include "cr3bp.hpp"
+#include "fnv_hash.hpp"
+#include "integrator.hpp"
+
+template<typename T>
+static Vector<T> with_identity(const Vector<T>& x0, bool stm) {
+	if (x0.dimension() != 6u)
+		throw std::logic_error("cr3bp state");
+
+	if (!stm)
+		return x0;
+
+	Vector<T> output(42);
+	for (uint64_t count = 0u; count < 6u; ++count) {
+		output.at(count) = x0.at(count);
+		output.at(6 + count * 7) = 1;
+	}
+	return output;
+}
+
+template<typename T>
+cr3bp_model<T>::cr3bp_model(T mu, const Vector<T>& x0, T t0, T t1, T inc, bool with_stm) :
+	model_t<T>(with_identity(x0, with_stm), t0, t1, inc), mu(mu), stm(with_stm), next_sample(t0 + inc), jacobi0(jacobi(mu, x0)) {
+	// μ не входит в начальное состояние: его хэш - часть ключа кэша траекторий
+	uint64_t hash = fnv_offset;
+	hash_value(hash, mu);
+	id = std::string(stm ? "cr3bp3d_stm_" : "cr3bp3d_") + hash_hex(hash);
+
+	this->res = result_table({
+		{ "t", column_type::float64 },
+		{ "x", column_type::float64 },
+		{ "y", column_type::float64 },
+		{ "z", column_type::float64 },
+		{ "vx", column_type::float64 },
+		{ "vy", column_type::float64 },
+		{ "vz", column_type::float64 },
+		{ "jacobi", column_type::float64 },
+	});
+};
+
+template<typename T>
+T cr3bp_model<T>::jacobi(T mu, const Vector<T>& X) {
+	T x = X.at(0), y = X.at(1), z = X.at(2);
+	T r1 = sqrt((x + mu) * (x + mu) + y * y + z * z);
+	T r2 = sqrt((x - 1 + mu) * (x - 1 + mu) + y * y + z * z);
+	T v2 = X.at(3) * X.at(3) + X.at(4) * X.at(4) + X.at(5) * X.at(5);
+
+	return x * x + y * y + 2 * (1 - mu) / r1 + 2 * mu / r2 - v2;
+}
+
+template<typename T>
+void cr3bp_model<T>::add_segment(const dense_segment<T>& segment) {
+	LR5_SCOPE("cr3bp3d/add_segment");
+	T a = segment.t0.to_seconds();
+	T b = a + segment.h;
+	split_epoch<T> end = segment.t0;
+	end += segment.h;
+	Vector<T> xb = segment.state(end);
+
+	drift = std::max<T>(drift, abs(jacobi(xb) - jacobi0));
+
+	// пересечение y = 0 уточняется методом Иллинойса по плотной выдаче шага
+	T ya = segment.x0.at(1), yb = xb.at(1);
+	if (crossing_limit && ya * yb < 0 && ++crossings == crossing_limit) {
+		T lo = a, hi = b, y_lo = ya, y_hi = yb;
+		int side = 0;
+
+		for (int iteration = 0; iteration < 60 && hi - lo > 1e-15l * std::max<T>(1, abs(hi)); ++iteration) {
+			T tc = (lo * y_hi - hi * y_lo) / (y_hi - y_lo);
+			T yc = segment.state(tc).at(1);
+			if (yc == 0) {
+				lo = hi = tc;
+				break;
+			}
+
+			if ((yc < 0) == (y_lo < 0)) {
+				lo = tc;
+				y_lo = yc;
+				if (side == -1)
+					y_hi /= 2;
+				side = -1;
+			}
+			else {
+				hi = tc;
+				y_hi = yc;
+				if (side == 1)
+					y_lo /= 2;
+				side = 1;
+			}
+		}
+
+		event_time = abs(y_lo) < abs(y_hi) ? lo : hi;
+		event_state = segment.state(event_time);
+		stopped = true;
+		b = event_time;
+	}
+
+	if (this->sample_inc <= 0)
+		return;
+
+	for (; next_sample <= b; next_sample += this->sample_inc) {
+		Vector<T> X = segment.state(next_sample);
+		this->res.append(0, next_sample);
+		for (uint64_t count = 0u; count < 6u; ++count)
+			this->res.append(1 + count, X.at(count));
+		this->res.append(7, jacobi(X));
+	}
+}
+
+template<typename T>
+void cr3bp_model<T>::reset_observer() {
+	model_t<T>::reset_observer();
+	next_sample = this->get_t0() + this->get_step();
+	crossings = 0u;
+	stopped = false;
+	event_time = 0;
+	event_state = Vector<T>();
+	drift = 0;
+}
+
+template<typename T>
+void cr3bp_model<T>::save_state(std::ostream& out) const {
+	write_binary(out, next_sample);
+	write_binary(out, crossings);
+	write_binary(out, stopped);
+	write_binary(out, event_time);
+	write_binary(out, event_state);
+	write_binary(out, drift);
+
+	model_t<T>::save_state(out);
+}
+
+template<typename T>
+void cr3bp_model<T>::load_state(std::istream& in) {
+	read_binary(in, next_sample);
+	read_binary(in, crossings);
+	read_binary(in, stopped);
+	read_binary(in, event_time);
+	read_binary(in, event_state);
+	read_binary(in, drift);
+
+	model_t<T>::load_state(in);
+}
+
+template<typename T>
+Vector<T> cr3bp_model<T>::get_right(const Vector<T>& X, T) const {
+	LR5_SCOPE("cr3bp3d/get_right");
+	Vector<T> dX(X.dimension());
+
+	T x = X.at(0), y = X.at(1), z = X.at(2);
+	T mu_ = 1 - mu;
+	T dx1 = x + mu, dx2 = x - mu_;
+	T r1_2 = dx1 * dx1 + y * y + z * z;
+	T r2_2 = dx2 * dx2 + y * y + z * z;
+	T k1 = mu_ / (r1_2 * sqrt(r1_2));
+	T k2 = mu / (r2_2 * sqrt(r2_2));
+
+	dX.at(0) = X.at(3);
+	dX.at(1) = X.at(4);
+	dX.at(2) = X.at(5);
+	dX.at(3) = x + 2 * X.at(4) - k1 * dx1 - k2 * dx2;
+	dX.at(4) = y - 2 * X.at(3) - (k1 + k2) * y;
+	dX.at(5) = -(k1 + k2) * z;
+
+	if (!stm)
+		return dX;
+
+	// dΦ/dt = A Φ, A = [0 I; U 2J]: U - вторые производные Ω, J = [0 1 0; -1 0 0; 0 0 0]
+	T q1 = 3 * k1 / r1_2, q2 = 3 * k2 / r2_2;
+	T Uxx = 1 - k1 - k2 + q1 * dx1 * dx1 + q2 * dx2 * dx2;
+	T Uyy = 1 - k1 - k2 + (q1 + q2) * y * y;
+	T Uzz = -k1 - k2 + (q1 + q2) * z * z;
+	T Uxy = (q1 * dx1 + q2 * dx2) * y;
+	T Uxz = (q1 * dx1 + q2 * dx2) * z;
+	T Uyz = (q1 + q2) * y * z;
+
+	const T* Φ = X.data() + 6;
+	T* dΦ = dX.data() + 6;
+
+	for (uint64_t col = 0u; col < 6u; ++col) {
+		T p0 = Φ[col], p1 = Φ[6 + col], p2 = Φ[12 + col];
+		T p3 = Φ[18 + col], p4 = Φ[24 + col], p5 = Φ[30 + col];
+
+		dΦ[col] = p3;
+		dΦ[6 + col] = p4;
+		dΦ[12 + col] = p5;
+		dΦ[18 + col] = Uxx * p0 + Uxy * p1 + Uxz * p2 + 2 * p4;
+		dΦ[24 + col] = Uxy * p0 + Uyy * p1 + Uyz * p2 - 2 * p3;
+		dΦ[30 + col] = Uxz * p0 + Uyz * p1 + Uzz * p2;
+	}
+
+	return dX;
+}
+
+template<typename T>
+bool periodic_orbit_solver<T>::half_period(const Vector<T>& x0, Vector<T>& xf, T& t, T& drift) const {
+	cr3bp_model<T> model(mu, x0, 0, max_time, 0, true);
+	model.stop_at_crossing(1u);
+
+	DormandPrinceIntegrator<T> integrator(eps);
+	integrator.run(model);
+
+	if (!model.finished())
+		return false;
+
+	xf = model.get_event_state();
+	t = model.get_event_time();
+	drift = model.jacobi_drift();
+	return true;
+}
+
+template<typename T>
+periodic_orbit<T> periodic_orbit_solver<T>::correct(orbit_family family, const Vector<T>& guess) const {
+	LR5_SCOPE("cr3bp3d/correct");
+	periodic_orbit<T> orbit;
+	orbit.x0 = Vector<T>({ guess.at(0), 0, guess.at(2), 0, guess.at(4), 0 });
+
+	if (family == orbit_family::lyapunov)
+		orbit.x0.at(2) = 0;
+
+	cr3bp_model<T> rhs(mu, orbit.x0, 0, 0, 0);
+	Vector<T> xf;
+	T t{};
+
+	for (orbit.iterations = 0u; orbit.iterations < max_iterations; ++orbit.iterations) {
+		if (!half_period(orbit.x0, xf, t, orbit.drift))
+			break;
+
+		orbit.residual = abs(xf.at(3)) + abs(xf.at(5));
+		if (orbit.residual < tolerance) {
+			orbit.converged = true;
+			break;
+		}
+
+		// Φ(i, j) = xf.at(6 + 6 i + j); время пересечения тоже зависит от x0: δt = -δy / vy
+		Vector<T> f = rhs.get_right(Vector<T>({ xf.at(0), xf.at(1), xf.at(2), xf.at(3), xf.at(4), xf.at(5) }), t);
+		T ax = f.at(3) / xf.at(4), az = f.at(5) / xf.at(4);
+		auto Φ = [&](uint64_t row, uint64_t col) { return xf.at(6 + 6 * row + col); };
+
+		if (family == orbit_family::lyapunov) {
+			T d = Φ(3, 4) - ax * Φ(1, 4);
+			orbit.x0.at(4) -= xf.at(3) / d;
+		}
+		else {
+			T m00 = Φ(3, 0) - ax * Φ(1, 0), m01 = Φ(3, 4) - ax * Φ(1, 4);
+			T m10 = Φ(5, 0) - az * Φ(1, 0), m11 = Φ(5, 4) - az * Φ(1, 4);
+			T det = m00 * m11 - m01 * m10;
+
+			if (det == 0)
+				break;
+
+			orbit.x0.at(0) -= (m11 * xf.at(3) - m01 * xf.at(5)) / det;
+			orbit.x0.at(4) -= (m00 * xf.at(5) - m10 * xf.at(3)) / det;
+		}
+		LR5_COUNT("cr3bp3d/corrections", 1u);
+	}
+
+	orbit.period = 2 * t;
+	orbit.jacobi = cr3bp_model<T>::jacobi(mu, orbit.x0);
+	return orbit;
+}
+
+template<typename T>
+std::vector<periodic_orbit<T>> periodic_orbit_solver<T>::correct(orbit_family family, const std::vector<Vector<T>>& guesses) const {
+	std::vector<periodic_orbit<T>> output(guesses.size());
+	std::atomic<uint64_t> next{ 0u };
+
+	// задачи раздаются по одной: время коррекции сильно зависит от начального приближения
+	auto worker = [&] {
+		for (uint64_t index = next++; index < guesses.size(); index = next++)
+			output[index] = correct(family, guesses[index]);
+	};
+
+	std::vector<std::thread> workers;
+	for (uint64_t count = 1u; count < std::min<uint64_t>(threads, guesses.size()); ++count)
+		workers.emplace_back(worker);
+
+	worker();
+
+	for (auto& thread : workers)
+		thread.join();
+
+	return output;
+}
+
+template<typename T>
+std::vector<periodic_orbit<T>> periodic_orbit_solver<T>::continuation(orbit_family family, const periodic_orbit<T>& start, T step, uint64_t count) const {
+	LR5_SCOPE("cr3bp3d/continuation");
+	// параметр семейства фиксируется при коррекции, подбираемые компоненты экстраполируются
+	const uint64_t parameter = family == orbit_family::lyapunov ? 0u : 2u;
+	std::vector<periodic_orbit<T>> output{ start };
+	T h = step;
+	int halvings = 0;
+
+	while (output.size() < count) {
+		const periodic_orbit<T>& last = output.back();
+		Vector<T> guess = last.x0;
+
+		if (output.size() >= 2u) {
+			const periodic_orbit<T>& prev = output[output.size() - 2u];
+			T ratio = h / (last.x0.at(parameter) - prev.x0.at(parameter));
+			guess = last.x0 + (last.x0 - prev.x0) * ratio;
+		}
+		guess.at(parameter) = last.x0.at(parameter) + h;
+
+		periodic_orbit<T> orbit = correct(family, guess);
+
+		if (orbit.converged) {
+			output.push_back(orbit);
+			continue;
+		}
+
+		if (++halvings > 4)
+			break;
+		h /= 2;
+	}
+
+	return output;
+}
+
+template class cr3bp_model<double>;
+template class cr3bp_model<long double>;
+template class periodic_orbit_solver<double>;
+template class periodic_orbit_solver<long double>;
@@ -0,0 +1,93 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "model.hpp"
+
+// пространственная круговая ограниченная задача трёх тел во вращающейся системе
+// (безразмерные единицы: расстояние между телами, их суммарная масса, период / 2π):
+// состояние (x, y, z, vx, vy, vz), с матрицей чувствительности - ещё 36 элементов Φ по строкам
+template<typename T>
+class cr3bp_model : public model_t<T> {
+protected:
+	T mu;
+	bool stm;
+	std::string id;
+
+	// выдача на сетке sample_inc по плотной выдаче шага (sample_inc <= 0 - без выдачи)
+	T next_sample;
+	// останов на crossing_limit-м пересечении плоскости y = 0 (0 - до t1)
+	uint64_t crossing_limit = 0u;
+	uint64_t crossings = 0u;
+	bool stopped = false;
+	T event_time = 0;
+	Vector<T> event_state;
+	T jacobi0, drift = 0;
+public:
+	cr3bp_model(T mu, const Vector<T>& x0, T t0, T t1, T inc, bool with_stm = false);
+
+	// интеграл Якоби C = 2Ω - v^2, Ω = (x^2 + y^2) / 2 + (1 - μ) / r1 + μ / r2
+	static T jacobi(T mu, const Vector<T>& X);
+	T jacobi(const Vector<T>& X) const { return jacobi(mu, X); };
+	// наибольшее отклонение C от начального по концам принятых шагов
+	T jacobi_drift() const noexcept { return drift; };
+	T get_mu() const noexcept { return mu; };
+
+	void stop_at_crossing(uint64_t count) noexcept { crossing_limit = count; this->invalidate_observer(); };
+	uint64_t crossing_count() const noexcept { return crossings; };
+	T get_event_time() const noexcept { return event_time; };
+	const Vector<T>& get_event_state() const noexcept { return event_state; };
+
+	bool uniform_output() const noexcept override { return false; };
+	void add_segment(const dense_segment<T>& segment) override;
+	bool finished() const noexcept override { return stopped; };
+	void reset_observer() override;
+
+	void save_state(std::ostream& out) const override;
+	void load_state(std::istream& in) override;
+
+	Vector<T> get_right(const Vector<T>& X, T t) const override;
+	const char* rhs_id() const noexcept override { return id.c_str(); };
+};
+
+enum class orbit_family : uint8_t {
+	lyapunov, // плоская: x0 фиксирован, подбирается vy0
+	halo, // пространственная: z0 фиксирован, подбираются x0 и vy0
+};
+
+// периодическая орбита, симметричная относительно плоскости y = 0: x0 = (x, 0, z, 0, vy, 0)
+template<typename T>
+struct periodic_orbit {
+	Vector<T> x0;
+	T period = 0;
+	T jacobi = 0;
+	T residual = 0; // |vx| + |vz| на полупериоде
+	T drift = 0; // отклонение интеграла Якоби на полупериоде
+	uint64_t iterations = 0u;
+	bool converged = false;
+};
+
+// дифференциальная коррекция (метод стрельбы) по матрице чувствительности на полупериоде:
+// на втором пересечении y = 0 симметричная орбита пересекает плоскость перпендикулярно, vx = vz = 0
+template<typename T>
+class periodic_orbit_solver {
+protected:
+	T mu, eps, tolerance;
+	T max_time = 10;
+	uint64_t max_iterations = 30u;
+	uint64_t threads = 1u;
+
+	// от x0 до пересечения y = 0 с матрицей Φ; false - пересечения нет до max_time
+	bool half_period(const Vector<T>& x0, Vector<T>& xf, T& t, T& drift) const;
+public:
+	periodic_orbit_solver(T mu, T eps = 1e-12l, T tolerance = 1e-10l) : mu(mu), eps(eps), tolerance(tolerance) {};
+
+	void set_threads(uint64_t count) noexcept { threads = count ? count : 1u; };
+	void set_limits(uint64_t iterations, T time) noexcept { max_iterations = iterations; max_time = time; };
+
+	periodic_orbit<T> correct(orbit_family family, const Vector<T>& guess) const;
+	// независимые начальные приближения решаются параллельно, у каждого потока свои модель и интегратор
+	std::vector<periodic_orbit<T>> correct(orbit_family family, const std::vector<Vector<T>>& guesses) const;
+	// продолжение по параметру (x0 для lyapunov, z0 для halo) с секущей по двум последним орбитам;
+	// при неудаче шаг делится пополам, после 4 делений семейство обрывается
+	std::vector<periodic_orbit<T>> continuation(orbit_family family, const periodic_orbit<T>& start, T step, uint64_t count) const;
+};
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <iomanip>
+#include "daylight_stats.hpp"
+#include "funcm.hpp"
+
+// номер дня в году последнего воскресенья месяца
+static int last_sunday(int year, int month) {
+	int days_in_month[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	if ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)
+		days_in_month[1] = 29;
+
+	int last = days_in_month[month - 1];
+	// JDN + 1 по модулю 7: 0 - воскресенье
+	int weekday = int(get_JDN(year, month, last, 12, 0, 0) + 1.0) % 7;
+
+	int day_of_year = last - weekday;
+	for (int count = 0; count < month - 1; ++count)
+		day_of_year += days_in_month[count];
+	return day_of_year;
+}
+
+dst_rule dst_rule::eu(int year, double shift_hours) noexcept {
+	return days(last_sunday(year, 3), last_sunday(year, 10) - 1, shift_hours);
+}
+
+void usable_summary::part::add(int day, double value) noexcept {
+	if (days == 0 || value < min) {
+		min = value;
+		min_day = day;
+	}
+	if (days == 0 || value > max) {
+		max = value;
+		max_day = day;
+	}
+	if (value <= 0.0)
+		++dark_days;
+
+	++days;
+	total += value;
+}
+
+daylight_stats::daylight_stats(const std::vector<daylight_scenario>& scenarios) : scenarios(scenarios), summaries(scenarios.size()) {
+	current.usable.resize(scenarios.size());
+}
+
+void daylight_stats::clear() {
+	summaries.assign(scenarios.size(), usable_summary());
+	daylight = usable_summary::part();
+	current = day_record();
+	current.usable.resize(scenarios.size());
+	day = 0;
+}
+
+void daylight_stats::add_day(int day_of_year, double sunrise, double sunset) {
+	++day;
+
+	current.day = day_of_year;
+	current.sunrise = sunrise;
+	current.sunset = sunset;
+	current.daylight = sunset - sunrise;
+	daylight.add(day_of_year, current.daylight);
+
+	// min(заход, конец окна) - max(восход, начало окна) в сдвинутом времени
+	for (uint64_t count = 0u; count < scenarios.size(); ++count) {
+		const daylight_scenario& scenario = scenarios[count];
+		double shift = scenario.dst.offset(day_of_year);
+		double usable = std::max(0.0, std::min(sunset + shift, scenario.window.end) - std::max(sunrise + shift, scenario.window.begin));
+
+		current.usable[count] = usable;
+		summaries[count].year.add(day_of_year, usable);
+		if (scenario.dst.active(day_of_year))
+			summaries[count].summer.add(day_of_year, usable);
+		else
+			summaries[count].winter.add(day_of_year, usable);
+	}
+
+	if (observer)
+		observer(current);
+}
+
+void daylight_stats::report(std::ostream& out) const {
+	std::ios state(nullptr);
+	state.copyfmt(out);
+
+	out << std::fixed << std::setprecision(2);
+	out << "Days: " << day << ", daylight mean " << daylight.mean() / 3600.0 << " h, min " << daylight.min / 3600.0
+		<< " h (day " << daylight.min_day << "), max " << daylight.max / 3600.0 << " h (day " << daylight.max_day << ")" << '\n';
+
+	for (uint64_t count = 0u; count < scenarios.size(); ++count) {
+		const usable_summary& summary = summaries[count];
+		out << std::left << std::setw(16) << scenarios[count].name << std::right
+			<< " usable " << std::setw(8) << summary.year.total / 3600.0 << " h/year, "
+			<< std::setw(5) << summary.year.mean() / 3600.0 << " h/day";
+		if (summary.summer.days && summary.winter.days)
+			out << " (summer " << summary.summer.mean() / 3600.0 << ", winter " << summary.winter.mean() / 3600.0 << ")";
+		out << ", min " << summary.year.min / 3600.0 << " h (day " << summary.year.min_day << ")" << '\n';
+	}
+
+	out.copyfmt(state);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// окно полезного освещения по местному времени, с от начала суток
+struct light_window {
+	double begin = 8.0 * 3600.0;
+	double end = 20.0 * 3600.0;
+};
+
+// правило перехода на летнее время: в дни [first_day, last_day] (номер дня в году с 1) часы сдвигаются на shift
+struct dst_rule {
+	int first_day = 1;
+	int last_day = 0;
+	double shift = 0.0;
+
+	static dst_rule none() noexcept { return {}; };
+	static dst_rule all_year(double shift_hours) noexcept { return { 1, 366, shift_hours * 3600.0 }; };
+	static dst_rule days(int first_day, int last_day, double shift_hours) noexcept { return { first_day, last_day, shift_hours * 3600.0 }; };
+	// европейское: с последнего воскресенья марта по последнее воскресенье октября
+	static dst_rule eu(int year, double shift_hours = 1.0) noexcept;
+
+	bool active(int day) const noexcept { return day >= first_day && day <= last_day; };
+	double offset(int day) const noexcept { return active(day) ? shift : 0.0; };
+};
+
+struct daylight_scenario {
+	std::string name;
+	light_window window;
+	dst_rule dst;
+};
+
+struct day_record {
+	int day; // номер дня в году по местной дате захода
+	double sunrise;
+	double sunset;
+	double daylight;
+	// полезные часы по каждому сценарию, с
+	std::vector<double> usable;
+};
+
+// накопитель по сценарию: всё время, летнее время (правило действует) и зимнее
+struct usable_summary {
+	struct part {
+		int days = 0;
+		double total = 0.0;
+		double min = 0.0;
+		double max = 0.0;
+		int min_day = 0;
+		int max_day = 0;
+		int dark_days = 0;
+
+		void add(int day, double value) noexcept;
+		double mean() const noexcept { return days ? total / days : 0.0; };
+	};
+
+	part year;
+	part summer;
+	part winter;
+};
+
+// статистика светового дня по событиям восхода и захода, поступающим по одному дню;
+// хранятся только накопители, записи по дням отдаются наблюдателю
+class daylight_stats {
+private:
+	std::vector<daylight_scenario> scenarios;
+	std::vector<usable_summary> summaries;
+	usable_summary::part daylight;
+	std::function<void(const day_record&)> observer;
+	day_record current;
+	int day = 0;
+public:
+	daylight_stats(const std::vector<daylight_scenario>& scenarios);
+
+	void set_observer(std::function<void(const day_record&)> callback) { observer = std::move(callback); };
+	// day_of_year - календарный номер дня (с 1): по нему выбирается правило летнего времени,
+	// поэтому расчёт может начинаться не с 1 января, а дни без восхода и захода - пропускаться
+	void add_day(int day_of_year, double sunrise, double sunset);
+	// к началу: накопители и счёт дней, сценарии и наблюдатель остаются
+	void clear();
+
+	// число полученных дней
+	int days() const noexcept { return day; };
+	const usable_summary::part& daylight_summary() const noexcept { return daylight; };
+	const usable_summary& summary(uint64_t scenario) const { return summaries.at(scenario); };
+	const daylight_scenario& scenario(uint64_t index) const { return scenarios.at(index); };
+	uint64_t scenario_count() const noexcept { return scenarios.size(); };
+
+	void report(std::ostream& out) const;
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <iostream>
+#include "vector.hpp"
+#include "compensated.hpp"
+
+// принятый шаг вместе с коэффициентами плотной выдачи
+template<typename T>
+struct dense_segment {
+	split_epoch<T> t0;
+	T h;
+	Vector<T> x0;
+	Vector<Vector<T>> k;
+
+	Vector<T> state(const split_epoch<T>& t) const;
+	Vector<T> state(T t) const { return state(split_epoch<T>::from_seconds(t)); };
+	bool contains(T t) const { T dt = split_epoch<T>::from_seconds(t) - t0; return dt >= 0 && dt <= h; };
+};
+
+template<typename T> void write_binary(std::ostream& out, const dense_segment<T>& segment);
+template<typename T> void read_binary(std::istream& in, dense_segment<T>& segment);
@@ -0,0 +1,166 @@
+#include "dense_trajectory.hpp"
+
+template<typename T>
+dense_trajectory<T>::dense_trajectory(DormandPrinceIntegrator<T>& integrator, model_t<T>& system, const step_state<T>& state) :
+	integrator(&integrator), system(&system), tail(state), dim(state.x0.dimension()), first(state.t0) {
+}
+
+template<typename T>
+void dense_trajectory<T>::append(const dense_segment<T>& segment) {
+	starts.push_back(segment.t0);
+	steps.push_back(segment.h);
+
+	const uint64_t base = coeffs.size();
+	coeffs.resize(base + powers * dim);
+	T* c = coeffs.data() + base;
+
+	const T* k[6];
+	for (uint64_t stage = 0u; stage < 6u; ++stage)
+		k[stage] = segment.k.data()[stage].data();
+
+	// коэффициенты при θ^2, θ^3, θ^4 в d0, d2, d3, d4, d5 (d1 = 0)
+	T weight[3][6];
+	for (uint64_t power = 0u; power < 3u; ++power)
+		for (uint64_t stage = 0u; stage < 6u; ++stage)
+			weight[power][stage] = T(dormand_prince<T>::power(power, stage));
+
+	for (uint64_t count = 0u; count < dim; ++count) {
+		c[count] = segment.x0.data()[count];
+		c[dim + count] = segment.h * k[0][count];
+		for (uint64_t power = 0u; power < 3u; ++power) {
+			T sum = weight[power][0] * k[0][count];
+			for (uint64_t stage = 2u; stage < 6u; ++stage)
+				sum += weight[power][stage] * k[stage][count];
+			c[(power + 2u) * dim + count] = segment.h * sum;
+		}
+	}
+}
+
+template<typename T>
+uint64_t dense_trajectory<T>::find(const split_epoch<T>& t, uint64_t hint) const noexcept {
+	// запросы по возрастанию чаще всего попадают в тот же или следующий шаг
+	if (hint < starts.size() && t - starts[hint] >= 0) {
+		if (hint + 1u == starts.size() || t - starts[hint + 1u] < 0)
+			return hint;
+		if (hint + 2u == starts.size() || t - starts[hint + 2u] < 0)
+			return hint + 1u;
+	}
+
+	uint64_t low = 0u, high = starts.size();
+	while (high - low > 1u) {
+		uint64_t middle = low + (high - low) / 2u;
+		if (t - starts[middle] >= 0)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+template<typename T>
+void dense_trajectory<T>::evaluate(uint64_t index, const split_epoch<T>& t, T* out) const noexcept {
+	const T theta = (t - starts[index]) / steps[index];
+	const T* c0 = coeffs.data() + index * powers * dim;
+	const T* c1 = c0 + dim, * c2 = c1 + dim, * c3 = c2 + dim, * c4 = c3 + dim;
+
+	// x0 прибавляется последним: поправка мала на фоне |x0| ~ 1e11
+	for (uint64_t count = 0u; count < dim; ++count)
+		out[count] = c0[count] + theta * (c1[count] + theta * (c2[count] + theta * (c3[count] + theta * c4[count])));
+}
+
+template<typename T>
+void dense_trajectory<T>::prepare(const split_epoch<T>& t) {
+	if (t - first < 0)
+		throw std::logic_error("trajectory before t0");
+
+	if (t - tail.t0 > 0 || starts.empty())
+		extend(t.to_seconds());
+	if (starts.empty())
+		throw std::logic_error("trajectory empty");
+}
+
+template<typename T>
+void dense_trajectory<T>::extend(T t) {
+	split_epoch<T> target = split_epoch<T>::from_seconds(t);
+	if (starts.empty()) {
+		// первое продолжение - хотя бы до t1 модели
+		split_epoch<T> horizon = split_epoch<T>::from_seconds(system->get_t1());
+		if (horizon - target > 0)
+			target = horizon;
+	}
+	if (target - tail.t0 <= 0)
+		return;
+
+	LR5_SCOPE("trajectory/extend");
+
+	// горизонт растёт геометрически: для запросов, уходящих вперёд понемногу, продолжений O(log)
+	split_epoch<T> grown = tail.t0;
+	grown += tail.t0 - first;
+	if (grown - target > 0)
+		target = grown;
+
+	// интегрирование идёт по копии: при исключении траектория остаётся прежней
+	step_state<T> next = tail;
+	const T t1 = system->get_t1();
+	system->set_t1(target.to_seconds());
+	try {
+		integrator->integrate(*system, next, &pending, false);
+	}
+	catch (...) {
+		system->set_t1(t1);
+		pending.clear();
+		throw;
+	}
+	system->set_t1(t1);
+
+	starts.reserve(starts.size() + pending.size());
+	steps.reserve(steps.size() + pending.size());
+	coeffs.reserve(coeffs.size() + pending.size() * powers * dim);
+	for (const dense_segment<T>& segment : pending)
+		append(segment);
+	pending.clear();
+	tail = std::move(next);
+}
+
+template<typename T>
+Vector<T> dense_trajectory<T>::state(T t) {
+	return state(split_epoch<T>::from_seconds(t));
+}
+
+template<typename T>
+Vector<T> dense_trajectory<T>::state(const split_epoch<T>& t) {
+	prepare(t);
+	Vector<T> output(dim);
+	evaluate(find(t, starts.size()), t, output.data());
+	return output;
+}
+
+template<typename T>
+void dense_trajectory<T>::state(const T* t, uint64_t count, T* out) {
+	LR5_SCOPE("trajectory/state");
+	if (!count)
+		return;
+
+	// продолжение - один раз, до самого позднего момента
+	split_epoch<T> earliest = split_epoch<T>::from_seconds(t[0]), latest = earliest;
+	for (uint64_t index = 1u; index < count; ++index) {
+		split_epoch<T> epoch = split_epoch<T>::from_seconds(t[index]);
+		if (epoch - latest > 0)
+			latest = epoch;
+		if (epoch - earliest < 0)
+			earliest = epoch;
+	}
+	prepare(earliest);
+	prepare(latest);
+
+	uint64_t hint = 0u;
+	for (uint64_t index = 0u; index < count; ++index) {
+		split_epoch<T> epoch = split_epoch<T>::from_seconds(t[index]);
+		hint = find(epoch, hint);
+		evaluate(hint, epoch, out + index * dim);
+	}
+}
+
+template class dense_trajectory<double>;
+template class dense_trajectory<long double>;
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include "integrator.hpp"
+
+// траектория как функция времени: хранятся только принятые шаги и коэффициенты их плотной выдачи.
+// Формула Дормана - Принса x0 + h * sum_j d_j(θ) k_j приводится к многочлену по степеням θ:
+// x(θ) = x0 + θ (c1 + θ (c2 + θ (c3 + θ c4))), θ = (t - t0) / h; коэффициенты лежат по [шаг][степень][компонента].
+// Запрос - двоичный поиск шага и схема Горнера; память - 5 векторов состояния на шаг, сетка выдачи не нужна.
+// Траектория создаётся пустой: первый запрос интегрирует хотя бы до t1 модели, запрос за концом
+// продолжает интегрирование (горизонт растёт не меньше чем вдвое).
+// integrator и system не принадлежат траектории: оба должны жить дольше неё (и её копий), а integrator
+// не должен в это время считать в другом потоке - продолжение идёт его рабочими векторами и временно меняет t1 модели
+template<typename T>
+class dense_trajectory {
+public:
+	static constexpr uint64_t powers = 5u;
+private:
+	DormandPrinceIntegrator<T>* integrator;
+	model_t<T>* system;
+	step_state<T> tail; // состояние в конце последнего шага, с него продолжается интегрирование; меняется только после успешного продолжения
+	uint64_t dim;
+
+	split_epoch<T> first;
+	std::vector<split_epoch<T>> starts;
+	std::vector<T> steps;
+	std::vector<T> coeffs;
+	std::vector<dense_segment<T>> pending;
+
+	void append(const dense_segment<T>& segment);
+	// последний шаг, начинающийся не позже t; hint - шаг предыдущего запроса
+	uint64_t find(const split_epoch<T>& t, uint64_t hint) const noexcept;
+	void evaluate(uint64_t index, const split_epoch<T>& t, T* out) const noexcept;
+	void prepare(const split_epoch<T>& t);
+public:
+	// state - начальное состояние с k_last; создаётся DormandPrinceIntegrator::trajectory
+	dense_trajectory(DormandPrinceIntegrator<T>& integrator, model_t<T>& system, const step_state<T>& state);
+
+	T begin() const noexcept { return first.to_seconds(); };
+	T end() const noexcept { return tail.t0.to_seconds(); };
+	uint64_t size() const noexcept { return steps.size(); };
+	uint64_t dimension() const noexcept { return dim; };
+	uint64_t bytes() const noexcept { return coeffs.size() * sizeof(T) + steps.size() * (sizeof(T) + sizeof(split_epoch<T>)); };
+
+	// продолжить интегрирование хотя бы до t (первое продолжение - хотя бы до t1 модели);
+	// если интегрирование выбросило исключение, траектория не меняется
+	void extend(T t);
+
+	Vector<T> state(T t);
+	Vector<T> state(const split_epoch<T>& t);
+	// count моментов (по возрастанию - быстрее всего), out - count строк по dimension() значений
+	void state(const T* t, uint64_t count, T* out);
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+
+// метод Дормана - Принса 5(4): таблица Бутчера и плотная выдача 4-го порядка.
+// Общая для DormandPrinceIntegrator, batch_integrator и dense_trajectory; значения задаются
+// в long double и приводятся к T один раз, как при заполнении Vector<T> / Matrix<T>
+template<typename T>
+struct dormand_prince {
+	static constexpr T c[7] = { 0.0l, 0.2l, 0.3l, 0.8l, 8.0l / 9.0l, 1.0l, 1.0l };
+
+	// строка 6 совпадает с b: седьмая стадия - правая часть в x1 (FSAL)
+	static constexpr T a[7][7] = {
+		{ 0, 0, 0, 0, 0, 0, 0 },
+		{ 1.0l / 5.0l, 0, 0, 0, 0, 0, 0 },
+		{ 3.0l / 40.0l, 9.0l / 40.0l, 0, 0, 0, 0, 0 },
+		{ 44.0l / 45.0l, -56.0l / 15.0l, 32.0l / 9.0l, 0, 0, 0, 0 },
+		{ 19372.0l / 6561.0l, -25360.0l / 2187.0l, 64448.0l / 6561.0l, -212.0l / 729.0l, 0, 0, 0 },
+		{ 9017.0l / 3168.0l, -355.0l / 33.0l, 46732.0l / 5247.0l, 49.0l / 176.0l, -5103.0l / 18656.0l, 0, 0 },
+		{ 35.0l / 384.0l, 0, 500.0l / 1113.0l, 125.0l / 192.0l, -2187.0l / 6784.0l, 11.0l / 84.0l, 0 },
+	};
+
+	// решение 5-го порядка
+	static constexpr T b[7] = { 35.0l / 384.0l, 0, 500.0l / 1113.0l, 125.0l / 192.0l, -2187.0l / 6784.0l, 11.0l / 84.0l, 0 };
+
+	// вложенное решение 4-го порядка, для оценки ошибки
+	static constexpr T b1[7] = { 5179.0l / 57600.0l, 0, 7571.0l / 16695.0l, 393.0l / 640.0l, -92097.0l / 339200.0l, 187.0l / 2100.0l, 1.0l / 40.0l };
+
+	// плотная выдача x(t0 + θh) = x0 + h sum_j d_j(θ) k_j, d_1 = 0:
+	// d_0 = θ (1 + θ (q_00 + θ (q_01 + θ q_02))), d_j = num_j θ^2 (q_j0 + θ (q_j1 + θ q_j2)) / den_j
+	static constexpr long double q[6][3] = {
+		{ -1337.0l / 480.0l, 1039.0l / 360.0l, -1163.0l / 1152.0l },
+		{ 0, 0, 0 },
+		{ 1054.0l / 9275.0l, -4682.0l / 27825.0l, 379.0l / 5565.0l },
+		{ 27.0l / 40.0l, -9.0l / 5.0l, 83.0l / 96.0l },
+		{ -3.0l / 250.0l, 22.0l / 375.0l, -37.0l / 600.0l },
+		{ -3.0l / 10.0l, 29.0l / 30.0l, -17.0l / 24.0l },
+	};
+	static constexpr long double num[6] = { 1.0l, 0, 100.0l, -5.0l, 18225.0l, -22.0l };
+	static constexpr long double den[6] = { 1.0l, 1.0l, 3.0l, 2.0l, 848.0l, 7.0l };
+
+	// веса d_j(θ); многочлены считаются в long double
+	static void weights(T theta, T* d) noexcept {
+		const long double theta2 = (long double)theta * theta;
+
+		d[0] = theta * (1 + theta * (q[0][0] + theta * (q[0][1] + theta * q[0][2])));
+		d[1] = 0;
+		for (uint64_t stage = 2u; stage < 6u; ++stage)
+			d[stage] = num[stage] * theta2 * (q[stage][0] + theta * (q[stage][1] + theta * q[stage][2])) / den[stage];
+	};
+
+	// коэффициент при θ^(degree + 2) в d_stage(θ): плотная выдача как многочлен по степеням θ
+	static constexpr long double power(uint64_t degree, uint64_t stage) noexcept {
+		return stage ? num[stage] * q[stage][degree] / den[stage] : q[0][degree];
+	};
+};
@@ -0,0 +1,369 @@
+#include <array>
+#include <math.h>
+#include <stdexcept>
+#include "earth_orientation.hpp"
+#include "funcm.hpp"
+#include "profile.hpp"
+
+static const double arcsec = math_const::π / (180.0 * 3600.0);
+
+static double wrap_2π(double angle) {
+	angle = fmod(angle, 2.0 * math_const::π);
+	return angle < 0 ? angle + 2.0 * math_const::π : angle;
+}
+
+julian_date julian_date::from_calendar(int Y, int M, int D, int h, int m, double s) {
+	// get_JDN в полдень даёт целый номер юлианского дня
+	return { get_JDN(Y, M, D, 12, 0, 0) - 0.5, (h * 3600.0 + m * 60.0 + s) / 86400.0 };
+}
+
+// TAI - UTC с даты (год, месяц, 1-е число)
+struct leap_second {
+	int year;
+	int month;
+	double tai_utc;
+};
+
+static const leap_second leap_seconds[] = {
+	{ 1972, 1, 10.0 }, { 1972, 7, 11.0 }, { 1973, 1, 12.0 }, { 1974, 1, 13.0 }, { 1975, 1, 14.0 },
+	{ 1976, 1, 15.0 }, { 1977, 1, 16.0 }, { 1978, 1, 17.0 }, { 1979, 1, 18.0 }, { 1980, 1, 19.0 },
+	{ 1981, 7, 20.0 }, { 1982, 7, 21.0 }, { 1983, 7, 22.0 }, { 1985, 7, 23.0 }, { 1988, 1, 24.0 },
+	{ 1990, 1, 25.0 }, { 1991, 1, 26.0 }, { 1992, 7, 27.0 }, { 1993, 7, 28.0 }, { 1994, 7, 29.0 },
+	{ 1996, 1, 30.0 }, { 1997, 7, 31.0 }, { 1999, 1, 32.0 }, { 2006, 1, 33.0 }, { 2009, 1, 34.0 },
+	{ 2012, 7, 35.0 }, { 2015, 7, 36.0 }, { 2017, 1, 37.0 },
+};
+
+static const uint64_t leap_count = sizeof(leap_seconds) / sizeof(leap_seconds[0]);
+
+// юлианские даты (UTC) начала действия каждой строки таблицы;
+// инициализация локальной статической переменной потокобезопасна
+static const double* leap_dates() {
+	static const std::array<double, leap_count> dates = [] {
+		std::array<double, leap_count> output{};
+		for (uint64_t count = 0u; count < leap_count; ++count)
+			output[count] = julian_date::from_calendar(leap_seconds[count].year, leap_seconds[count].month, 1).value();
+		return output;
+	}();
+
+	return dates.data();
+}
+
+// номер строки таблицы, действующей в момент utc
+static uint64_t leap_index(const julian_date& utc) {
+	const double* dates = leap_dates();
+	double jd = utc.value();
+
+	if (jd < dates[0])
+		throw std::logic_error("tai-utc");
+
+	uint64_t index = 0u;
+	while (index + 1u < leap_count && jd >= dates[index + 1u])
+		++index;
+
+	return index;
+}
+
+double tai_minus_utc(const julian_date& utc) {
+	return leap_seconds[leap_index(utc)].tai_utc;
+}
+
+julian_date utc_to_tt(const julian_date& utc) {
+	return utc + (tai_minus_utc(utc) + 32.184);
+}
+
+double tt_minus_utc(const julian_date& tt) {
+	// TAI - UTC берётся по приближению UTC и уточняется один раз (граница високосной секунды)
+	double offset = tai_minus_utc(tt + -(37.0 + 32.184)) + 32.184;
+	return tai_minus_utc(tt + -offset) + 32.184;
+}
+
+julian_date tt_to_utc(const julian_date& tt) {
+	return tt + -tt_minus_utc(tt);
+}
+
+double leap_valid_until(const julian_date& utc) {
+	uint64_t index = leap_index(utc);
+	return index + 1u < leap_count ? leap_dates()[index + 1u] : HUGE_VAL;
+}
+
+double leap_valid_from(const julian_date& utc) {
+	return leap_dates()[leap_index(utc)];
+}
+
+julian_date utc_to_ut1(const julian_date& utc, double dut1) {
+	return utc + dut1;
+}
+
+// D, M, M', F, Ω; Δψ = (s + s1 T) sin(arg), Δε = (c + c1 T) cos(arg), 0.0001"
+struct nutation_term {
+	int D, M, Mp, F, Ω;
+	double s, s1, c, c1;
+};
+
+static const nutation_term nutation_terms[] = {
+	{ 0, 0, 0, 0, 1, -171996.0, -174.2, 92025.0, 8.9 },
+	{ -2, 0, 0, 2, 2, -13187.0, -1.6, 5736.0, -3.1 },
+	{ 0, 0, 0, 2, 2, -2274.0, -0.2, 977.0, -0.5 },
+	{ 0, 0, 0, 0, 2, 2062.0, 0.2, -895.0, 0.5 },
+	{ 0, 1, 0, 0, 0, 1426.0, -3.4, 54.0, -0.1 },
+	{ 0, 0, 1, 0, 0, 712.0, 0.1, -7.0, 0.0 },
+	{ -2, 1, 0, 2, 2, -517.0, 1.2, 224.0, -0.6 },
+	{ 0, 0, 0, 2, 1, -386.0, -0.4, 200.0, 0.0 },
+	{ 0, 0, 1, 2, 2, -301.0, 0.0, 129.0, -0.1 },
+	{ -2, -1, 0, 2, 2, 217.0, -0.5, -95.0, 0.3 },
+	{ -2, 0, 1, 0, 0, -158.0, 0.0, 0.0, 0.0 },
+	{ -2, 0, 0, 2, 1, 129.0, 0.1, -70.0, 0.0 },
+	{ 0, 0, -1, 2, 2, 123.0, 0.0, -53.0, 0.0 },
+	{ 2, 0, 0, 0, 0, 63.0, 0.0, 0.0, 0.0 },
+	{ 0, 0, 1, 0, 1, 63.0, 0.1, -33.0, 0.0 },
+	{ 2, 0, -1, 2, 2, -59.0, 0.0, 26.0, 0.0 },
+	{ 0, 0, -1, 0, 1, -58.0, -0.1, 32.0, 0.0 },
+	{ 0, 0, 1, 2, 1, -51.0, 0.0, 27.0, 0.0 },
+};
+
+static double mean_obliquity(double T) {
+	return (84381.406 + T * (-46.836769 + T * (-0.0001831 + T * (0.00200340 + T * (-0.000000576 + T * -0.0000000434))))) * arcsec;
+}
+
+nutation_angles nutation(const julian_date& tt) {
+	LR5_COUNT("orientation/nutation_series", 1u);
+	double T = tt.centuries();
+
+	// фундаментальные аргументы, градусы
+	double D = rad(297.85036 + T * (445267.111480 + T * (-0.0019142 + T / 189474.0)));
+	double M = rad(357.52772 + T * (35999.050340 + T * (-0.0001603 - T / 300000.0)));
+	double Mp = rad(134.96298 + T * (477198.867398 + T * (0.0086972 + T / 56250.0)));
+	double F = rad(93.27191 + T * (483202.017538 + T * (-0.0036825 + T / 327270.0)));
+	double Ω = rad(125.04452 + T * (-1934.136261 + T * (0.0020708 + T / 450000.0)));
+
+	nutation_angles output{ 0.0, 0.0, mean_obliquity(T) };
+
+	for (const auto& term : nutation_terms) {
+		double arg = term.D * D + term.M * M + term.Mp * Mp + term.F * F + term.Ω * Ω;
+		output.dpsi += (term.s + term.s1 * T) * sin(arg);
+		output.deps += (term.c + term.c1 * T) * cos(arg);
+	}
+
+	output.dpsi *= 1e-4 * arcsec;
+	output.deps *= 1e-4 * arcsec;
+
+	return output;
+}
+
+double earth_rotation_angle(const julian_date& ut1) {
+	double f = fmod(ut1.jd1, 1.0) + fmod(ut1.jd2, 1.0);
+	return wrap_2π(2.0 * math_const::π * (f + 0.7790572732640 + 0.00273781191135448 * ut1.days()));
+}
+
+// GMST - ERA (МАС 2006), рад
+static double gmst_minus_era(const julian_date& tt) {
+	double T = tt.centuries();
+	return (0.014506 + T * (4612.156534 + T * (1.3915817 + T * (-0.00000044 + T * (-0.000029956 + T * -0.0000000368))))) * arcsec;
+}
+
+double gmst(const julian_date& ut1, const julian_date& tt) {
+	return wrap_2π(earth_rotation_angle(ut1) + gmst_minus_era(tt));
+}
+
+double equation_of_equinoxes(const julian_date& tt) {
+	nutation_angles n = nutation(tt);
+	double Ω = rad(125.04452 - 1934.136261 * tt.centuries());
+
+	// дополнительные члены уравнения равноденствий
+	return n.dpsi * cos(n.eps0 + n.deps) + (0.00264096 * sin(Ω) + 0.00006352 * sin(2.0 * Ω)) * arcsec;
+}
+
+double gast(const julian_date& ut1, const julian_date& tt) {
+	return wrap_2π(gmst(ut1, tt) + equation_of_equinoxes(tt));
+}
+
+// произведение out = a * b для матриц 3x3 по строкам
+static void multiply_3x3(const double* a, const double* b, double* out) {
+	for (int row = 0; row < 3; ++row)
+		for (int col = 0; col < 3; ++col)
+			out[row * 3 + col] = a[row * 3] * b[col] + a[row * 3 + 1] * b[3 + col] + a[row * 3 + 2] * b[6 + col];
+}
+
+// повороты системы координат вокруг осей x и z
+static void rotation_x(double angle, double* out) {
+	double c = cos(angle), s = sin(angle);
+	double r[9] = { 1, 0, 0, 0, c, s, 0, -s, c };
+	for (int count = 0; count < 9; ++count)
+		out[count] = r[count];
+}
+
+static void rotation_y(double angle, double* out) {
+	double c = cos(angle), s = sin(angle);
+	double r[9] = { c, 0, -s, 0, 1, 0, s, 0, c };
+	for (int count = 0; count < 9; ++count)
+		out[count] = r[count];
+}
+
+static void rotation_z(double angle, double* out) {
+	double c = cos(angle), s = sin(angle);
+	double r[9] = { c, s, 0, -s, c, 0, 0, 0, 1 };
+	for (int count = 0; count < 9; ++count)
+		out[count] = r[count];
+}
+
+void precession_nutation(const julian_date& tt, double* pn) {
+	double T = tt.centuries();
+
+	// прецессия: P = R3(-z) R2(θ) R3(-ζ)
+	double ζ = (2.650545 + T * (2306.083227 + T * (0.2988499 + T * (0.01801828 + T * (-0.000005971 + T * -0.0000003173))))) * arcsec;
+	double z = (-2.650545 + T * (2306.077181 + T * (1.0927348 + T * (0.01826837 + T * (-0.000028596 + T * -0.0000002904))))) * arcsec;
+	double θ = T * (2004.191903 + T * (-0.4294934 + T * (-0.04182264 + T * (-0.000007089 + T * -0.0000001274)))) * arcsec;
+
+	double a[9], b[9], p[9], tmp[9];
+	rotation_z(-ζ, a);
+	rotation_y(θ, b);
+	multiply_3x3(b, a, tmp);
+	rotation_z(-z, a);
+	multiply_3x3(a, tmp, p);
+
+	// нутация: N = R1(-(ε0 + Δε)) R3(-Δψ) R1(ε0)
+	nutation_angles n = nutation(tt);
+	double q[9];
+	rotation_x(n.eps0, a);
+	rotation_z(-n.dpsi, b);
+	multiply_3x3(b, a, tmp);
+	rotation_x(-(n.eps0 + n.deps), a);
+	multiply_3x3(a, tmp, q);
+
+	multiply_3x3(q, p, pn);
+}
+
+Matrix<double> precession_nutation(const julian_date& tt) {
+	double pn[9];
+	precession_nutation(tt, pn);
+	return Matrix<double>(3, 3, { pn[0], pn[1], pn[2], pn[3], pn[4], pn[5], pn[6], pn[7], pn[8] });
+}
+
+earth_orientation::earth_orientation(const julian_date& epoch_tt, double dut1, double step) : epoch(epoch_tt), dut1(dut1), step(step) {
+	if (step <= 0)
+		throw std::logic_error("earth orientation");
+};
+
+earth_orientation::earth_orientation(const earth_orientation& other) :
+	epoch(other.epoch), dut1(other.dut1), step(other.step), first(other.first), nodes(other.nodes),
+	offset(other.offset), offset_from(other.offset_from), offset_to(other.offset_to) {
+}
+
+earth_orientation& earth_orientation::operator=(const earth_orientation& other) {
+	if (this != &other) {
+		check_thread();
+		epoch = other.epoch;
+		dut1 = other.dut1;
+		step = other.step;
+		first = other.first;
+		nodes = other.nodes;
+		offset = other.offset;
+		offset_from = other.offset_from;
+		offset_to = other.offset_to;
+	}
+	return *this;
+}
+
+void earth_orientation::check_thread() const {
+	std::thread::id current = std::this_thread::get_id();
+	std::thread::id expected = owner.load(std::memory_order_acquire);
+
+	if (expected == current)
+		return;
+	if (expected == std::thread::id() && owner.compare_exchange_strong(expected, current, std::memory_order_acq_rel))
+		return;
+
+	throw std::logic_error("earth orientation thread");
+}
+
+double earth_orientation::tt_minus_utc(double t) const {
+	check_thread();
+	// число високосных секунд меняется редко: запоминается промежуток, на котором оно постоянно
+	if (!(t >= offset_from && t < offset_to)) {
+		julian_date utc = tt_to_utc(tt(t));
+		offset = ::tt_minus_utc(tt(t));
+		offset_from = (julian_date{ leap_valid_from(utc), 0.0 } - epoch) + offset;
+		offset_to = (julian_date{ leap_valid_until(utc), 0.0 } - epoch) + offset;
+	}
+
+	return offset;
+}
+
+julian_date earth_orientation::ut1(double t) const {
+	return tt(t) + (dut1 - tt_minus_utc(t));
+}
+
+const earth_orientation::node& earth_orientation::node_at(int64_t index) const {
+	if (nodes.empty())
+		first = index;
+
+	if (index < first) {
+		nodes.insert(nodes.begin(), uint64_t(first - index), node{});
+		first = index;
+	}
+
+	if (uint64_t(index - first) >= nodes.size())
+		nodes.resize(uint64_t(index - first) + 1u);
+
+	node& output = nodes[uint64_t(index - first)];
+
+	if (!output.ready) {
+		LR5_COUNT("orientation/node", 1u);
+		julian_date date = tt(index * step);
+
+		// GMST - ERA и уравнение равноденствий не заворачиваются: функция гладкая между узлами
+		output.gast_minus_era = gmst_minus_era(date) + equation_of_equinoxes(date);
+		::precession_nutation(date, output.pn);
+		output.ready = true;
+	}
+
+	return output;
+}
+
+void earth_orientation::weights(double t, int64_t& index, double* w) const {
+	double x = t / step;
+	index = int64_t(floor(x));
+	double u = x - index;
+
+	// кубическая интерполяция Лагранжа по узлам index - 1 ... index + 2
+	w[0] = -u * (u - 1.0) * (u - 2.0) / 6.0;
+	w[1] = (u + 1.0) * (u - 1.0) * (u - 2.0) / 2.0;
+	w[2] = -(u + 1.0) * u * (u - 2.0) / 2.0;
+	w[3] = (u + 1.0) * u * (u - 1.0) / 6.0;
+}
+
+double earth_orientation::sidereal_angle(double t) const {
+	check_thread();
+	int64_t index;
+	double w[4];
+	weights(t, index, w);
+
+	double slow = 0.0;
+	for (int count = 0; count < 4; ++count)
+		slow += w[count] * node_at(index - 1 + count).gast_minus_era;
+
+	return wrap_2π(earth_rotation_angle(ut1(t)) + slow);
+}
+
+void earth_orientation::precession_nutation(double t, double* pn) const {
+	check_thread();
+	int64_t index;
+	double w[4];
+	weights(t, index, w);
+
+	for (int element = 0; element < 9; ++element)
+		pn[element] = 0.0;
+
+	for (int count = 0; count < 4; ++count) {
+		const node& n = node_at(index - 1 + count);
+		for (int element = 0; element < 9; ++element)
+			pn[element] += w[count] * n.pn[element];
+	}
+}
+
+uint64_t earth_orientation::cached_nodes() const noexcept {
+	uint64_t output = 0u;
+	for (const auto& n : nodes)
+		output += n.ready;
+	return output;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "vector.hpp"
+
+// юлианская дата из двух частей (как в SOFA): jd1 - полночь или полдень, jd2 - доля суток;
+// так секунды не теряются на фоне 2.46e6 суток
+struct julian_date {
+	double jd1 = 0.0;
+	double jd2 = 0.0;
+
+	static julian_date from_calendar(int Y, int M, int D, int h = 0, int m = 0, double s = 0.0);
+
+	double value() const noexcept { return jd1 + jd2; };
+	// сутки и юлианские столетия от J2000.0
+	double days() const noexcept { return (jd1 - 2451545.0) + jd2; };
+	double centuries() const noexcept { return days() / 36525.0; };
+
+	julian_date operator+(double seconds) const noexcept { return { jd1, jd2 + seconds / 86400.0 }; };
+	// разность в секундах
+	double operator-(const julian_date& other) const noexcept { return ((jd1 - other.jd1) + (jd2 - other.jd2)) * 86400.0; };
+};
+
+// шкалы времени: UTC -> TAI по таблице високосных секунд (с 1972 г.), TT = TAI + 32.184 с, UT1 = UTC + DUT1
+double tai_minus_utc(const julian_date& utc);
+double tt_minus_utc(const julian_date& tt);
+// границы промежутка (юлианская дата UTC), на котором TAI - UTC постоянно
+double leap_valid_from(const julian_date& utc);
+double leap_valid_until(const julian_date& utc);
+julian_date utc_to_tt(const julian_date& utc);
+julian_date tt_to_utc(const julian_date& tt);
+julian_date utc_to_ut1(const julian_date& utc, double dut1);
+
+// нутация по ведущим членам ряда МАС 1980 (Meeus, табл. 22.A; точность ~0.01")
+// и средний наклон эклиптики МАС 2006, рад
+struct nutation_angles {
+	double dpsi;
+	double deps;
+	double eps0;
+};
+
+nutation_angles nutation(const julian_date& tt);
+
+// угол поворота Земли (ERA), среднее и истинное звёздное время Гринвича (МАС 2006), рад
+double earth_rotation_angle(const julian_date& ut1);
+double gmst(const julian_date& ut1, const julian_date& tt);
+double equation_of_equinoxes(const julian_date& tt);
+double gast(const julian_date& ut1, const julian_date& tt);
+
+// матрица N * P (строки): от среднего экватора J2000 к истинному экватору и равноденствию даты;
+// прецессия МАС 2006 (ζ, z, θ), сдвиг рамки ICRS и движение полюса не учитываются
+void precession_nutation(const julian_date& tt, double* pn);
+Matrix<double> precession_nutation(const julian_date& tt);
+
+// ориентация Земли от эпохи epoch (TT): медленные части (GAST - ERA и матрица N * P) считаются
+// в узлах через step секунд по мере надобности и интерполируются кубически по четырём узлам,
+// ERA - линейная функция UT1 - вычисляется точно; t - секунды TT от эпохи.
+// Кэш узлов и TT - UTC заполняется при запросах без блокировок, поэтому объект принадлежит потоку,
+// первым запросившему значение: запрос из другого потока выбрасывает logic_error.
+// Рабочим потокам (Монте-Карло, CR3BP) нужна своя копия - копия не привязана ни к одному потоку
+class earth_orientation {
+private:
+	struct node {
+		bool ready = false;
+		double gast_minus_era;
+		double pn[9];
+	};
+
+	julian_date epoch;
+	double dut1 = 0.0;
+	double step = 43200.0;
+
+	mutable int64_t first = 0;
+	mutable std::vector<node> nodes;
+
+	mutable double offset = 0.0;
+	mutable double offset_from = 0.0;
+	mutable double offset_to = -1.0;
+
+	mutable std::atomic<std::thread::id> owner{};
+
+	void check_thread() const;
+	const node& node_at(int64_t index) const;
+	void weights(double t, int64_t& index, double* w) const;
+public:
+	earth_orientation() noexcept {};
+	earth_orientation(const julian_date& epoch_tt, double dut1 = 0.0, double step = 43200.0);
+	earth_orientation(const earth_orientation& other);
+	earth_orientation& operator=(const earth_orientation& other);
+
+	const julian_date& get_epoch() const noexcept { return epoch; };
+	julian_date tt(double t) const noexcept { return epoch + t; };
+	julian_date ut1(double t) const;
+	// TT - UTC, с: 32.184 + число високосных секунд
+	double tt_minus_utc(double t) const;
+
+	double sidereal_angle(double t) const;
+	void precession_nutation(double t, double* pn) const;
+
+	uint64_t cached_nodes() const noexcept;
+};
@@ -0,0 +1,52 @@
+#include <chrono>
+#include <cstdlib>
+#include "chebyshev.hpp"
+#include "trajectory_cache.hpp"
+
+// ephemeris_tool <файл> [дней] [длина отрезка, дней] [степень]
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cout << "usage: ephemeris_tool <file> [days] [interval days] [degree]" << '\n';
+		return 1;
+	}
+
+	const char* filename = argv[1];
+	double days = argc > 2 ? atof(argv[2]) : 365.0;
+	double interval = argc > 3 ? atof(argv[3]) : 4.0;
+	uint64_t degree = argc > 4 ? atoi(argv[4]) : 12;
+
+	// то же начальное состояние Земли, что и в sundial_model/blag_time_model
+	real_t t0 = 2460310.50 * 86400.0;
+	real_t t1 = t0 + days * 86400.0;
+	earth_move_model<real_t> model(Vector<real_t>({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 }), t0, t1, t1 - t0);
+
+	trajectory_cache<real_t> cache;
+	DormandPrinceIntegrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+	integrator.set_cache(&cache);
+	integrator.run(model);
+
+	const auto& segments = cache.get(trajectory_cache<real_t>::make_key(model, scalar_traits<real_t>::tolerance)).segments;
+
+	chebyshev_ephemeris ephemeris = chebyshev_ephemeris::fit(segments, t0, t1, interval * 86400.0, degree);
+	ephemeris.save(filename);
+
+	uint64_t samples = uint64_t(days * 1440.0);
+	std::cout << "Integrator steps: " << segments.size() << '\n';
+	std::cout << "Chebyshev segments: " << ephemeris.segments() << " x " << degree + 1 << " coefficients" << '\n';
+	std::cout << "Size: " << ephemeris.bytes() << " bytes (60 s samples: " << samples * 6 * sizeof(double) << " bytes)" << '\n';
+	std::cout << "Max position error: " << ephemeris.max_error() << " m" << '\n';
+	std::cout << "Max velocity error: " << ephemeris.max_velocity_error() << " m/s" << '\n';
+
+	const uint64_t queries = 1000000u;
+	double r[3], v[3], sum{};
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t count = 0u; count < queries; ++count) {
+		ephemeris.state(t0 + (t1 - t0) * count / queries, r, v);
+		sum += r[0] + v[0];
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	std::cout << "State query: " << std::chrono::duration<double, std::nano>(end - start).count() / queries << " ns (" << sum << ")" << '\n';
+
+	return 0;
+}
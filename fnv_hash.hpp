@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// FNV-1a, 64 бита: ключи кэша траекторий и идентификаторы правых частей с параметрами
+constexpr uint64_t fnv_offset = 14695981039346656037ull;
+
+inline void hash_bytes(uint64_t& hash, const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t count = 0u; count < size; ++count) {
+		hash ^= bytes[count];
+		hash *= 1099511628211ull;
+	}
+}
+
+// значение хешируется как пара double: байты заполнения x87 long double не участвуют
+template<typename T>
+inline void hash_value(uint64_t& hash, T value) {
+	double high = double(value);
+	double low = double(value - high);
+	hash_bytes(hash, &high, sizeof(high));
+	hash_bytes(hash, &low, sizeof(low));
+}
+
+// все 64 бита - 16 шестнадцатеричных цифр
+inline std::string hash_hex(uint64_t hash) {
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+	return hex;
+}
@@ -28,6 +28,18 @@ inline double get_JDN(int Y, int M, int D, int h, int m, int s) {
 	return JD;
 }
 
+// номер дня в году (с 1) гражданской даты, на которую приходится момент JD (Флигель - Ван Фландерн)
+inline int get_day_of_year(double JD) {
+	long J = long(floor(JD + 0.5));
+	long f = J + 1401 + (((4 * J + 274277) / 146097) * 3) / 4 - 38;
+	long e = 4 * f + 3;
+	long h = 5 * ((e % 1461) / 4) + 2;
+	int M = int((h / 153 + 2) % 12) + 1;
+	int Y = int(e / 1461 - 4716 + (14 - M) / 12);
+
+	return int(J - long(get_JDN(Y, 1, 1, 12, 0, 0))) + 1;
+}
+
 
 inline long double Legendre(long double arg, long double n,long double m) {
 	long double answer{};
@@ -0,0 +1,132 @@
+#include <math.h>
+#include <stdexcept>
+#include "horizon_detector.hpp"
+#include "binary_io.hpp"
+#include "funcm.hpp"
+#include "profile.hpp"
+
+template<typename T>
+horizon_detector<T>::horizon_detector() : horizon_detector(standard_thresholds()) {};
+
+template<typename T>
+horizon_detector<T>::horizon_detector(const std::vector<elevation_threshold>& thresholds) :
+	thresholds(thresholds),
+	above(thresholds.size(), -1),
+	events({
+		{ "threshold", column_type::int32 },
+		{ "rising", column_type::int32 },
+		{ "time", column_type::float64 },
+	}) {
+};
+
+template<typename T>
+std::vector<elevation_threshold> horizon_detector<T>::standard_thresholds() {
+	return {
+		{ "horizon", 0.0 },
+		{ "sunrise", rad(-50.0 / 60.0) },
+		{ "civil", rad(-6.0) },
+		{ "nautical", rad(-12.0) },
+		{ "astronomical", rad(-18.0) },
+	};
+}
+
+template<typename T>
+T horizon_detector<T>::refine(T a, T fa, T b, T fb, T level, const std::function<T(T)>& elevation_at) const {
+	LR5_COUNT("horizon/refine", 1);
+
+	fa -= level;
+	fb -= level;
+
+	int side = 0;
+	T c = b;
+
+	for (uint64_t iteration = 0u; iteration < max_iterations; ++iteration) {
+		c = (a * fb - b * fa) / (fb - fa);
+
+		if (fabs(b - a) < tolerance)
+			break;
+
+		T fc = elevation_at(c) - level;
+
+		if (fc == 0)
+			break;
+
+		// метод Иллинойса: если граница повторно остаётся на месте, её значение делится пополам
+		if ((fc > 0) == (fb > 0)) {
+			b = c;
+			fb = fc;
+			if (side == -1)
+				fa /= 2;
+			side = -1;
+		}
+		else {
+			a = c;
+			fa = fc;
+			if (side == 1)
+				fb /= 2;
+			side = 1;
+		}
+	}
+
+	return c;
+}
+
+template<typename T>
+void horizon_detector<T>::add_sample(T t, T elevation, const std::function<T(T)>& elevation_at) {
+	for (uint64_t index = 0u; index < thresholds.size(); ++index) {
+		T level = thresholds[index].elevation;
+		int8_t state = elevation > level ? 1 : 0;
+
+		if (above[index] != -1 && above[index] != state && has_prev) {
+			T moment = refine(t_prev, e_prev, t, elevation, level, elevation_at);
+
+			events.append(column::threshold, index);
+			events.append(column::rising, state);
+			events.append(column::time, moment);
+		}
+
+		above[index] = state;
+	}
+
+	has_prev = true;
+	t_prev = t;
+	e_prev = elevation;
+}
+
+template<typename T>
+void horizon_detector<T>::clear() noexcept {
+	for (auto& state : above)
+		state = -1;
+	has_prev = false;
+	events.clear();
+}
+
+template<typename T>
+void horizon_detector<T>::save_state(std::ostream& out) const {
+	write_binary(out, uint64_t(above.size()));
+	for (auto state : above)
+		write_binary(out, state);
+	write_binary(out, has_prev);
+	write_binary(out, t_prev);
+	write_binary(out, e_prev);
+	write_binary(out, events);
+}
+
+template<typename T>
+void horizon_detector<T>::load_state(std::istream& in) {
+	uint64_t size{};
+	read_binary(in, size);
+
+	if (size != above.size())
+		throw std::logic_error("horizon detector state");
+
+	for (auto& state : above)
+		read_binary(in, state);
+	read_binary(in, has_prev);
+	read_binary(in, t_prev);
+	read_binary(in, e_prev);
+	read_binary(in, events);
+}
+
+template class horizon_detector<double>;
+template class horizon_detector<long double>;
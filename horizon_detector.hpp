@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "result_table.hpp"
+
+// порог высоты Солнца над горизонтом, рад
+struct elevation_threshold {
+	std::string name;
+	double elevation;
+};
+
+// пересечения нескольких порогов высоты за один проход по выборке:
+// у каждого порога своё состояние (над/под порогом), момент пересечения
+// уточняется методом Иллинойса по функции высоты внутри шага выборки
+template<typename T>
+class horizon_detector {
+public:
+	enum column : uint64_t {
+		threshold,
+		rising,
+		time,
+	};
+private:
+	std::vector<elevation_threshold> thresholds;
+	// -1 - состояние ещё неизвестно, 0 - под порогом, 1 - над порогом
+	std::vector<int8_t> above;
+
+	bool has_prev = false;
+	T t_prev = 0;
+	T e_prev = 0;
+
+	T tolerance = 1e-3;
+	uint64_t max_iterations = 60;
+
+	// столбцы: номер порога, 1 - восход/0 - заход, момент пересечения
+	result_table events;
+
+	T refine(T a, T fa, T b, T fb, T level, const std::function<T(T)>& elevation_at) const;
+public:
+	horizon_detector();
+	horizon_detector(const std::vector<elevation_threshold>& thresholds);
+
+	// геометрический горизонт, видимый восход/заход (рефракция 34' и радиус диска 16'),
+	// гражданские, навигационные и астрономические сумерки
+	static std::vector<elevation_threshold> standard_thresholds();
+
+	// точность уточнения момента пересечения по времени
+	void set_tolerance(T dt) noexcept { tolerance = dt; };
+
+	// elevation - высота в момент t, elevation_at(t) - высота внутри шага [t_prev, t]
+	void add_sample(T t, T elevation, const std::function<T(T)>& elevation_at);
+
+	uint64_t count() const noexcept { return thresholds.size(); };
+	const elevation_threshold& get_threshold(uint64_t index) const { return thresholds.at(index); };
+	const result_table& get_events() const noexcept { return events; };
+	void clear() noexcept;
+
+	void save_state(std::ostream& out) const;
+	void load_state(std::istream& in);
+};
@@ -1,73 +1,442 @@
 #include "integrator.hpp"
+#include "trajectory_cache.hpp"
+#include "dense_trajectory.hpp"
+#include <cstdio>
+#include <filesystem>
 
-void DormandPrinceIntegrator::run(model_t& system) {
+// без временных векторов и pow: порядок сложения тот же, что у x0 + h * (d0 * k0 + ... + d5 * k5)
+template<typename T>
+static Vector<T> dense_output(const Vector<T>& x0, const Vector<Vector<T>>& k, T h, T theta) {
+	T d[6];
+	dormand_prince<T>::weights(theta, d);
 
-	//clock_t start_time = clock();
+	Vector<T> output(x0.dimension());
+	const Vector<T>* stages = k.data();
+	const T* k0 = stages[0].data(), * k1 = stages[1].data(), * k2 = stages[2].data(), * k3 = stages[3].data(), * k4 = stages[4].data(), * k5 = stages[5].data();
+	for (uint64_t count = 0u; count < x0.dimension(); ++count) {
+		T sum = d[0] * k0[count] + d[1] * k1[count];
+		sum = sum + d[2] * k2[count];
+		sum = sum + d[3] * k3[count];
+		sum = sum + d[4] * k4[count];
+		sum = sum + d[5] * k5[count];
+		output.at(count) = x0.at(count) + h * sum;
+	}
+
+	return output;
+}
+
+template<typename T>
+Vector<T> dense_segment<T>::state(const split_epoch<T>& t) const {
+	return dense_output(x0, k, h, (t - t0) / h);
+}
+
+template<typename T>
+void write_binary(std::ostream& out, const step_state<T>& state) {
+	write_binary(out, state.t0);
+	write_binary(out, state.t);
+	write_binary(out, state.h);
+	write_binary(out, state.steps);
+	write_binary(out, state.x0);
+	write_binary(out, state.x0_err);
+	write_binary(out, state.k_last);
+}
+
+template<typename T>
+void read_binary(std::istream& in, step_state<T>& state) {
+	read_binary(in, state.t0);
+	read_binary(in, state.t);
+	read_binary(in, state.h);
+	read_binary(in, state.steps);
+	read_binary(in, state.x0);
+	read_binary(in, state.x0_err);
+	read_binary(in, state.k_last);
+}
+
+template<typename T>
+void write_binary(std::ostream& out, const dense_segment<T>& segment) {
+	write_binary(out, segment.t0);
+	write_binary(out, segment.h);
+	write_binary(out, segment.x0);
+	for (uint64_t count = 0u; count < 6u; ++count)
+		write_binary(out, segment.k.at(count));
+}
+
+template<typename T>
+void read_binary(std::istream& in, dense_segment<T>& segment) {
+	read_binary(in, segment.t0);
+	read_binary(in, segment.h);
+	read_binary(in, segment.x0);
+	segment.k.resize(6);
+	for (uint64_t count = 0u; count < 6u; ++count)
+		read_binary(in, segment.k.at(count));
+}
+
+template<typename T>
+void DormandPrinceIntegrator<T>::set_checkpoint(const char* filename, uint64_t every_steps) noexcept {
+	checkpoint_file = filename;
+	checkpoint_every = every_steps;
+	checkpoint_rows = 0u;
+}
+
+template<typename T>
+void DormandPrinceIntegrator<T>::save_checkpoint(const char* filename, const step_state<T>& state, const model_t<T>& system) {
+	const result_table& res = system.get_result();
+	std::string rows_name = std::string(filename) + ".rows";
+
+	// сначала строки: если запись прервётся до замены файла, лишние строки отбрасываются при загрузке
+	{
+		bool rewrite = checkpoint_rows == 0u || res.rows() < checkpoint_rows;
+		std::ofstream rows(rows_name, std::ios::binary | (rewrite ? std::ios::trunc : std::ios::app));
+
+		if (!rows.is_open())
+			throw std::logic_error("save checkpoint");
+
+		res.write_rows(rows, rewrite ? 0u : checkpoint_rows, res.rows());
+		if (!rows.flush())
+			throw std::logic_error("save checkpoint");
+		checkpoint_rows = res.rows();
+	}
+
+	std::string temp_name = std::string(filename) + ".tmp";
+	std::ofstream f(temp_name, std::ios::binary | std::ios::trunc);
+
+	if (!f.is_open())
+		throw std::logic_error("save checkpoint");
+
+	f.write("LR5C", 4);
+	write_binary(f, uint32_t(6));
+	write_binary(f, eps);
+	write_binary(f, state);
+	write_binary(f, checkpoint_rows);
+	system.save_state(f);
+
+	f.close();
+
+	// старый файл заменяется только целиком записанным
+	if (std::rename(temp_name.c_str(), filename) != 0)
+		throw std::logic_error("save checkpoint");
+}
+
+template<typename T>
+void DormandPrinceIntegrator<T>::load_checkpoint(const char* filename, step_state<T>& state, model_t<T>& system) {
+	std::ifstream f(filename, std::ios::binary);
 
-	long double h = 1e-5l;
-	long double h_new = h;
-	long double t0 = 0;
-	long double t1 = 10;
-	long double step = 0.00001;
-	long double t = t0 + step;
-	Vector<long double> x0 = system.get_init();
+	if (!f.is_open())
+		throw std::logic_error("load checkpoint");
 
-	long double v{ 1 };
-	long double u;
+	char magic[4]{};
+	uint32_t version{};
+	T saved_eps{};
+	uint64_t rows{};
+
+	f.read(magic, 4);
+	read_binary(f, version);
+	if (std::string(magic, 4) != "LR5C" || version != 6)
+		throw std::logic_error("load checkpoint");
+
+	read_binary(f, saved_eps);
+	if (saved_eps != eps)
+		throw std::logic_error("checkpoint eps");
+
+	read_binary(f, state);
+	read_binary(f, rows);
+
+	if (state.x0.dimension() != system.get_init().dimension())
+		throw std::logic_error("load checkpoint");
+
+	system.load_state(f);
+
+	std::string rows_name = std::string(filename) + ".rows";
+	{
+		std::ifstream in(rows_name, std::ios::binary);
+		if (!in.is_open())
+			throw std::logic_error("load checkpoint");
+		system.load_rows(in, rows);
+	}
+
+	// контрольные точки в тот же файл дописывают строки сразу за сохранёнными
+	std::filesystem::resize_file(rows_name, rows * system.get_result().row_bytes());
+	checkpoint_rows = checkpoint_file && std::string(checkpoint_file) == filename ? rows : 0u;
+}
+
+template<typename T>
+void DormandPrinceIntegrator<T>::resume(model_t<T>& system, const char* filename) {
+	step_state<T> state;
+	load_checkpoint(filename, state, system);
+	integrate(system, state);
+}
+
+template<typename T>
+void DormandPrinceIntegrator<T>::set_cache(trajectory_cache<T>* trajectories) noexcept {
+	cache = trajectories;
+}
+
+template<typename T>
+void DormandPrinceIntegrator<T>::replay(model_t<T>& system, const std::vector<dense_segment<T>>& segments, step_state<T>& state) {
+	const split_epoch<T> t1 = split_epoch<T>::from_seconds(system.get_t1());
+	const T step = system.get_step();
+	const bool uniform = system.uniform_output();
+
+	for (const auto& segment : segments) {
+		if (t1 - segment.t0 <= 0) {
+			break;
+		}
+
+		if (!uniform)
+			system.add_segment(segment);
+
+		if (uniform) {
+			// временные векторы плотной выдачи - в арене, как в integrate
+			arena_scope scope(arena);
+			while ((state.t - segment.t0 < segment.h) && (state.t - t1 < 0)) {
+				system.add_result(segment.state(state.t), state.t.to_seconds());
+				state.t += step;
+			}
+		}
+		arena.reset();
+		system.flush_results();
+
+		// сохранённая траектория длиннее нужной: состояние восстанавливается в t1,
+		// а если модель остановилась на событии - в конце этого шага, как в integrate
+		const bool stop = system.finished();
+		if (stop || t1 - segment.t0 <= segment.h) {
+			split_epoch<T> end = segment.t0;
+			end += segment.h;
+			if (t1 - end < 0)
+				end = t1;
+
+			state.t0 = end;
+			state.h = segment.h;
+			state.x0 = segment.state(end);
+			state.x0_err = Vector<T>(state.x0.dimension());
+			state.k_last = system.get_right(state.x0, end.to_seconds());
+		}
+
+		++state.steps;
+		if (stop)
+			break;
+	}
+}
+
+template<typename T>
+step_state<T> DormandPrinceIntegrator<T>::initial_state(const model_t<T>& system) const {
+	step_state<T> state;
+	state.t0 = split_epoch<T>::from_seconds(system.get_t0());
+	state.t = state.t0;
+	state.t += system.get_step();
+	state.h = 1e-5l;
+	state.steps = 0u;
+	state.x0 = system.get_init();
+	state.x0_err = Vector<T>(state.x0.dimension());
+	return state;
+}
+
+template<typename T>
+void DormandPrinceIntegrator<T>::run(model_t<T>& system) {
+	LR5_SCOPE("integrator/run");
+	step_state<T> state = initial_state(system);
+
+	if (!cache) {
+		state.k_last = system.get_right(state.x0, system.get_t0());
+		integrate(system, state);
+		return;
+	}
+
+	std::string key = trajectory_cache<T>::make_key(system, eps);
+	typename trajectory_cache<T>::entry& cached = cache->get(key);
+
+	if (cached.segments.empty()) {
+		state.k_last = system.get_right(state.x0, system.get_t0());
+	}
+	else {
+		step_state<T> tail = cached.tail;
+		tail.t = state.t;
+		tail.steps = 0u;
+		replay(system, cached.segments, tail);
+		state = tail;
+
+		if (system.finished() || cached.tail.t0 - split_epoch<T>::from_seconds(system.get_t1()) >= 0) {
+			if (checkpoint_file)
+				save_checkpoint(checkpoint_file, state, system);
+			return;
+		}
+	}
+
+	uint64_t known = cached.segments.size();
+	integrate(system, state, &cached.segments);
+
+	if (cached.segments.size() != known) {
+		cached.tail = state;
+		cache->save(key);
+	}
+}
+
+template<typename T>
+void DormandPrinceIntegrator<T>::integrate(model_t<T>& system, step_state<T>& state, std::vector<dense_segment<T>>* segments, bool output) {
+
+	T h;
+	T& h_new = state.h;
+	split_epoch<T>& t0 = state.t0;
+	split_epoch<T>& t = state.t;
+	const split_epoch<T> t1 = split_epoch<T>::from_seconds(system.get_t1());
+	const T step = system.get_step();
+	const bool uniform = system.uniform_output();
+	Vector<T>& x0 = state.x0;
+	Vector<T>& x0_err = state.x0_err;
+	using tableau = dormand_prince<T>;
+
+	T v{ 1 };
+	T u;
 	while (1 + v > 1) {
 		u = v;
 		v /= 2;
 	}
 
-	while (t0 < t1) {
-		h = h_new;
+	k.at(0) = state.k_last;
+
+	// рабочие векторы шага создаются один раз и дальше только перезаписываются
+	Vector<T> dx(x0.dimension()), x1(x0.dimension()), x(x0.dimension()), sum(x0.dimension());
+	T new_eps;
 
-		k.at(0) = system.get_right(x0, t0);
-		k.at(1) = system.get_right(x0 + h * a(1, 0) * k.at(0), t0 + c.at(1) * h);
-		k.at(2) = system.get_right(x0 + h * (a(2, 0) * k(0) + a(2, 1) * k(1)), t0 + c.at(2) * h);
-		k.at(3) = system.get_right(x0 + h * (a(3, 0) * k(0) + a(3, 1) * k(1) + a(3, 2) * k(2)), t0 + c.at(3) * h);
-		k.at(4) = system.get_right(x0 + h * (a(4, 0) * k(0) + a(4, 1) * k(1) + a(4, 2) * k(2) + a(4, 3) * k(3)), t0 + c.at(4) * h);
-		k.at(5) = system.get_right(x0 + h * (a(5, 0) * k(0) + a(5, 1) * k(1) + a(5, 2) * k(2) + a(5, 3) * k(3) + a(5, 4) * k(4)), t0 + c.at(5) * h);
-		k.at(6) = system.get_right(x0 + h * (a(6, 0) * k(0) + a(6, 1) * k(1) + a(6, 2) * k(2) + a(6, 3) * k(3) + a(6, 4) * k(4) + a(6, 5) * k(5)), t0 + c.at(6) * h);
+	while (t1 - t0 > 0) {
+		// последний шаг заканчивается ровно в t1, чтобы с этой точки можно было продолжить
+		bool last = t1 - t0 <= h_new;
+		h = last ? t1 - t0 : h_new;
+		LR5_SCOPE("integrator/step");
+		T ts = t0.to_seconds();
 
-		Vector<long double> x1 = x0 + h * (b(0) * k(0) + b(1) * k(1) + b(2) * k(2) + b(3) * k(3) + b(4) * k(4) + b(5) * k(5));
-		Vector<long double> x1_ = x0 + h * (b1(0) * k(0) + b1(1) * k(1) + b1(2) * k(2) + b1(3) * k(3) + b1(4) * k(4) + b1(5) * k(5) + b1(6) * k(6));
+		{
+			// результаты get_right берутся из арены; k и рабочие векторы созданы вне её
+			arena_scope scope(arena);
 
-		long double new_eps{ 0 };
+			// x = x0 + h * sum_j a[stage][j] * k(j): те же операции и порядок округлений, что и в записи выражением
+			sum = k.at(0);
+			sum *= h * tableau::a[1][0];
+			x = x0;
+			x += sum;
+			k.at(1) = system.get_right(x, ts + tableau::c[1] * h);
 
-		for (uint64_t count = 0u; count < x0.dimension(); ++count) {
-			double max = std::max({ 1e-5l, abs(x0.at(count)), abs(x1.at(count)), 2.0l * u / eps });
-			new_eps += pow(h * (x1.at(count) - x1_.at(count)) / max, 2.0l);
+			for (uint64_t stage = 2u; stage < 6u; ++stage) {
+				sum = k.at(0);
+				sum *= tableau::a[stage][0];
+				for (uint64_t count = 1u; count < stage; ++count)
+					sum.axpy(tableau::a[stage][count], k.at(count));
+				sum *= h;
+				x = x0;
+				x += sum;
+				k.at(stage) = system.get_right(x, ts + tableau::c[stage] * h);
+			}
+
+			dx = k.at(0);
+			dx *= tableau::b[0];
+			for (uint64_t count = 1u; count < 6u; ++count)
+				dx.axpy(tableau::b[count], k.at(count));
+			dx *= h;
+			x1 = x0;
+			x1 += dx;
+
+			// a[6][j] == b[j]: седьмая стадия вычисляется в точке x1 и переиспользуется на следующем шаге (FSAL)
+			k.at(6) = system.get_right(x1, ts + tableau::c[6] * h);
+
+			sum = k.at(0);
+			sum *= tableau::b1[0];
+			for (uint64_t count = 1u; count < 7u; ++count)
+				sum.axpy(tableau::b1[count], k.at(count));
+			sum *= h;
+			x = x0;
+			x += sum;
+
+			new_eps = 0;
+
+			for (uint64_t count = 0u; count < x0.dimension(); ++count) {
+				T max = std::max<T>({ T(1e-5l), abs(x0.at(count)), abs(x1.at(count)), T(2) * u / eps });
+				new_eps += pow(h * (x1.at(count) - x.at(count)) / max, 2);
+			}
+			new_eps /= x0.dimension();
+			new_eps = sqrt(new_eps);
 		}
-		new_eps /= x0.dimension();
-		new_eps = sqrt(new_eps);
+		arena.reset();
 
-		h_new = h / std::max(0.1l, std::min(5.0l, pow(new_eps / eps, (1.0l / 5.0l)) / 0.9l));
+		h_new = h / std::max<T>(0.1l, std::min<T>(5.0l, pow(new_eps / eps, T(1.0l / 5.0l)) / 0.9l));
 
-		if (new_eps > eps)
+		if (new_eps > eps) {
+			LR5_COUNT("integrator/rejected", 1u);
 			continue;
+		}
+
+		LR5_COUNT("integrator/accepted", 1u);
+		LR5_VALUE("integrator/h", h);
 
-		while ((t < t0 + h) && (t <= t1 + step)) {
-			Vector<long double> d(6);
-			long double theta = (t - t0) / h;
+		if (uniform && output) {
+			arena_scope scope(arena);
+			while ((t - t0 < h) && (t - t1 <= step)) {
+				system.add_result(dense_output(x0, k, h, (t - t0) / h), t.to_seconds());
+				t += step;
+			}
+		}
+		arena.reset();
 
-			d.at(0) = theta * (1 + theta * (-1337.0l / 480.0l + theta * (1039.0l / 360.0l + theta * (-1163.0l / 1152.0l))));
-			d.at(1) = 0;
-			d.at(2) = 100.0l * pow(theta, 2.0l) * (1054.0l / 9275.0l + theta * (-4682.0l / 27825.0l + theta * (379.0l / 5565.0l))) / 3.0l;
-			d.at(3) = -5.0l * pow(theta, 2.0l) * (27.0l / 40.0l + theta * (-9.0l / 5.0l + theta * (83.0l / 96.0l))) / 2.0l;
-			d.at(4) = 18225.0l * pow(theta, 2.0l) * (-3.0l / 250.0l + theta * (22.0l / 375.0l + theta * (-37.0l / 600.0l))) / 848.0l;
-			d.at(5) = -22.0l * pow(theta, 2.0l) * (-3.0l / 10.0l + theta * (29.0l / 30.0l + theta * (-17.0l / 24.0l))) / 7.0l;
+		if (segments || (!uniform && output)) {
+			dense_segment<T> segment{ t0, h, x0, Vector<Vector<T>>(6) };
+			for (uint64_t count = 0u; count < 6u; ++count)
+				segment.k.at(count) = k.at(count);
 
-			Vector<long double> res = x0 + h * (d(0) * k(0) + d(1) * k(1) + d(2) * k(2) + d(3) * k(3) + d(4) * k(4) + d(5) * k(5));
-			system.add_result(res, t);
-			t += step;
+			// модель с собственной выдачей получает шаг целиком
+			if (!uniform && output)
+				system.add_segment(segment);
+			if (segments)
+				segments->push_back(segment);
 		}
+		if (output)
+			system.flush_results();
+
+		if (last)
+			t0 = t1;
+		else
+			t0 += h;
 
-		t0 += h;
-		x0 = x1_;
+		// x0 += dx с компенсацией: малые приращения не теряются на фоне |x0| ~ 1e11
+		for (uint64_t count = 0u; count < x0.dimension(); ++count)
+			two_sum(x0.at(count), dx.at(count) + x0_err.at(count), x0.at(count), x0_err.at(count));
+
+		k.at(0) = k.at(6);
+
+		state.k_last = k.at(0);
+		++state.steps;
+
+		if (!output)
+			continue;
+
+		if (checkpoint_file && checkpoint_every && state.steps % checkpoint_every == 0u)
+			save_checkpoint(checkpoint_file, state, system);
+
+		if (system.finished())
+			break;
 	}
 
-	//clock_t end_time = clock();
+	if (checkpoint_file && output)
+		save_checkpoint(checkpoint_file, state, system);
+}
+
+template<typename T>
+dense_trajectory<T> DormandPrinceIntegrator<T>::trajectory(model_t<T>& system) {
+	LR5_SCOPE("integrator/trajectory");
+	step_state<T> state = initial_state(system);
+	state.k_last = system.get_right(state.x0, system.get_t0());
+
+	return dense_trajectory<T>(*this, system, state);
+}
+
+template struct dense_segment<double>;
+template struct dense_segment<long double>;
+template class DormandPrinceIntegrator<double>;
+template class DormandPrinceIntegrator<long double>;
 
-	//std::cout << "Elapsed time: " << -(start_time - end_time) / 1000000.0 << " s" << '\n';
-}
\ No newline at end of file
+template void write_binary(std::ostream& out, const step_state<double>& state);
+template void write_binary(std::ostream& out, const step_state<long double>& state);
+template void read_binary(std::istream& in, step_state<double>& state);
+template void read_binary(std::istream& in, step_state<long double>& state);
+template void write_binary(std::ostream& out, const dense_segment<double>& segment);
+template void write_binary(std::ostream& out, const dense_segment<long double>& segment);
+template void read_binary(std::istream& in, dense_segment<double>& segment);
+template void read_binary(std::istream& in, dense_segment<long double>& segment);
@@ -1,44 +1,73 @@
 #pragma once
 
-#include <ctime>
 #include "model.hpp"
+#include "compensated.hpp"
+#include "arena.hpp"
+#include "dormand_prince.hpp"
 
 
+template<typename T>
+struct step_state {
+	split_epoch<T> t0;
+	split_epoch<T> t;
+	T h;
+	uint64_t steps;
+	Vector<T> x0;
+	Vector<T> x0_err; // компенсация округления при накоплении x0
+	Vector<T> k_last; // FSAL: правая часть в конце последнего принятого шага
+};
+
+template<typename T> void write_binary(std::ostream& out, const step_state<T>& state);
+template<typename T> void read_binary(std::istream& in, step_state<T>& state);
+
+template<typename T>
+class trajectory_cache;
+
+template<typename T>
+class dense_trajectory;
+
+template<typename T>
 class Integrator {
 protected:
-	long double eps = 1e-8l;
+	T eps = 1e-8l;
 public:
-	Integrator(long double eps) : eps(eps) {};
-	virtual void run(model_t& system)=0;
+	Integrator(T eps) : eps(eps) {};
+	virtual void run(model_t<T>& system)=0;
 };
 
-class DormandPrinceIntegrator : public Integrator {
+template<typename T>
+class DormandPrinceIntegrator : public Integrator<T> {
 protected:
-	const Vector<long double> c = Vector<long double>({
-			0.0l,	0.2l, 0.3l, 0.8l, 8.0l/9.0l, 1.0l, 1.0l
-		});
-
-	const Matrix<long double> a = Matrix<long double>(7, 7, {
-			0,				0,					0,				0,				0,					0,			0,
-			1.0l/5.0l,		0,					0,				0,				0,					0,			0,
-			3.0l/40.0l,		9.0l/40.0l,			0,				0,				0,					0,			0,
-			44.0l/45.0l,		-56.0l/15.0l,			32.0l/9.0l,		0,				0,					0,			0,
-			19372.0l/6561.0l, -25360.0l/2187.0l,	64448.0l/6561.0l, -212.0l/729.0l,	0,					0,			0,
-			9017.0l/3168.0l,	-355.0l/33.0l,		46732.0l/5247.0l,	49.0l/176.0l,		-5103.0l/18656.0l,	0,			0,
-			35.0l/384.0l,		0,					500.0l/1113.0l,	125.0l/192.0l,	-2187.0l/6784.0l,		11.0l/84.0l,	0
-		});
-
-	const Vector<long double> b = Vector<long double>({
-			35.0l / 384.0l,	0,	500.0l / 1113.0l,	125.0l / 192.0l,	-2187.0l / 6784.0l,	11.0l / 84.0l,	0
-		});
-
-	const Vector<long double> b1 = Vector<long double>({
-			5179.0l/57600.0l,	0,	7571.0l/16695.0l,	393.0l/640.0l,	-92097.0l/339200.0l,	187.0l/2100.0l,	1.0l/40.0l
-		});
-
-	Vector<Vector<long double>> k{ 7 };
+	using Integrator<T>::eps;
+
+	Vector<Vector<T>> k{ 7 };
+	monotonic_arena arena;
+
+	const char* checkpoint_file = nullptr;
+	uint64_t checkpoint_every = 0u;
+	uint64_t checkpoint_rows = 0u; // строк выдачи уже в файле <checkpoint>.rows
+	trajectory_cache<T>* cache = nullptr;
+
+	step_state<T> initial_state(const model_t<T>& system) const;
+	// output = false - модель не получает выдачу (add_result, add_segment), контрольные точки не пишутся
+	void integrate(model_t<T>& system, step_state<T>& state, std::vector<dense_segment<T>>* segments = nullptr, bool output = true);
+	void replay(model_t<T>& system, const std::vector<dense_segment<T>>& segments, step_state<T>& state);
+
+	friend class dense_trajectory<T>;
 public:
-	DormandPrinceIntegrator(long double eps) : Integrator(eps) {};
-	
-	virtual void run(model_t& system) override;
+	DormandPrinceIntegrator(T eps) : Integrator<T>(eps) {};
+
+	void set_checkpoint(const char* filename, uint64_t every_steps) noexcept;
+	// контрольная точка - состояние шага и наблюдателя; строки выдачи дописываются в <filename>.rows,
+	// поэтому объём записи за расчёт растёт линейно с числом строк
+	void save_checkpoint(const char* filename, const step_state<T>& state, const model_t<T>& system);
+	// eps интегратора должен совпадать с сохранённым
+	void load_checkpoint(const char* filename, step_state<T>& state, model_t<T>& system);
+	void resume(model_t<T>& system, const char* filename);
+	void set_cache(trajectory_cache<T>* trajectories) noexcept;
+
+	virtual void run(model_t<T>& system) override;
+	// траектория без выдачи в модель; интегрирование - при первом запросе (хотя бы до t1) и при запросах
+	// за концом, поэтому интегратор и модель должны жить, пока используется траектория
+	dense_trajectory<T> trajectory(model_t<T>& system);
 };
\ No newline at end of file
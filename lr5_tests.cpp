@@ -0,0 +1,836 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "async_writer.hpp"
+#include "batch_integrator.hpp"
+#include "chebyshev.hpp"
+#include "column_codec.hpp"
+#include "cr3bp.hpp"
+#include "daylight_stats.hpp"
+#include "dense_trajectory.hpp"
+#include "earth_orientation.hpp"
+#include "horizon_detector.hpp"
+#include "monte_carlo.hpp"
+#include "nbody.hpp"
+#include "site_frame.hpp"
+#include "trajectory_cache.hpp"
+#include "unscented.hpp"
+
+// lr5_tests [проверка]: без аргумента - все проверки по очереди; ctest запускает каждую отдельно.
+// Сравнения точные: продолжение, воспроизведение и кодеки обязаны давать те же биты
+
+static void check(bool condition, const std::string& what) {
+	if (!condition)
+		throw std::runtime_error(what);
+}
+
+static bool same_tables(const result_table& a, const result_table& b) {
+	if (a.cols() != b.cols() || a.rows() != b.rows())
+		return false;
+
+	for (uint64_t col = 0u; col < a.cols(); ++col)
+		if (a.info(col).name != b.info(col).name || a.info(col).type != b.info(col).type)
+			return false;
+
+	for (uint64_t row = 0u; row < a.rows(); ++row)
+		for (uint64_t col = 0u; col < a.cols(); ++col)
+			if (a.value(row, col) != b.value(row, col))
+				return false;
+
+	return true;
+}
+
+static const real_t tolerance = scalar_traits<real_t>::tolerance;
+static const real_t φ = rad(55), λ = rad(37);
+
+static real_t test_date() {
+	return get_JDN(2024, 3, 15, 0, 0, 0);
+}
+
+// выдача прерывается исключением на первом моменте после crash_at - как при падении расчёта
+struct model_crash {};
+
+template<typename T>
+class crashing_sundial : public sundial_model<T> {
+private:
+	T crash_at;
+public:
+	crashing_sundial(T φ_, T λ_, T date_, T crash_at) : sundial_model<T>(φ_, λ_, date_), crash_at(crash_at) {};
+
+	void add_result(const Vector<T>& X, T t) override {
+		if (t > crash_at)
+			throw model_crash();
+		sundial_model<T>::add_result(X, t);
+	}
+};
+
+// продолжение с контрольной точки прерванного расчёта совпадает с расчётом без перерыва
+static void test_resume() {
+	const char* filename = "lr5_tests_resume.bin";
+
+	sundial_model<real_t> straight(φ, λ, test_date());
+	DormandPrinceIntegrator<real_t>(tolerance).run(straight);
+	check(straight.get_result().rows() > 0u, "resume: empty straight run");
+
+	const real_t crash_at = straight.get_t0() + 0.6l * (straight.get_t1() - straight.get_t0());
+	crashing_sundial<real_t> crashed(φ, λ, test_date(), crash_at);
+	DormandPrinceIntegrator<real_t> interrupted(tolerance);
+	interrupted.set_checkpoint(filename, 3u);
+
+	bool thrown = false;
+	try {
+		interrupted.run(crashed);
+	}
+	catch (const model_crash&) {
+		thrown = true;
+	}
+	check(thrown, "resume: run was not interrupted");
+	check(crashed.get_result().rows() < straight.get_result().rows(), "resume: crash after the last row");
+
+	sundial_model<real_t> resumed(φ, λ, test_date());
+	DormandPrinceIntegrator<real_t>(tolerance).resume(resumed, filename);
+	check(same_tables(resumed.get_result(), straight.get_result()), "resume: result differs from the straight run");
+
+	std::remove(filename);
+	std::remove((std::string(filename) + ".rows").c_str());
+}
+
+// выдача по сохранённой траектории совпадает с расчётом без кэша
+static void test_cache_replay() {
+	sundial_model<real_t> fresh(φ, λ, test_date());
+	DormandPrinceIntegrator<real_t>(tolerance).run(fresh);
+
+	trajectory_cache<real_t> cache;
+	for (int pass = 0; pass < 2; ++pass) {
+		sundial_model<real_t> cached(φ, λ, test_date());
+		DormandPrinceIntegrator<real_t> integrator(tolerance);
+		integrator.set_cache(&cache);
+		integrator.run(cached);
+		check(same_tables(cached.get_result(), fresh.get_result()), pass ? "cache: replay differs from a fresh run" : "cache: first run differs from a fresh run");
+	}
+	check(!cache.get(trajectory_cache<real_t>::make_key(fresh, tolerance)).segments.empty(), "cache: trajectory not stored");
+}
+
+static result_table codec_table() {
+	result_table table({
+		{ "t", column_type::float64 },
+		{ "x", column_type::float64 },
+		{ "shadow", column_type::float32 },
+		{ "sunrise", column_type::int32 },
+	});
+
+	counter_rng rng(7u, 0u);
+	for (uint64_t row = 0u; row < 5000u; ++row) {
+		table.append(0, 2460310.5 * 86400.0 + 60.0 * row);
+		table.append(1, row % 977u ? 1.5e11 * sin(row * 1e-3) + rng.normal() : -0.0);
+		table.append(2, float(rng.normal(0.0, 3.0)));
+		table.append(3, int32_t(row * 7919u % 86400u) - 43200);
+	}
+	return table;
+}
+
+// delta_varint и gorilla (column_codec) восстанавливают таблицу без потерь
+static void test_codec() {
+	const result_table table = codec_table();
+	const char* filename = "lr5_tests_codec.bin";
+
+	{
+		async_writer writer(filename, table, writer_format::delta_varint, 512u);
+		writer.push_rows(table, 0u, table.rows());
+		writer.close();
+	}
+	{
+		std::ifstream in(filename, std::ios::binary);
+		result_table decoded;
+		read_delta_varint(in, decoded);
+		check(same_tables(decoded, table), "codec: delta_varint round trip");
+	}
+
+	{
+		async_writer writer(filename, table, writer_format::gorilla, 512u);
+		writer.push_rows(table, 0u, table.rows());
+		writer.close();
+	}
+	{
+		std::ifstream in(filename, std::ios::binary);
+		result_table decoded;
+		read_encoded(in, decoded);
+		check(same_tables(decoded, table), "codec: gorilla writer round trip");
+	}
+
+	std::stringstream buffer;
+	write_encoded(buffer, table);
+	result_table decoded;
+	read_encoded(buffer, decoded);
+	check(same_tables(decoded, table), "codec: gorilla round trip");
+
+	std::remove(filename);
+}
+
+// оценка погрешности эфемериды не превышена между её контрольными точками; вне [t_begin, t_end] - out_of_range
+static void test_chebyshev() {
+	const real_t t0 = 2460310.50 * 86400.0, t1 = t0 + 365.0 * 86400.0;
+	earth_move_model<real_t> model(Vector<real_t>({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 }), t0, t1, t1 - t0);
+
+	trajectory_cache<real_t> cache;
+	DormandPrinceIntegrator<real_t> integrator(tolerance);
+	integrator.set_cache(&cache);
+	integrator.run(model);
+	const auto& segments = cache.get(trajectory_cache<real_t>::make_key(model, tolerance)).segments;
+
+	chebyshev_ephemeris ephemeris = chebyshev_ephemeris::fit(segments, t0, t1, 4.0 * 86400.0, 12u);
+	check(ephemeris.segments() == 92u, "chebyshev: segment count");
+	check(ephemeris.max_error() < 1.0, "chebyshev: error estimate above 1 m");
+	check(ephemeris.max_velocity_error() > 0.0 && ephemeris.max_velocity_error() < 1e-3, "chebyshev: velocity error estimate");
+
+	// проверочные точки не совпадают ни с узлами, ни с точками оценки
+	double worst = 0, worst_velocity = 0;
+	uint64_t next = 0u;
+	for (uint64_t count = 0u; count < 20000u; ++count) {
+		long double t = t0 + (t1 - t0) * ((count * 7919u) % 20000u + 0.37l) / 20000.0l;
+		while (next + 1u < segments.size() && segments[next + 1u].t0.to_seconds() <= t)
+			++next;
+		while (next > 0u && segments[next].t0.to_seconds() > t)
+			--next;
+
+		Vector<real_t> X = segments[next].state(real_t(t));
+		double r[3], v[3];
+		ephemeris.state(t, r, v);
+		worst = std::max(worst, sqrt(pow(r[0] - double(X.at(0)), 2) + pow(r[1] - double(X.at(1)), 2) + pow(r[2] - double(X.at(2)), 2)));
+		worst_velocity = std::max(worst_velocity, sqrt(pow(v[0] - double(X.at(3)), 2) + pow(v[1] - double(X.at(4)), 2) + pow(v[2] - double(X.at(5)), 2)));
+	}
+	check(worst <= 1.5 * ephemeris.max_error(), "chebyshev: error above the estimate");
+	check(worst_velocity <= 1.5 * ephemeris.max_velocity_error(), "chebyshev: velocity error above the estimate");
+
+	ephemeris.save("chebyshev_test.bin");
+	chebyshev_ephemeris loaded;
+	loaded.load("chebyshev_test.bin");
+	std::remove("chebyshev_test.bin");
+	check(loaded.max_velocity_error() == ephemeris.max_velocity_error() && loaded.error(91u) == ephemeris.error(91u), "chebyshev: saved error estimates");
+
+	double r[3];
+	ephemeris.position(t1, r);
+	bool thrown = false;
+	try {
+		ephemeris.position(t1 + 1.0, r);
+	}
+	catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	check(thrown, "chebyshev: query after t_end");
+}
+
+// временные векторы шага берутся из арены: число выделений в куче не зависит от числа шагов
+static void test_arena() {
+	const real_t t0 = 2460310.50 * 86400.0;
+	const Vector<real_t> x0({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 });
+
+	allocation_stats counts[2];
+	for (int run = 0; run < 2; ++run) {
+		const real_t t1 = t0 + (run ? 60.0 : 30.0) * 86400.0;
+		earth_move_model<real_t> model(x0, t0, t1, t1 - t0);
+		DormandPrinceIntegrator<real_t> integrator(tolerance);
+
+		allocation_stats before = allocation_counters();
+		integrator.run(model);
+		allocation_stats after = allocation_counters();
+
+		counts[run].heap_allocations = after.heap_allocations - before.heap_allocations;
+		counts[run].arena_allocations = after.arena_allocations - before.arena_allocations;
+	}
+
+	check(counts[0].arena_allocations > 0u, "arena: step temporaries not taken from the arena");
+	check(counts[1].arena_allocations > counts[0].arena_allocations, "arena: arena allocations do not grow with the step count");
+	check(counts[1].heap_allocations == counts[0].heap_allocations, "arena: heap allocations grow with the step count");
+
+	// перемещение не бросает и забирает память: рост std::vector переносит сегменты, а не копирует
+	check(std::is_nothrow_move_constructible<Vector<double>>::value, "arena: Vector move may throw");
+	check(std::is_nothrow_move_constructible<Matrix<double>>::value, "arena: Matrix move may throw");
+	check(std::is_nothrow_move_constructible<dense_segment<double>>::value, "arena: dense_segment move may throw");
+	check(std::is_nothrow_move_constructible<step_state<double>>::value, "arena: step_state move may throw");
+
+	std::vector<Vector<double>> grown(1, Vector<double>(6));
+	const double* buffer = &grown[0][0];
+	grown.resize(grown.capacity() + 1u);
+	check(&grown[0][0] == buffer, "arena: vector growth copies elements");
+}
+
+// итоги Монте-Карло не зависят от числа потоков
+static void test_monte_carlo() {
+	auto trial = [](uint64_t sample, counter_rng& rng, double* outputs) {
+		outputs[0] = rng.normal(1.0, 2.0);
+		outputs[1] = rng.uniform() * double(sample % 17u);
+		if (sample % 5u)
+			outputs[2] = rng.normal();
+	};
+
+	std::vector<std::string> results[2];
+	for (int run = 0; run < 2; ++run) {
+		monte_carlo mc({ "normal", "uniform", "sparse" });
+		mc.set_seed(42u);
+		mc.set_chunk(16u);
+		mc.set_threads(run ? 4u : 1u);
+		mc.run(700u, trial);
+		mc.run(300u, trial);
+		check(mc.samples() == 1000u, "monte carlo: sample count");
+
+		for (uint64_t output = 0u; output < mc.outputs(); ++output) {
+			const running_stats& stats = mc.get_stats(output);
+			char line[256];
+			std::snprintf(line, sizeof(line), "%llu %a %a %a %a %a %a %a %llu", (unsigned long long)stats.count, stats.mean, stats.m2, stats.min, stats.max,
+				mc.quantile(output, 0u), mc.quantile(output, 1u), mc.quantile(output, 2u), (unsigned long long)mc.get_missing(output));
+			results[run].push_back(line);
+		}
+	}
+
+	check(results[0] == results[1], "monte carlo: result depends on the thread count");
+}
+
+// летнее время ЕС и выбор правила по календарному дню, а не по числу полученных дней
+static void test_dst() {
+	// 2024: 31 марта - 27 октября, 2023: 26 марта - 29 октября (день перехода назад уже зимний)
+	dst_rule eu2024 = dst_rule::eu(2024), eu2023 = dst_rule::eu(2023);
+	check(eu2024.first_day == 91 && eu2024.last_day == 300 && eu2024.shift == 3600.0, "dst: eu 2024");
+	check(eu2023.first_day == 85 && eu2023.last_day == 301, "dst: eu 2023");
+	check(!eu2024.active(90) && eu2024.active(91) && eu2024.active(300) && !eu2024.active(301), "dst: eu 2024 boundaries");
+
+	// восход 5:00, заход 19:30 при окне 8-20 ч: 11.5 ч без сдвига, 12 ч со сдвигом на час
+	daylight_stats stats({ { "eu", {}, eu2024 } });
+	std::vector<int> observed;
+	stats.set_observer([&](const day_record& record) { observed.push_back(record.day); });
+
+	// расчёт начинается летом и пропускает дни: правило выбирается по номеру дня в году
+	stats.add_day(200, 5.0 * 3600.0, 19.5 * 3600.0);
+	stats.add_day(320, 5.0 * 3600.0, 19.5 * 3600.0);
+	stats.add_day(10, 5.0 * 3600.0, 19.5 * 3600.0);
+
+	const usable_summary& summary = stats.summary(0u);
+	check(stats.days() == 3 && observed == std::vector<int>({ 200, 320, 10 }), "dst: day numbers");
+	check(summary.summer.days == 1 && summary.summer.total == 12.0 * 3600.0 && summary.summer.min_day == 200, "dst: summer day");
+	check(summary.winter.days == 2 && summary.winter.total == 23.0 * 3600.0, "dst: winter days");
+
+	stats.clear();
+	check(stats.days() == 0 && stats.summary(0u).year.days == 0, "dst: clear");
+}
+
+// уточнение пересечений методом Иллинойса: высота sin(t) с грубым шагом выборки, моменты известны точно
+static void test_horizon() {
+	using namespace math_const;
+	const std::vector<elevation_threshold> thresholds = { { "zero", 0.0 }, { "low", -0.5 } };
+	auto elevation_at = [](double t) { return sin(t); };
+
+	horizon_detector<double> detector(thresholds), resumed(thresholds);
+	detector.set_tolerance(1e-10);
+	resumed.set_tolerance(1e-10);
+
+	// на середине выборки состояние сохраняется и продолжается другим детектором
+	std::stringstream state;
+	for (int sample = 0; sample <= 15; ++sample) {
+		double t = 0.1 + 0.7 * sample;
+		detector.add_sample(t, sin(t), elevation_at);
+		if (sample == 7) {
+			detector.save_state(state);
+			resumed.load_state(state);
+		}
+		else if (sample > 7)
+			resumed.add_sample(t, sin(t), elevation_at);
+	}
+
+	// заход за 0 в π, за -0.5 в 7π/6, восход в 2π и 11π/6, снова заход в 3π и 19π/6;
+	// оба восхода в одном шаге выборки - события шага идут по номеру порога
+	const int32_t expected_threshold[] = { 0, 1, 0, 1, 0, 1 };
+	const int32_t expected_rising[] = { 0, 0, 1, 1, 0, 0 };
+	const double expected_time[] = { π, 7.0 * π / 6.0, 2.0 * π, 11.0 * π / 6.0, 3.0 * π, 19.0 * π / 6.0 };
+
+	const result_table& events = detector.get_events();
+	check(events.rows() == 6u, "horizon: crossing count");
+	auto threshold = events.column_as<int32_t>(horizon_detector<double>::threshold);
+	auto rising = events.column_as<int32_t>(horizon_detector<double>::rising);
+	auto time = events.column_as<double>(horizon_detector<double>::time);
+	for (uint64_t row = 0u; row < 6u; ++row) {
+		check(threshold[row] == expected_threshold[row] && rising[row] == expected_rising[row], "horizon: crossing order");
+		check(fabs(time[row] - expected_time[row]) < 1e-9, "horizon: crossing moment");
+	}
+
+	check(same_tables(events, resumed.get_events()), "horizon: resumed detector differs");
+}
+
+// рекуррентность звёздного угла против прямого расчёта, в том числе через пересинхронизацию
+static void test_site_frame() {
+	site_frame<double> frame(φ, λ, 1.7565, 7.292115e-5);
+	const uint64_t steps = 3u * site_frame<double>::resync_every;
+
+	std::vector<double> first;
+	double drift = 0;
+	for (uint64_t step = 0u; step < steps; ++step) {
+		double t = 60.0 * step;
+		site_rotation<double> r = frame.advance(t), exact = frame.at(t);
+		drift = std::max(drift, std::max(fabs(r.cos_s - exact.cos_s), fabs(r.sin_s - exact.sin_s)));
+		first.push_back(r.sin_s);
+
+		// первые два момента и каждый (resync_every + 1)-й после них считаются напрямую
+		if (step < 2u || (step - 1u) % (site_frame<double>::resync_every + 1u) == 0u)
+			check(r.cos_s == exact.cos_s && r.sin_s == exact.sin_s, "site_frame: resync is not exact");
+	}
+	check(drift < 1e-12, "site_frame: recurrence drifts from at()");
+
+	// другой шаг - снова прямой расчёт
+	site_rotation<double> irregular = frame.advance(60.0 * steps + 17.0), exact = frame.at(60.0 * steps + 17.0);
+	check(irregular.cos_s == exact.cos_s && irregular.sin_s == exact.sin_s, "site_frame: step change without resync");
+
+	// после reset проход повторяется до бита
+	frame.reset();
+	for (uint64_t step = 0u; step < steps; ++step)
+		check(frame.advance(60.0 * step).sin_s == first[step], "site_frame: rerun after reset differs");
+}
+
+// звёздное время и прецессия-нутация против опубликованных значений (примеры SOFA и Meeus)
+static void test_orientation() {
+	const double arcsec = math_const::π / 648000.0;
+
+	// SOFA: iauEra00 (JD 2454388.5), iauGmst06 и iauGst06a (UT1 = TT = JD 2453736.5)
+	const julian_date era_date{ 2400000.5, 54388.0 }, date{ 2400000.5, 53736.0 };
+	check(fabs(earth_rotation_angle(era_date) - 0.4022837240028158102) < 1e-12, "orientation: ERA");
+	check(fabs(gmst(date, date) - 1.754174972210740592) < 1e-9, "orientation: GMST");
+	// нутация усечена до ведущих членов: ~0.01"
+	check(fabs(gast(date, date) - 1.754166137675019159) < 0.01 * arcsec, "orientation: GAST");
+
+	// Meeus, пример 22.a: 1987-04-10 0h TD, Δψ = -3.788", Δε = +9.443"
+	nutation_angles angles = nutation(julian_date::from_calendar(1987, 4, 10));
+	check(fabs(angles.dpsi / arcsec + 3.788) < 0.01 && fabs(angles.deps / arcsec - 9.443) < 0.01, "orientation: nutation");
+
+	// SOFA iauPnm80 (TT = JD 2450123.4999): та же модель без сдвига рамки, по строкам
+	const double reference[9] = {
+		0.9999995831934611169, 0.8373654045728124011e-3, 0.3639121916933106191e-3,
+		-0.8373804896118301316e-3, 0.9999996485439674092, 0.4130202510421549752e-4,
+		-0.3638774789072144473e-3, -0.4160674085851722359e-4, 0.9999999329310274805,
+	};
+	double pn[9];
+	precession_nutation(julian_date{ 2400000.5, 50123.9999 }, pn);
+	for (int index = 0; index < 9; ++index)
+		check(fabs(pn[index] - reference[index]) < 0.01 * arcsec, "orientation: precession-nutation matrix");
+
+	// интерполяция по узлам кэша против прямого расчёта
+	earth_orientation orientation(julian_date::from_calendar(2024, 1, 1), 0.1);
+	double pn_cached[9], worst_angle = 0, worst_matrix = 0;
+	for (double t = 0; t < 10.0 * 86400.0; t += 3600.0 + 0.37) {
+		worst_angle = std::max(worst_angle, fabs(remainder(orientation.sidereal_angle(t) - gast(orientation.ut1(t), orientation.tt(t)), 2.0 * math_const::π)));
+		orientation.precession_nutation(t, pn_cached);
+		precession_nutation(orientation.tt(t), pn);
+		for (int index = 0; index < 9; ++index)
+			worst_matrix = std::max(worst_matrix, fabs(pn_cached[index] - pn[index]));
+	}
+	check(worst_angle < 1e-4 * arcsec && worst_matrix < 1e-4 * arcsec, "orientation: cached nodes differ from the direct calculation");
+	check(orientation.tt_minus_utc(0.0) == 69.184, "orientation: TT - UTC in 2024");
+}
+
+// ядро ускорений по строкам в пуле потоков против последовательного по парам
+static void test_nbody_threads() {
+	const real_t jd = 2460310.5;
+	std::vector<nbody_body<real_t>> bodies = solar_system<real_t>(jd, false);
+	for (uint64_t body = bodies.size(); body < 300u; ++body) {
+		real_t angle = 2.399963l * body;
+		real_t radius = (2.2l + 1.1l * (body % 97u) / 97.0l) * 1.495978707e11l;
+		bodies.push_back({ "a" + std::to_string(body), 1e8l, Vector<real_t>({ radius * cos(angle), radius * sin(angle), real_t(1e9l * (body % 13u)) }),
+			Vector<real_t>({ real_t(-1.8e4l * sin(angle)), real_t(1.8e4l * cos(angle)), 0.0l }) });
+	}
+
+	nbody_model<real_t> serial(bodies, jd * 86400.0, jd * 86400.0, 1.0), threaded(serial), three(serial);
+	threaded.set_threads(4u, 1u);
+	three.set_threads(3u, 1u);
+
+	const Vector<real_t> X = serial.get_init();
+	const Vector<real_t> expected = serial.get_right(X, 0.0), actual = threaded.get_right(X, 0.0);
+	check(expected.dimension() == actual.dimension(), "nbody threads: state size");
+
+	// порядок суммирования разный: сравнение с точностью до округления по каждой оси ускорения
+	const uint64_t N = serial.count();
+	for (uint64_t axis = 3u; axis < 6u; ++axis) {
+		real_t scale = 0, worst = 0;
+		for (uint64_t body = 0u; body < N; ++body) {
+			scale = std::max(scale, fabs(expected[axis * N + body]));
+			worst = std::max(worst, fabs(actual[axis * N + body] - expected[axis * N + body]));
+		}
+		check(worst <= 1e-12 * scale, "nbody threads: accelerations differ from the serial kernel");
+	}
+	for (uint64_t index = 0u; index < 3u * N; ++index)
+		check(actual[index] == expected[index], "nbody threads: velocities differ");
+
+	// строка считается одним потоком целиком: результат не зависит от разбиения, и пул переживает повторные вызовы
+	const Vector<real_t> again = three.get_right(X, 0.0), repeat = threaded.get_right(X, 0.0);
+	check(again == actual && repeat == actual, "nbody threads: result depends on the thread count");
+}
+
+// коррекция ляпуновской и гало-орбиты у L1 Земля - Луна: за найденный период орбита замыкается
+static void test_cr3bp_orbit() {
+	const real_t mu = 0.012150585609624l;
+	periodic_orbit_solver<real_t> solver(mu);
+
+	const std::vector<Vector<real_t>> guesses = {
+		Vector<real_t>({ 0.822l, 0.0l, 0.0l, 0.0l, 0.141l, 0.0l }),
+		Vector<real_t>({ 0.8234l, 0.0l, 0.0224l, 0.0l, 0.1343l, 0.0l }),
+	};
+	const orbit_family families[] = { orbit_family::lyapunov, orbit_family::halo };
+
+	for (uint64_t index = 0u; index < guesses.size(); ++index) {
+		periodic_orbit<real_t> orbit = solver.correct(families[index], guesses[index]);
+		check(orbit.converged && orbit.residual < 1e-9, "cr3bp orbit: correction did not converge");
+		check(orbit.x0.at(1) == 0 && orbit.x0.at(3) == 0 && orbit.x0.at(5) == 0, "cr3bp orbit: initial state is not symmetric");
+		// ляпуновская остаётся в плоскости, у гало фиксирован z0
+		check(orbit.x0.at(2) == guesses[index].at(2), "cr3bp orbit: fixed coordinate changed");
+
+		// полный период без матрицы чувствительности: найденная орбита возвращается в начальное состояние,
+		// начальное приближение - нет
+		real_t closure[2] = {};
+		Vector<real_t> end;
+		for (int run = 0; run < 2; ++run) {
+			const Vector<real_t>& x0 = run ? guesses[index] : orbit.x0;
+			cr3bp_model<real_t> model(mu, x0, 0.0, orbit.period, 0.0);
+			DormandPrinceIntegrator<real_t> integrator(1e-13l);
+			Vector<real_t> X = integrator.trajectory(model).state(orbit.period);
+			for (int axis = 0; axis < 6; ++axis)
+				closure[run] = std::max(closure[run], fabs(X.at(axis) - x0.at(axis)));
+			if (!run)
+				end = X;
+		}
+		check(closure[0] < 1e-8, "cr3bp orbit: orbit does not close over the period");
+		check(closure[1] > 1e-4, "cr3bp orbit: initial guess already closes");
+		check(fabs(cr3bp_model<real_t>::jacobi(mu, end) - orbit.jacobi) < 1e-10, "cr3bp orbit: Jacobi constant drifts");
+	}
+}
+
+// пакет полос против DormandPrinceIntegrator по каждому начальному условию: порядок операций тот же,
+// расхождение - только на уровне округления (векторизация по полосам в double)
+static void test_batch() {
+	const real_t t0 = 2460310.50 * 86400.0, t1 = t0 + 30.0 * 86400.0;
+	std::vector<Vector<real_t>> init;
+	for (uint64_t lane = 0u; lane < 4u; ++lane)
+		init.push_back(Vector<real_t>({ -2.6005047996994e10 + 1e6 * lane, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3 + 0.5 * lane, -2.043123e3 }));
+
+	for (int shared = 0; shared < 2; ++shared) {
+		earth_move_batch<real_t> batch(init, t0, t1, 86400.0);
+		batch_integrator<real_t> integrator(tolerance);
+		integrator.set_shared_step(shared);
+		integrator.run(batch);
+
+		for (uint64_t lane = 0u; lane < init.size(); ++lane) {
+			earth_move_model<real_t> model(init[lane], t0, t1, 86400.0);
+			DormandPrinceIntegrator<real_t>(tolerance).run(model);
+
+			const result_table& expected = model.get_result();
+			const result_table& actual = batch.get_result(lane);
+			check(expected.rows() == actual.rows(), "batch: lane output row count");
+			for (uint64_t axis = 0u; axis < 3u; ++axis)
+				for (uint64_t row = 0u; row < expected.rows(); ++row) {
+					double value = expected.column_as<double>(axis)[row];
+					check(fabs(actual.column_as<double>(axis)[row] - value) <= 1e-14 * fabs(value), "batch: lane differs from the serial integrator");
+				}
+
+			// конечное состояние полосы - конец последнего шага, у последовательного - плотная выдача в t1
+			earth_move_model<real_t> free_model(init[lane], t0, t1, 0.0);
+			Vector<real_t> end = integrator.state(lane), serial_end = DormandPrinceIntegrator<real_t>(tolerance).trajectory(free_model).state(t1);
+			for (int axis = 0; axis < 6; ++axis)
+				check(fabs(end.at(axis) - serial_end.at(axis)) <= 1e-12 * fabs(serial_end.at(axis)), "batch: lane end state differs");
+			if (shared)
+				check(integrator.accepted_steps(lane) == integrator.accepted_steps(0u) && integrator.rejected_steps(lane) == integrator.rejected_steps(0u), "batch: shared step differs between lanes");
+		}
+	}
+}
+
+// ковариация через 30 суток по сигма-точкам против линеаризованной Φ P Φ^T (Φ - центральными разностями)
+static void test_unscented() {
+	const real_t t0 = 2460310.50 * 86400.0, t1 = t0 + 30.0 * 86400.0;
+	const Vector<real_t> x0({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 });
+	auto make = [&](const std::vector<Vector<real_t>>& init) {
+		return std::unique_ptr<batch_model<real_t>>(new earth_move_batch<real_t>(init, t0, t1, t1 - t0));
+	};
+
+	// СКО 10 км и 1 мм/с, положение и скорость слабо коррелированы
+	gaussian_state<real_t> initial{ x0, Matrix<real_t>(6, 6) };
+	for (uint64_t axis = 0u; axis < 3u; ++axis) {
+		initial.covariance.at(axis, axis) = 1e8;
+		initial.covariance.at(3 + axis, 3 + axis) = 1e-6;
+		initial.covariance.at(axis, 3 + axis) = initial.covariance.at(3 + axis, axis) = 2e-2;
+	}
+
+	gaussian_state<real_t> propagated = unscented_propagator<real_t>(tolerance).propagate(initial, make);
+
+	// столбцы Φ: возмущение на шаг sqrt(P_jj) в обе стороны, все траектории и опорная одним пакетом
+	std::vector<Vector<real_t>> init;
+	for (uint64_t column = 0u; column < 6u; ++column)
+		for (int sign = -1; sign <= 1; sign += 2) {
+			Vector<real_t> x = x0;
+			x.at(column) += sign * sqrt(initial.covariance.at(column, column));
+			init.push_back(x);
+		}
+	init.push_back(x0);
+	std::unique_ptr<batch_model<real_t>> model = make(init);
+	batch_integrator<real_t> integrator(tolerance);
+	integrator.run(*model);
+
+	Matrix<real_t> Φ(6, 6);
+	for (uint64_t column = 0u; column < 6u; ++column) {
+		Vector<real_t> difference = integrator.state(2u * column + 1u) - integrator.state(2u * column);
+		for (uint64_t row = 0u; row < 6u; ++row)
+			Φ.at(row, column) = difference.at(row) / (2.0 * sqrt(initial.covariance.at(column, column)));
+	}
+
+	double worst = 0;
+	for (uint64_t row = 0u; row < 6u; ++row)
+		for (uint64_t col = 0u; col < 6u; ++col) {
+			real_t linear = 0;
+			for (uint64_t i = 0u; i < 6u; ++i)
+				for (uint64_t j = 0u; j < 6u; ++j)
+					linear += Φ.at(row, i) * initial.covariance.at(i, j) * Φ.at(col, j);
+			// относительно sqrt(P_rr P_cc), чтобы малые недиагональные элементы не давали ложных расхождений
+			real_t scale = sqrt(propagated.covariance.at(row, row) * propagated.covariance.at(col, col));
+			worst = std::max(worst, double(fabs(propagated.covariance.at(row, col) - linear) / scale));
+		}
+	check(worst < 1e-6, "unscented: covariance differs from the linearized one");
+
+	// при СКО 10 км нелинейность за месяц мала: среднее - почти опорная траектория
+	Vector<real_t> reference = integrator.state(12u);
+	for (uint64_t axis = 0u; axis < 6u; ++axis)
+		check(fabs(propagated.mean.at(axis) - reference.at(axis)) < 1e-3 * sqrt(propagated.covariance.at(axis, axis)), "unscented: mean differs from the reference trajectory");
+}
+
+// файлы async_writer во всех форматах: строки приходят кусками, по одной и после flush неполного блока;
+// текст совпадает с load_res2file, двоичные форматы читаются без потерь
+static void test_writer() {
+	const result_table table = codec_table();
+	const char* filename = "lr5_tests_writer.out";
+	const writer_format formats[] = { writer_format::text, writer_format::delta_varint, writer_format::gorilla };
+
+	for (writer_format format : formats) {
+		async_writer writer(filename, table, format, 64u, 2u);
+		writer.push_rows(table, 0u, 1000u);
+		writer.flush();
+		for (uint64_t row = 1000u; row < 1100u; ++row) {
+			double values[4];
+			for (uint64_t col = 0u; col < table.cols(); ++col)
+				values[col] = table.value(row, col);
+			writer.push_row(values);
+		}
+		writer.push_rows(table, 1100u, table.rows());
+		writer.close();
+		check(writer.rows() == table.rows(), "writer: row count");
+
+		// текст пишется в текстовом режиме - так же он и читается, размер в байтах сравнивается для двоичных
+		std::ifstream in(filename, format == writer_format::text ? std::ios::in : std::ios::in | std::ios::binary);
+		std::stringstream content;
+		content << in.rdbuf();
+		check(format == writer_format::text || writer.bytes() == content.str().size(), "writer: byte count");
+
+		result_table decoded;
+		if (format == writer_format::text) {
+			std::stringstream expected;
+			for (uint64_t row = 0u; row < table.rows(); ++row) {
+				table.write_row(expected, row);
+				expected << '\n';
+			}
+			check(content.str() == expected.str(), "writer: text differs from load_res2file");
+			continue;
+		}
+		if (format == writer_format::delta_varint)
+			read_delta_varint(content, decoded);
+		else
+			read_encoded(content, decoded);
+		check(same_tables(decoded, table), "writer: binary round trip");
+	}
+
+	std::remove(filename);
+}
+
+// incremental_runner: смена параметров наблюдателя пересчитывает только выдачу по сохранённой траектории,
+// результат совпадает с расчётом с нуля до бита
+static void test_incremental_observer() {
+	incremental_runner<real_t> runner(tolerance);
+	sundial_model<real_t> model(φ, λ, test_date());
+	check(runner.run(model) == run_stage::trajectory, "incremental: first run");
+	check(runner.run(model) == run_stage::none, "incremental: unchanged model was re-run");
+
+	// поправка угла и место наблюдения
+	sundial_model<real_t> offset(φ, λ, test_date());
+	offset.set_rotation_offset(1e-4);
+	DormandPrinceIntegrator<real_t>(tolerance).run(offset);
+	model.set_rotation_offset(1e-4);
+	check(runner.run(model) == run_stage::observer, "incremental: rotation offset re-integrated the trajectory");
+	check(same_tables(model.get_result(), offset.get_result()), "incremental: rotation offset re-run differs from a fresh run");
+
+	sundial_model<real_t> moved(rad(40), rad(-3), test_date());
+	moved.set_rotation_offset(1e-4);
+	DormandPrinceIntegrator<real_t>(tolerance).run(moved);
+	model.set_site(rad(40), rad(-3));
+	check(runner.run(model) == run_stage::observer, "incremental: site change re-integrated the trajectory");
+	check(same_tables(model.get_result(), moved.get_result()), "incremental: site re-run differs from a fresh run");
+
+	// принудительный повтор даёт ту же выдачу
+	runner.invalidate();
+	check(runner.run(model) == run_stage::observer, "incremental: invalidate");
+	check(same_tables(model.get_result(), moved.get_result()), "incremental: repeated re-run differs");
+
+	// строки прошлого прохода уже в файле: сброс наблюдателя с подключённым writer запрещён
+	{
+		async_writer output("lr5_tests_incremental.txt", model.get_result());
+		model.set_writer(&output);
+		model.set_rotation_offset(2e-4);
+		bool thrown = false;
+		try {
+			runner.run(model);
+		}
+		catch (const std::logic_error&) {
+			thrown = true;
+		}
+		model.set_writer(nullptr);
+		output.close();
+		check(thrown, "incremental: observer reset with a writer attached");
+	}
+	std::remove("lr5_tests_incremental.txt");
+
+	// останов по событию - тоже параметр наблюдателя: повтор обрывается на том же пересечении
+	const real_t mu = 0.012150585609624l;
+	const Vector<real_t> x0({ 0.822l, 0.0l, 0.0l, 0.0l, 0.141l, 0.0l });
+	cr3bp_model<real_t> fresh_stop(mu, x0, 0.0, 10.0, 0.01);
+	fresh_stop.stop_at_crossing(2u);
+	DormandPrinceIntegrator<real_t>(tolerance).run(fresh_stop);
+
+	cr3bp_model<real_t> orbit(mu, x0, 0.0, 10.0, 0.01);
+	check(runner.run(orbit) == run_stage::trajectory, "incremental: cr3bp first run");
+	orbit.stop_at_crossing(2u);
+	check(runner.run(orbit) == run_stage::observer, "incremental: stop_at_crossing re-integrated the trajectory");
+	check(orbit.finished() && orbit.get_event_time() == fresh_stop.get_event_time() && orbit.get_event_state() == fresh_stop.get_event_state(),
+		"incremental: crossing differs from a fresh run");
+	check(same_tables(orbit.get_result(), fresh_stop.get_result()), "incremental: output after the crossing");
+}
+
+template<typename T>
+class crashing_earth : public earth_move_model<T> {
+public:
+	T crash_at;
+
+	crashing_earth(const Vector<T>& x0, T t0, T t1, T crash_at) : earth_move_model<T>(x0, t0, t1, 0.0), crash_at(crash_at) {};
+
+	Vector<T> get_right(const Vector<T>& X, T t) const override {
+		if (t > crash_at)
+			throw model_crash();
+		return earth_move_model<T>::get_right(X, t);
+	}
+};
+
+// плотная траектория против равномерной выдачи того же интегратора; продолжение за t1 и откат неудачного продолжения
+static void test_dense_trajectory() {
+	const real_t t0 = 2460310.50 * 86400.0, t1 = t0 + 30.0 * 86400.0;
+	const Vector<real_t> x0({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 });
+
+	earth_move_model<real_t> uniform(x0, t0, t1, 3600.0);
+	DormandPrinceIntegrator<real_t>(tolerance).run(uniform);
+	const result_table& expected = uniform.get_result();
+
+	crashing_earth<real_t> model(x0, t0, t1, t1 + 1e9);
+	DormandPrinceIntegrator<real_t> integrator(tolerance);
+	dense_trajectory<real_t> trajectory = integrator.trajectory(model);
+
+	// строки равномерной выдачи - моменты t0 + k inc, k = 1, 2, ...
+	const uint64_t rows = expected.rows();
+	std::vector<real_t> times(rows), states(rows * 6u);
+	for (uint64_t row = 0u; row < rows; ++row)
+		times[row] = t0 + 3600.0 * (row + 1u);
+	trajectory.state(times.data(), rows, states.data());
+
+	for (uint64_t row = 0u; row < rows; ++row) {
+		Vector<real_t> X = trajectory.state(times[row]);
+		for (uint64_t axis = 0u; axis < 6u; ++axis) {
+			double value = expected.value(row, axis);
+			check(states[row * 6u + axis] == X.at(axis), "dense trajectory: batch query differs from a single query");
+			check(fabs(double(X.at(axis)) - value) <= 1e-13 * fabs(value), "dense trajectory: state differs from the uniform output");
+		}
+	}
+	check(trajectory.begin() == t0 && trajectory.end() >= t1, "dense trajectory: covered interval");
+
+	// запрос за концом продолжает интегрирование
+	const real_t far = t1 + 10.0 * 86400.0;
+	earth_move_model<real_t> longer(x0, t0, far, 0.0);
+	Vector<real_t> reference = DormandPrinceIntegrator<real_t>(tolerance).trajectory(longer).state(far), X = trajectory.state(far);
+	for (uint64_t axis = 0u; axis < 6u; ++axis)
+		check(fabs(X.at(axis) - reference.at(axis)) <= 1e-9 * fabs(reference.at(axis)), "dense trajectory: extension differs from a longer run");
+	check(model.get_t1() == t1, "dense trajectory: extension changed t1");
+
+	// сбой интегрирования при продолжении: траектория и t1 модели прежние, после устранения продолжение идёт с того же места
+	const uint64_t size = trajectory.size();
+	const real_t end = trajectory.end();
+	const Vector<real_t> before = trajectory.state(far);
+	model.crash_at = end + 5.0 * 86400.0;
+
+	bool thrown = false;
+	try {
+		trajectory.extend(end + 30.0 * 86400.0);
+	}
+	catch (const model_crash&) {
+		thrown = true;
+	}
+	check(thrown, "dense trajectory: crash not propagated");
+	check(trajectory.size() == size && trajectory.end() == end && model.get_t1() == t1, "dense trajectory: failed extension changed the trajectory");
+	check(trajectory.state(far) == before, "dense trajectory: failed extension changed a stored state");
+
+	model.crash_at = end + 1e9;
+	trajectory.extend(end + 30.0 * 86400.0);
+	check(trajectory.size() > size && trajectory.end() >= end + 30.0 * 86400.0, "dense trajectory: extension after a failure");
+}
+
+struct test_case {
+	const char* name;
+	void (*run)();
+};
+
+static const test_case tests[] = {
+	{ "resume", test_resume },
+	{ "cache_replay", test_cache_replay },
+	{ "codec", test_codec },
+	{ "chebyshev", test_chebyshev },
+	{ "arena", test_arena },
+	{ "monte_carlo", test_monte_carlo },
+	{ "dst", test_dst },
+	{ "horizon", test_horizon },
+	{ "site_frame", test_site_frame },
+	{ "orientation", test_orientation },
+	{ "nbody_threads", test_nbody_threads },
+	{ "cr3bp_orbit", test_cr3bp_orbit },
+	{ "batch", test_batch },
+	{ "unscented", test_unscented },
+	{ "writer", test_writer },
+	{ "incremental_observer", test_incremental_observer },
+	{ "dense_trajectory", test_dense_trajectory },
+};
+
+int main(int argc, char** argv) {
+	int failed = 0;
+	bool found = false;
+
+	for (const test_case& test : tests) {
+		if (argc > 1 && std::string(argv[1]) != test.name)
+			continue;
+		found = true;
+
+		try {
+			test.run();
+			std::cout << test.name << ": ok" << '\n';
+		}
+		catch (const std::exception& e) {
+			std::cout << test.name << ": FAILED: " << e.what() << '\n';
+			++failed;
+		}
+	}
+
+	if (!found) {
+		std::cout << "unknown test: " << argv[1] << '\n';
+		return 1;
+	}
+
+	return failed ? 1 : 0;
+}
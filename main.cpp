@@ -1,28 +1,73 @@
-﻿#include <iostream>
-#include "src/constants.hpp"
-#include "src/model.hpp"
-#include "src/integrator.hpp"
+﻿#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include "constants.hpp"
+#include "model.hpp"
+#include "integrator.hpp"
 
 int sundial_test() {// в пределах дня
 
-	sundial_model model(rad(55), rad(37), get_JDN(2024, 3, 15, 0, 0, 0));
-	DormandPrinceIntegrator integrator(1e-16l);
+	sundial_model<real_t> model(rad(55), rad(37), get_JDN(2024, 3, 15, 0, 0, 0));
+	DormandPrinceIntegrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+
+	// строки пишутся в отдельном потоке по ходу интегрирования
+	async_writer output("res1.txt", model.get_result());
+	model.set_writer(&output);
 	integrator.run(model);
-	model.load_res2file("res1.txt");
+	output.close();
+
+	// та же тень с адаптивной выдачей: ночь пропускается, точки сгущаются на изгибах траектории
+	sundial_model<real_t> adaptive(rad(55), rad(37), get_JDN(2024, 3, 15, 0, 0, 0));
+	adaptive.set_adaptive(1e-3);
+	integrator.run(adaptive);
+	std::cout << "Adaptive sundial: " << adaptive.get_result().rows() << " points (uniform: " << model.get_result().rows() << ")" << '\n';
 
 	return 0;
 }
 
 int blag_test() { // год
-	blag_time_model model;
-	DormandPrinceIntegrator integrator(1e-16l);
+	blag_time_model<real_t> model;
+
+	// полезное освещение 8-20 ч: без перевода часов, +1 ч весь год, летнее время в дни 86-300 и по правилам ЕС
+	daylight_stats stats({
+		{ "standard", {}, dst_rule::none() },
+		{ "+1 h", {}, dst_rule::all_year(1.0) },
+		{ "dst 86-300", {}, dst_rule::days(86, 300, 1.0) },
+		{ "dst eu 2024", {}, dst_rule::eu(2024) },
+	});
+	model.set_daylight_stats(&stats);
+
+	DormandPrinceIntegrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+
+	async_writer output("res2.txt", model.get_result());
+	model.set_writer(&output);
 	integrator.run(model);
-	model.load_res2file("res2.txt");
+	output.close();
+
+	stats.report(std::cout);
+
+	// число уточнённых пересечений по каждому порогу высоты (летом астрономическая ночь не наступает)
+	const auto& detector = model.get_detector();
+	auto thresholds = detector.get_events().column_as<int32_t>(horizon_detector<real_t>::threshold);
+	for (uint64_t index = 0u; index < detector.count(); ++index) {
+		uint64_t events = std::count(thresholds.begin(), thresholds.end(), int32_t(index));
+		std::cout << detector.get_threshold(index).name << " crossings: " << events << '\n';
+	}
+
+	// звёздное время начала года по МАС 2006 против постоянной s_0 модели
+	julian_date utc = julian_date::from_calendar(2024, 1, 1);
+	julian_date tt = utc_to_tt(utc);
+	std::cout << "GAST 2024-01-01 00:00 UTC: " << gast(utc_to_ut1(utc, 0.0), tt) * 180.0 / math_const::π << " deg (model s_0: 100.6453 deg)" << '\n';
 
 	return 0;
 }
 
 int main() {
+#if defined(LR5_PROFILE)
+	// LR5_TRACE=<файл> включает запись трассы
+	const char* trace_file = getenv("LR5_TRACE");
+	profile::set_trace(trace_file != nullptr);
+#endif
 
 	// Запуск теста для модели солнечных часов
 	std::cout << "Running sundial test" << std::endl;
@@ -34,5 +79,11 @@ int main() {
 	blag_test();
 	std::cout << "Daylight duration analysis completed" << std::endl;
 
+#if defined(LR5_PROFILE)
+	profile::report(std::cout);
+	if (trace_file)
+		profile::write_trace(trace_file);
+#endif
+
 	return 0;
 }
\ No newline at end of file
@@ -4,11 +4,10 @@
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <utility>
+#include "arena.hpp"
 #include "vector.hpp"
 
-template<typename T>
-class Vector;
-
 template<typename T>
 inline size_t count_inverse(const std::vector<T>& vec) {
 	size_t count{};
@@ -25,20 +24,23 @@ inline void generate_permutation(std::vector<T>& vec, const size_t size) {
 	std::iota(vec.begin(), vec.end(), 0);
 }
 
-template<typename T>
+template<typename T, typename Alloc>
 class Matrix {
 private:
 	uint64_t _rows;
 	uint64_t _cols;
-	std::vector<T> _data;
+	std::vector<T, Alloc> _data;
 public:
 	Matrix() noexcept;
 	Matrix(uint64_t rows, uint64_t cols) noexcept;
-	Matrix(uint64_t rows, uint64_t cols, const Vector<T>& vec) noexcept;
+	Matrix(uint64_t rows, uint64_t cols, const Vector<T, Alloc>& vec) noexcept;
 	Matrix(uint64_t rows, uint64_t cols, const std::vector<T>& vec) noexcept;
 	Matrix(const std::vector<T>& vec);
-	Matrix(const Matrix<T>& mat);
-	Matrix<T>& operator=(const Matrix<T>& mat);
+	Matrix(const Matrix<T, Alloc>& mat);
+	// как у Vector: забирает память источника вместе с его аллокатором
+	Matrix(Matrix<T, Alloc>&& mat) noexcept;
+	Matrix<T, Alloc>& operator=(const Matrix<T, Alloc>& mat);
+	Matrix<T, Alloc>& operator=(Matrix<T, Alloc>&& mat) noexcept(std::allocator_traits<Alloc>::is_always_equal::value);
 	~Matrix();
 
 	T& at(int64_t row, int64_t col);
@@ -46,63 +48,78 @@ public:
 	T& operator()(int64_t row, int64_t col);
 	T operator()(int64_t row, int64_t col) const;
 
-	Matrix<T> operator-() const;
-	Matrix<T> operator+(const Matrix<T>& mat) const;
-	Matrix<T> operator*(const Matrix<T>& mat) const;
-	Vector<T> operator*(const Vector<T>& vec) const;
-	Matrix<T> operator!() const;
-	template<typename S> Matrix<T> operator*(const S& s) const;
-	template<typename S> friend std::ostream& operator<<(std::ostream& out, const Matrix<S>& mat);
-	template<typename S, typename U> friend Matrix<U> operator*(const S& val, const Matrix<U>& mat);
+	Matrix<T, Alloc>& operator+=(const Matrix<T, Alloc>& mat);
+	Matrix<T, Alloc>& operator-=(const Matrix<T, Alloc>& mat);
+	Matrix<T, Alloc>& operator*=(T s) noexcept;
+
+	Matrix<T, Alloc> operator-() const;
+	Matrix<T, Alloc> operator+(const Matrix<T, Alloc>& mat) const;
+	Matrix<T, Alloc> operator-(const Matrix<T, Alloc>& mat) const;
+	Matrix<T, Alloc> operator*(const Matrix<T, Alloc>& mat) const;
+	Vector<T, Alloc> operator*(const Vector<T, Alloc>& vec) const;
+	Matrix<T, Alloc> operator!() const;
+	// нижнетреугольная L, A = L * L^T (A симметрична и положительно определена)
+	Matrix<T, Alloc> cholesky() const;
+	template<typename S> Matrix<T, Alloc> operator*(const S& s) const;
+	template<typename S, typename A> friend std::ostream& operator<<(std::ostream& out, const Matrix<S, A>& mat);
+	template<typename S, typename U, typename A> friend Matrix<U, A> operator*(const S& val, const Matrix<U, A>& mat);
 
 	void resize(uint64_t rows, uint64_t cols);
-	void set_rows(int64_t row, const Vector<T>& vec);
+	void set_rows(int64_t row, const Vector<T, Alloc>& vec);
 	uint64_t cols() const;
 	uint64_t rows() const;
 	double determinate() const;
-	Vector<T> get_rows(uint64_t row) const;
-	Vector<T> get_cols(uint64_t col) const;
-	Matrix<T>& transpose() noexcept;
-	Matrix<T>& multiply(const Matrix<T>& mat) noexcept;
-	Matrix<T>& swap_rows(int64_t i, uint64_t j);
-	Matrix<T>& push_row(const Vector<T>& vec);
-	Matrix<T>& push_col(const Vector<T>& vec);
+	Vector<T, Alloc> get_rows(uint64_t row) const;
+	Vector<T, Alloc> get_cols(uint64_t col) const;
+	Matrix<T, Alloc>& transpose() noexcept;
+	Matrix<T, Alloc>& multiply(const Matrix<T, Alloc>& mat) noexcept;
+	Matrix<T, Alloc>& swap_rows(int64_t i, uint64_t j);
+	Matrix<T, Alloc>& push_row(const Vector<T, Alloc>& vec);
+	Matrix<T, Alloc>& push_col(const Vector<T, Alloc>& vec);
 	static Matrix<double> E(uint64_t size);
 };
 
-template<typename T>
-Matrix<T>::Matrix() noexcept : _rows(0), _cols(0) {};
+template<typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix() noexcept : _rows(0), _cols(0) {};
 
-template<typename T>
-Matrix<T>::Matrix(uint64_t rows, uint64_t cols) noexcept : _rows(rows), _cols(cols) {
+template<typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix(uint64_t rows, uint64_t cols) noexcept : _rows(rows), _cols(cols) {
 	_data.resize(_rows * _cols);
 }
 
-template<typename T>
-Matrix<T>::Matrix(uint64_t rows, uint64_t cols, const Vector<T>& vec) noexcept : Matrix(rows, cols) {
+template<typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix(uint64_t rows, uint64_t cols, const Vector<T, Alloc>& vec) noexcept : Matrix(rows, cols) {
 	for (uint64_t row = 0u; row < _rows; ++row)
 		for (uint64_t col = 0u; col < _cols; ++col) {
 			this->at(row, col) = vec.at(row * _cols + col);
 		}
 }
 
-template<typename T>
-Matrix<T>::Matrix(uint64_t rows, uint64_t cols, const std::vector<T>& vec) noexcept : _rows(rows), _cols(cols) {
-	_data = vec;
+template<typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix(uint64_t rows, uint64_t cols, const std::vector<T>& vec) noexcept : _rows(rows), _cols(cols) {
+	_data.assign(vec.begin(), vec.end());
 }
 
-template<typename T>
-Matrix<T>::Matrix(const std::vector<T>& vec) :_rows(1), _cols(vec.size()) {
-	_data = vec;
+template<typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix(const std::vector<T>& vec) :_rows(1), _cols(vec.size()) {
+	_data.assign(vec.begin(), vec.end());
 }
 
-template<typename T>
-Matrix<T>::Matrix(const Matrix<T>& mat) :_rows(mat._rows), _cols(mat._cols) {
+template<typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix(const Matrix<T, Alloc>& mat) :_rows(mat._rows), _cols(mat._cols) {
 	_data = mat._data;
 }
 
-template<typename T>
-Matrix<T>& Matrix<T>::operator=(const Matrix<T>& mat) {
+template<typename T, typename Alloc>
+Matrix<T, Alloc>::Matrix(Matrix<T, Alloc>&& mat) noexcept :
+	_rows(mat._rows), _cols(mat._cols), _data(std::move(mat._data)) {
+	mat._rows = 0u;
+	mat._cols = 0u;
+	mat._data.clear();
+}
+
+template<typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator=(const Matrix<T, Alloc>& mat) {
 	if (this != &mat) {
 		this->_data = mat._data;
 		this->_rows = mat._rows;
@@ -111,30 +128,43 @@ Matrix<T>& Matrix<T>::operator=(const Matrix<T>& mat) {
 	return *this;
 }
 
-template<typename T>
-Matrix<T>::~Matrix() {
+template<typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator=(Matrix<T, Alloc>&& mat) noexcept(std::allocator_traits<Alloc>::is_always_equal::value) {
+	if (this != &mat) {
+		this->_data = std::move(mat._data);
+		this->_rows = mat._rows;
+		this->_cols = mat._cols;
+		mat._data.clear();
+		mat._rows = 0u;
+		mat._cols = 0u;
+	}
+	return *this;
+}
+
+template<typename T, typename Alloc>
+Matrix<T, Alloc>::~Matrix() {
 	_data.clear();
 }
 
-template<typename T>
-uint64_t Matrix<T>::cols() const {
+template<typename T, typename Alloc>
+uint64_t Matrix<T, Alloc>::cols() const {
 	return _cols;
 }
 
-template<typename T>
-uint64_t Matrix<T>::rows() const {
+template<typename T, typename Alloc>
+uint64_t Matrix<T, Alloc>::rows() const {
 	return _rows;
 }
 
-template<typename T>
-void Matrix<T>::resize(uint64_t rows, uint64_t cols) {
+template<typename T, typename Alloc>
+void Matrix<T, Alloc>::resize(uint64_t rows, uint64_t cols) {
 	_rows = rows;
 	_cols = cols;
 	_data.resize(rows * cols);
 }
 
-template<typename S>
-inline std::ostream& operator<<(std::ostream& out, const Matrix<S>& mat) {
+template<typename S, typename A>
+inline std::ostream& operator<<(std::ostream& out, const Matrix<S, A>& mat) {
 	for (uint64_t row = 0u; row < mat._rows; ++row) {
 		for (uint64_t col = 0u; col < mat._cols; ++col) {
 			out << mat._data.at(row * mat._cols + col) << " ";
@@ -145,51 +175,58 @@ inline std::ostream& operator<<(std::ostream& out, const Matrix<S>& mat) {
 	return out;
 }
 
-template<typename T>
-Matrix<T>& Matrix<T>::transpose() noexcept {
-	Matrix<T> temp(_cols, _rows);
+template<typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::transpose() noexcept {
+	// квадратная матрица транспонируется перестановкой элементов на месте
+	if (_rows == _cols) {
+		for (uint64_t row = 0u; row < _rows; ++row)
+			for (uint64_t col = row + 1u; col < _cols; ++col)
+				std::swap(_data[row * _cols + col], _data[col * _cols + row]);
+		return *this;
+	}
 
-	for (uint64_t row = 0u; row < temp._rows; ++row)
-		for (uint64_t col = 0u; col < temp._cols; ++col)
-			temp(row, col) = this->at(col, row);
+	// буфер с тем же аллокатором, чтобы swap был допустим
+	std::vector<T, Alloc> temp(_data.size(), _data.get_allocator());
 
-	_cols = temp._cols;
-	_rows = temp._rows;
+	for (uint64_t row = 0u; row < _cols; ++row)
+		for (uint64_t col = 0u; col < _rows; ++col)
+			temp[row * _rows + col] = _data[col * _cols + row];
 
-	*this = temp;
+	_data.swap(temp);
+	std::swap(_rows, _cols);
 
 	return *this;
 }
 
-template<typename T>
-T& Matrix<T>::at(int64_t row, int64_t col) {
+template<typename T, typename Alloc>
+T& Matrix<T, Alloc>::at(int64_t row, int64_t col) {
 	if (row >= _rows || col >= _cols)
 		throw std::out_of_range("at");
 
 	return _data.at(row * _cols + col);
 }
 
-template<typename T>
-T Matrix<T>::at(int64_t row, int64_t col) const {
+template<typename T, typename Alloc>
+T Matrix<T, Alloc>::at(int64_t row, int64_t col) const {
 	if (row >= _rows || col >= _cols)
 		throw std::out_of_range("at");
 
 	return _data.at(row * _cols + col);
 }
 
-template<typename T>
-T& Matrix<T>::operator()(int64_t row, int64_t col) {
+template<typename T, typename Alloc>
+T& Matrix<T, Alloc>::operator()(int64_t row, int64_t col) {
 	return this->at(row, col);
 }
 
-template<typename T>
-T Matrix<T>::operator()(int64_t row, int64_t col) const {
+template<typename T, typename Alloc>
+T Matrix<T, Alloc>::operator()(int64_t row, int64_t col) const {
 	return this->at(row, col);
 }
 
-template<typename T>
-Matrix<T>& Matrix<T>::multiply(const Matrix<T>& mat) noexcept {
-	Matrix<T> output{ _rows, mat._cols, };
+template<typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::multiply(const Matrix<T, Alloc>& mat) noexcept {
+	Matrix<T, Alloc> output{ _rows, mat._cols, };
 
 	for (uint64_t row = 0u; row < _rows; ++row) {
 		for (uint64_t col = 0u; col < mat._cols; ++col) {
@@ -200,36 +237,67 @@ Matrix<T>& Matrix<T>::multiply(const Matrix<T>& mat) noexcept {
 		}
 	}
 
-	*this = output;
+	*this = std::move(output);
 
 	return *this;
 }
 
-template<typename T>
-Matrix<T> Matrix<T>::operator-() const {
-	Matrix<T> temp{ *this };
+template<typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::operator-() const {
+	Matrix<T, Alloc> temp{ *this };
 	for (auto& el : temp._data)
 		el = -el;
 	return temp;
 }
 
-template<typename T>
-Matrix<T> Matrix<T>::operator+(const Matrix<T>& mat) const {
-	if (this->_cols != mat._cols && this->_rows != mat._rows)
+template<typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator+=(const Matrix<T, Alloc>& mat) {
+	if (this->_cols != mat._cols || this->_rows != mat._rows)
 		throw std::logic_error("Dimensional matrixs must be also");
 
-	Matrix<T> temp{ *this };
-	for (uint64_t row = 0u; row < mat._rows; ++row)
-		for (uint64_t col = 0u; col < mat._cols; ++col)
-			temp.at(row, col) += mat.at(row, col);
+	for (uint64_t count = 0u; count < _data.size(); ++count)
+		_data[count] += mat._data[count];
 
+	return *this;
+}
+
+template<typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator-=(const Matrix<T, Alloc>& mat) {
+	if (this->_cols != mat._cols || this->_rows != mat._rows)
+		throw std::logic_error("Dimensional matrixs must be also");
+
+	for (uint64_t count = 0u; count < _data.size(); ++count)
+		_data[count] -= mat._data[count];
+
+	return *this;
+}
+
+template<typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::operator*=(T s) noexcept {
+	for (auto& el : _data)
+		el *= s;
+
+	return *this;
+}
+
+template<typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::operator+(const Matrix<T, Alloc>& mat) const {
+	Matrix<T, Alloc> temp{ *this };
+	temp += mat;
 	return temp;
 }
 
-template<typename T>
+template<typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::operator-(const Matrix<T, Alloc>& mat) const {
+	Matrix<T, Alloc> temp{ *this };
+	temp -= mat;
+	return temp;
+}
+
+template<typename T, typename Alloc>
 template<typename S>
-Matrix<T> Matrix<T>::operator*(const S& s) const {
-	Matrix<T> temp{ *this };
+Matrix<T, Alloc> Matrix<T, Alloc>::operator*(const S& s) const {
+	Matrix<T, Alloc> temp{ *this };
 	for (uint64_t row = 0u; row < _rows; ++row)
 		for (uint64_t col = 0u; col < _cols; ++col)
 			temp.at(row, col) *= s;
@@ -237,26 +305,30 @@ Matrix<T> Matrix<T>::operator*(const S& s) const {
 	return temp;
 }
 
-template<typename T>
-Matrix<T> Matrix<T>::operator*(const Matrix<T>& mat) const {
-	Matrix<T> temp{ *this };
+template<typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::operator*(const Matrix<T, Alloc>& mat) const {
+	Matrix<T, Alloc> temp{ *this };
 	return temp.multiply(mat);
 }
 
-template<typename T>
-Vector<T> Matrix<T>::operator*(const Vector<T>& vec) const {
-	Matrix<T> temp{ *this };
-	temp.transpose();
-	return vec * temp;
+template<typename T, typename Alloc>
+Vector<T, Alloc> Matrix<T, Alloc>::operator*(const Vector<T, Alloc>& vec) const {
+	Vector<T, Alloc> output(_rows);
+
+	for (uint64_t row = 0u; row < _rows; ++row)
+		for (uint64_t col = 0u; col < _cols; ++col)
+			output.at(row) += vec.at(col) * this->at(row, col);
+
+	return output;
 }
 
-template<typename S, typename U>
-inline Matrix<U> operator*(const S& val, const Matrix<U>& mat) {
+template<typename S, typename U, typename A>
+inline Matrix<U, A> operator*(const S& val, const Matrix<U, A>& mat) {
 	return mat * val;
 }
 
-template<typename T>
-double Matrix<T>::determinate() const {
+template<typename T, typename Alloc>
+double Matrix<T, Alloc>::determinate() const {
 	if (_rows != _cols)
 		throw std::logic_error("determinate");
 
@@ -277,37 +349,39 @@ double Matrix<T>::determinate() const {
 	return answer;
 }
 
-template<typename T>
-Matrix<double> Matrix<T>::E(uint64_t size) {
+template<typename T, typename Alloc>
+Matrix<double> Matrix<T, Alloc>::E(uint64_t size) {
 	Matrix<double> E(size, size);
 	for (uint64_t count = 0u; count < size; ++count)
 		E.at(count, count) = 1;
 	return E;
 }
 
-template<typename T>
-Vector<T> Matrix<T>::get_rows(uint64_t row) const {
+template<typename T, typename Alloc>
+Vector<T, Alloc> Matrix<T, Alloc>::get_rows(uint64_t row) const {
 	if (row >= _rows)
 		throw std::logic_error("get_rows");
 
-	Vector<T> output;
+	Vector<T, Alloc> output;
+	output.reserve(_cols);
 	for (uint64_t col = 0u; col < _cols; ++col)
 		output.push_back(this->at(row, col));
 	return output;
 }
 
-template<typename T>
-Vector<T> Matrix<T>::get_cols(uint64_t col) const {
+template<typename T, typename Alloc>
+Vector<T, Alloc> Matrix<T, Alloc>::get_cols(uint64_t col) const {
 	if (col >= _cols)
 		throw std::logic_error("get_cols");
-	Vector<T> output;
+	Vector<T, Alloc> output;
+	output.reserve(_rows);
 	for (uint64_t row = 0u; row < _rows; ++row)
 		output.push_back(this->at(row, col));
 	return output;
 }
 
-template<typename T>
-void Matrix<T>::set_rows(int64_t row, const Vector<T>& vec) {
+template<typename T, typename Alloc>
+void Matrix<T, Alloc>::set_rows(int64_t row, const Vector<T, Alloc>& vec) {
 	if (row >= _rows && vec.dimension() != _cols)
 		throw std::logic_error("set_rows");
 
@@ -315,17 +389,19 @@ void Matrix<T>::set_rows(int64_t row, const Vector<T>& vec) {
 		this->at(row, col) = vec.at(col);
 }
 
-template<typename T>
-Matrix<T>& Matrix<T>::swap_rows(int64_t i, uint64_t j) {
-	Vector<T> temp = this->get_rows(i);
-	this->set_rows(i, this->get_rows(j));
-	this->set_rows(j, temp);
+template<typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::swap_rows(int64_t i, uint64_t j) {
+	if (i >= _rows || j >= _rows)
+		throw std::logic_error("get_rows");
+
+	if (i != j)
+		std::swap_ranges(_data.begin() + i * _cols, _data.begin() + (i + 1) * _cols, _data.begin() + j * _cols);
 
 	return *this;
 }
 
-template<typename T>
-Matrix<T>& Matrix<T>::push_row(const Vector<T>& vec) {
+template<typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::push_row(const Vector<T, Alloc>& vec) {
 	if (_cols == 0 && _rows == 0) {
 		_cols = vec.dimension();
 		_rows = 1;
@@ -348,8 +424,8 @@ Matrix<T>& Matrix<T>::push_row(const Vector<T>& vec) {
 	return *this;
 }
 
-template<typename T>
-Matrix<T>& Matrix<T>::push_col(const Vector<T>& vec) {
+template<typename T, typename Alloc>
+Matrix<T, Alloc>& Matrix<T, Alloc>::push_col(const Vector<T, Alloc>& vec) {
 	if (vec.dimension() != _rows)
 		throw std::logic_error("push col");
 
@@ -361,19 +437,35 @@ Matrix<T>& Matrix<T>::push_col(const Vector<T>& vec) {
 
 }
 
-template<typename T>
-Matrix<T> Matrix<T>::operator!() const {
+template<typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::operator!() const {
 	if (_cols != _rows)
 		throw std::logic_error("Inverse matrix");
 
-	Matrix<T> output(*this);
+	// метод Гаусса - Жордана над расширенной матрицей [A | E], строки преобразуются по месту
+	const uint64_t width = 2u * _rows;
+	Matrix<T, Alloc> output(_rows, width);
 
-	for (uint64_t count = 0u; count < _rows; ++count) {
-		std::vector<T> col(_rows, 0);
-		col.at(count) = 1;
-		output.push_col(col);
+	for (uint64_t row = 0u; row < _rows; ++row) {
+		std::copy_n(_data.begin() + row * _cols, _cols, output._data.begin() + row * width);
+		output.at(row, _cols + row) = 1;
 	}
 
+	auto eliminate = [&](uint64_t count, uint64_t row) {
+		T* pivot = output._data.data() + count * width;
+		T* other = output._data.data() + row * width;
+		T coeff = other[count];
+		for (uint64_t col = 0u; col < width; ++col)
+			other[col] = other[col] + pivot[col] * (-coeff);
+	};
+
+	auto normalize = [&](uint64_t count) {
+		T* pivot = output._data.data() + count * width;
+		T lead = pivot[count];
+		for (uint64_t col = 0u; col < width; ++col)
+			pivot[col] = pivot[col] / lead;
+	};
+
 	for (uint64_t count = 0u; count < _rows; ++count) {
 
 		uint64_t row_with_biggest_element = count;
@@ -387,40 +479,55 @@ Matrix<T> Matrix<T>::operator!() const {
 
 		output.swap_rows(count, row_with_biggest_element);
 
-		Vector<T> temp = output.get_rows(count);
-		temp = temp / temp(count);
-		output.set_rows(count, temp);
+		normalize(count);
 
-		for (uint64_t row = count + 1u; row < _rows; ++row) {
-			T coeff = output.at(row, count);
-			Vector<T> temp_temp = temp * (-coeff);
-			Vector<T> other_row = output.get_rows(row);
-			other_row = other_row + temp_temp;
-			output.set_rows(row, other_row);
-		}
+		for (uint64_t row = count + 1u; row < _rows; ++row)
+			eliminate(count, row);
 	}
 
 	for (int64_t count = _rows - 1; count > 0; --count) {
 
-		Vector<T> temp = output.get_rows(count);
-		temp = temp / temp(count);
-		output.set_rows(count, temp);
+		normalize(count);
 
-		for (int64_t row = count - 1; row >= 0; --row) {
-			T coeff = output.at(row, count);
-			Vector<T> temp_temp = temp * (-coeff);
-			Vector<T> other_row = output.get_rows(row);
-			other_row = other_row + temp_temp;
-			output.set_rows(row, other_row);
-		}
+		for (int64_t row = count - 1; row >= 0; --row)
+			eliminate(count, row);
 	}
 
-	Matrix<T> inv(_rows, _rows);
+	Matrix<T, Alloc> inv(_rows, _rows);
 
 	for (uint64_t row = 0u; row < _rows; ++row)
-		for (uint64_t col = 0u; col < _cols; ++col) {
-			inv.at(row, col) = output.at(row, col + _rows);
-		}
+		std::copy_n(output._data.begin() + row * width + _rows, _rows, inv._data.begin() + row * _rows);
 
 	return inv;
+}
+
+template<typename T, typename Alloc>
+Matrix<T, Alloc> Matrix<T, Alloc>::cholesky() const {
+	if (_cols != _rows)
+		throw std::logic_error("cholesky");
+
+	// Холецкий - Банахевич по строкам: читается только нижний треугольник A
+	Matrix<T, Alloc> L(_rows, _rows);
+
+	for (uint64_t row = 0u; row < _rows; ++row) {
+		const T* l_row = L._data.data() + row * _rows;
+
+		for (uint64_t col = 0u; col <= row; ++col) {
+			const T* l_col = L._data.data() + col * _rows;
+			T sum = at(row, col);
+			for (uint64_t k = 0u; k < col; ++k)
+				sum -= l_row[k] * l_col[k];
+
+			if (row != col) {
+				L.at(row, col) = sum / l_col[col];
+				continue;
+			}
+
+			if (!(sum > 0))
+				throw std::logic_error("cholesky definite");
+			L.at(row, row) = sqrt(sum);
+		}
+	}
+
+	return L;
 }
\ No newline at end of file
@@ -1,12 +1,27 @@
 ﻿#include "model.hpp"
 
-model_t::model_t(const Vector<long double>& vec,long double t0,long double t1,long double inc) : x0(vec), sample_inc(inc), t0(t0), t1(t1) {};
+template<typename T>
+model_t<T>::model_t(const Vector<T>& vec, T t0, T t1, T inc) : x0(vec), sample_inc(inc), t0(t0), t1(t1) {
+	// по умолчанию - вектор состояния x0..x(n-1)
+	std::vector<result_table::column_info> columns;
+	for (uint64_t count = 0u; count < x0.dimension(); ++count)
+		columns.push_back({ "x" + std::to_string(count), column_type::float64 });
+
+	res = result_table(columns);
+};
 
-void model_t::add_result(const Vector<long double>& X, double t) {
+template<typename T>
+void model_t<T>::add_result(const Vector<T>& X, T t) {
+	LR5_SCOPE("model/add_result");
+	// вектор состояния пишется на каждом шаге выборки
+	if (res.rows() == 0u)
+		res.reserve(uint64_t((t1 - t0) / sample_inc) + 1u);
 	res.push_row(X);
 }
 
-void model_t::load_res2file(const char* filename) {
+template<typename T>
+void model_t<T>::load_res2file(const char* filename) {
+	LR5_SCOPE("model/load_res2file");
 	std::ofstream f(filename, std::ios::trunc);
 
 	if (!f.is_open())
@@ -14,19 +29,61 @@ void model_t::load_res2file(const char* filename) {
 	else
 		std::cout << "Create file" << '\n';
 
-	for (uint64_t count = 0u; count < res.rows(); ++count)
-		f << res.get_rows(count) << '\n';
+	for (uint64_t count = 0u; count < res.rows(); ++count) {
+		res.write_row(f, count);
+		f << '\n';
+	}
 
+	LR5_COUNT("model/bytes_written", uint64_t(f.tellp()));
 	f.close();
 }
 
-Vector<long double> model_t::get_right(const Vector<long double>& X, long double t) const {
-	Vector<long double> dX(X.dimension());
+template<typename T>
+void model_t<T>::save_result(const char* filename, unsigned mantissa_bits) const {
+	LR5_SCOPE("model/save_result");
+	std::ofstream f(filename, std::ios::binary | std::ios::trunc);
+
+	if (!f.is_open())
+		throw std::logic_error("save result");
+
+	write_encoded(f, res, mantissa_bits);
+	LR5_COUNT("model/bytes_written", uint64_t(f.tellp()));
+}
+
+template<typename T>
+void model_t<T>::reset_observer() {
+	// строки прошлого прохода уже ушли в файл: новый проход пишется новым writer
+	if (writer)
+		throw std::logic_error("reset observer with writer");
+
+	res.clear();
+	streamed = 0u;
+}
+
+template<typename T>
+void model_t<T>::stream_results() {
+	uint64_t rows = res.rows();
+	if (rows == streamed)
+		return;
+
+	writer->push_rows(res, streamed, rows);
+	streamed = rows;
+
+	if (!keep_rows) {
+		res.clear();
+		streamed = 0u;
+	}
+}
+
+template<typename T>
+Vector<T> model_t<T>::get_right(const Vector<T>& X, T t) const {
+	LR5_SCOPE("cr3bp/get_right");
+	Vector<T> dX(X.dimension());
 
-	long double mu = 0.012277471l;
-	long double mu_ = 1 - mu;
-	long double D1 = pow((X.at(0) + mu) * (X.at(0) + mu) + X.at(2) * X.at(2), 3.0l / 2.0l);
-	long double D2 = pow((X.at(0) - mu_) * (X.at(0) - mu_) + X.at(2) * X.at(2), 3.0l / 2.0l);
+	T mu = 0.012277471l;
+	T mu_ = 1 - mu;
+	T D1 = pow((X.at(0) + mu) * (X.at(0) + mu) + X.at(2) * X.at(2), 3.0l / 2.0l);
+	T D2 = pow((X.at(0) - mu_) * (X.at(0) - mu_) + X.at(2) * X.at(2), 3.0l / 2.0l);
 
 	dX.at(0) = X.at(1);
 	dX.at(1) = X.at(0) + 2 * X.at(3) - mu_ * (X.at(0) + mu) / D1 - mu * (X.at(0) - mu_) / D2;
@@ -36,12 +93,15 @@ Vector<long double> model_t::get_right(const Vector<long double>& X, long double
 	return dX;
 };
 
-earth_move_model::earth_move_model(const Vector<long double>& vec, long double t0, long double t1, long double inc) : model_t(vec, t0, t1, inc) {};
+template<typename T>
+earth_move_model<T>::earth_move_model(const Vector<T>& vec, T t0, T t1, T inc) : model_t<T>(vec, t0, t1, inc) {};
 
-Vector<long double> earth_move_model::get_right(const Vector<long double>& X, long double t) const {
-	Vector<long double> dX(X.dimension());
+template<typename T>
+Vector<T> earth_move_model<T>::get_right(const Vector<T>& X, T t) const {
+	LR5_SCOPE("earth_sun/get_right");
+	Vector<T> dX(X.dimension());
 
-	long double modul = sqrt(pow(X.at(0), 2) + pow(X.at(1), 2) + pow(X.at(2), 2));
+	T modul = sqrt(pow(X.at(0), 2) + pow(X.at(1), 2) + pow(X.at(2), 2));
 
 	dX.at(0) = X.at(3);
 	dX.at(1) = X.at(4);
@@ -53,14 +113,28 @@ Vector<long double> earth_move_model::get_right(const Vector<long double>& X, lo
 	return dX;
 };
 
-sundial_model::sundial_model(double φ_, double λ_, double date_) : φ(φ_), λ(λ_), date(date_),
-earth_move_model(Vector<long double>({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 }), 2460310.50 * 86400.0, (date_+ 1.0) * 86400.0, 60.0)
+template<typename T>
+sundial_model<T>::sundial_model(T φ_, T λ_, T date_) : φ(φ_), λ(λ_), date(date_),
+earth_move_model<T>(Vector<T>({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 }), 2460310.50 * 86400.0, (date_+ 1.0) * 86400.0, 60.0)
 {
+	// тень (x, y, z), угол Солнца над горизонтом, время от начала суток date, с
+	this->res = result_table({
+		{ "shadow_x", column_type::float64 },
+		{ "shadow_y", column_type::float64 },
+		{ "shadow_z", column_type::float64 },
+		{ "angle", column_type::float64 },
+		{ "t", column_type::int32 },
+	});
+	this->res.reserve(uint64_t(86400.0 / this->get_step()) + 1u);
+
 	s_0 = get_siderial_time(2024, 1, 1, 0, 0, 0);
 	s_0 = wrap_angle(2 * math_const::π * s_0 / 86400.0); // угол ориентации гринвичского меридиана 
+
+	frame = site_frame<T>(φ, λ, s_0, Ω);
 };
 
-double sundial_model::get_siderial_time(double Y, double M, double D, double h, double m, double s) const noexcept { // время звёздное
+template<typename T>
+T sundial_model<T>::get_siderial_time(double Y, double M, double D, double h, double m, double s) const noexcept { // время звёздное
 
 	double JD = get_JDN(Y, M, D, h, m, s);
 
@@ -71,37 +145,21 @@ double sundial_model::get_siderial_time(double Y, double M, double D, double h,
 	return sg_0;
 };
 
-void sundial_model::add_result(const Vector<long double>& X, double t) {
+template<typename T>
+bool sundial_model<T>::shadow_at(const Vector<T>& X, const site_rotation<T>& r, Vector<T>& shadow, T& angle) const {
 	using namespace math_const;
 
-	//test day
-	if (t <= date * 86400.0)
-		return;
-
-	//part 0
-	t -= get_t0();
-
 	//part 1
-	Vector<long double> coord{ 3 };
-
-	double s = s_0 + Ω * t + λ;
-
-	s = wrap_angle(s);
-
-	coord.at(0) = Re * cos(φ) * cos(s);
-	coord.at(1) = Re * cos(φ) * sin(s);
-	coord.at(2) = Re * sin(φ);
-
-	auto ort_r = coord / coord.length();//нормированный вектор
+	auto ort_r = frame.zenith(r);//нормированный вектор
 
 	//part 2
-	Vector<long double> earth_r({ X.at(0), X.at(1), X.at(2) });
+	Vector<T> earth_r({ X.at(0), X.at(1), X.at(2) });
 	auto ort_earth_r = earth_r / earth_r.length();
 
-	double angle = acos(ort_earth_r * ort_r);
+	angle = acos(ort_earth_r * ort_r);
 
 	if (angle <= π / 2)
-		return;
+		return false;
 	else {
 		angle -= π;
 	}
@@ -112,54 +170,331 @@ void sundial_model::add_result(const Vector<long double>& X, double t) {
 	//part 4
 	auto vec_shadow = ort_r + earth_r_star;
 
-	Matrix<long double> M{ 3,3,{-sin(φ) * cos(s), -sin(φ) * sin(s), cos(φ), -cos(φ) * cos(s), -cos(φ) * sin(s), -sin(φ), -sin(s), cos(s), 0} };
+	shadow = frame.to_local(r, vec_shadow);
+	return true;
+}
+
+template<typename T>
+void sundial_model<T>::add_result(const Vector<T>& X, T t) {
+	LR5_SCOPE("sundial/add_result");
+
+	//test day
+	if (t <= date * 86400.0)
+		return;
+
+	//part 0
+	t -= this->get_t0();
 
-	auto finally = M * vec_shadow;
+	Vector<T> finally;
+	T angle;
 
-	auto vec_r = finally.concat(Vector<long double>({ -angle, t - (date - 2460310.50) * 86400.0 }));
+	if (!shadow_at(X, frame.advance(t), finally, angle))
+		return;
 
 	//add result
-	res.push_row(vec_r);
+	this->res.append(0, finally.at(0));
+	this->res.append(1, finally.at(1));
+	this->res.append(2, finally.at(2));
+	this->res.append(3, -angle);
+	this->res.append(4, t - (date - 2460310.50) * 86400.0);
 };
 
-blag_time_model::blag_time_model() :
-	earth_move_model(Vector<long double>({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 }), 2460310.50 * 86400.0, (2460310.50 + 365.0) * 86400.0, 60.0) {};
+template<typename T>
+void sundial_model<T>::set_adaptive(T tolerance_, T min_elevation_) {
+	if (tolerance_ > 0 && min_elevation_ <= 0)
+		throw std::logic_error("sundial adaptive");
+
+	tolerance = tolerance_;
+	min_elevation = min_elevation_;
+	day_segments.clear();
+
+	// моменты выдачи не на сетке: время хранится полностью
+	this->res = result_table({
+		{ "shadow_x", column_type::float64 },
+		{ "shadow_y", column_type::float64 },
+		{ "shadow_z", column_type::float64 },
+		{ "angle", column_type::float64 },
+		{ "t", tolerance > 0 ? column_type::float64 : column_type::int32 },
+	});
+	this->invalidate_observer();
+}
+
+template<typename T>
+void sundial_model<T>::set_site(T φ_, T λ_) {
+	φ = φ_;
+	λ = λ_;
+	frame.set_site(φ, λ);
+	this->invalidate_observer();
+}
+
+template<typename T>
+void sundial_model<T>::reset_observer() {
+	model_t<T>::reset_observer();
+	day_segments.clear();
+	frame.reset();
+}
+
+template<typename T>
+Vector<T> sundial_model<T>::state_at(T t) const {
+	for (const auto& segment : day_segments)
+		if (segment.contains(t))
+			return segment.state(t);
+
+	throw std::logic_error("sundial segment");
+}
+
+template<typename T>
+typename sundial_model<T>::shadow_point sundial_model<T>::point_at(T t) const {
+	shadow_point point{ t, Vector<T>(3), 0 };
+	shadow_at(state_at(t), frame.at(t - this->get_t0()), point.shadow, point.angle);
+	return point;
+}
+
+template<typename T>
+T sundial_model<T>::elevation_at(T t) const {
+	Vector<T> X = state_at(t);
+	T zenith[3];
+	frame.zenith(frame.at(t - this->get_t0()), zenith);
+	T r = sqrt(X.at(0) * X.at(0) + X.at(1) * X.at(1) + X.at(2) * X.at(2));
 
-void blag_time_model::add_result(const Vector<long double>& X, double t) {
+	// направление на Солнце - минус направление Солнце - Земля
+	return asin(-(zenith[0] * X.at(0) + zenith[1] * X.at(1) + zenith[2] * X.at(2)) / r);
+}
+
+template<typename T>
+T sundial_model<T>::next_crossing(T t, bool rising) const {
 	using namespace math_const;
-	
+	const T end = this->get_t1();
+
+	// часовой угол, на котором высота равна min_elevation: cos H0 = (sin h - sin φ sin δ) / (cos φ cos δ);
+	// склонение и прямое восхождение Солнца берутся в текущем приближении и уточняются итерациями
+	T moment = t;
+	for (uint64_t iteration = 0u; iteration < 8u; ++iteration) {
+		Vector<T> X = state_at(moment);
+		site_rotation<T> rotation = frame.at(moment - this->get_t0());
+		T r = sqrt(X.at(0) * X.at(0) + X.at(1) * X.at(1) + X.at(2) * X.at(2));
+		T sun[3] = { -X.at(0) / r, -X.at(1) / r, -X.at(2) / r };
+		frame.to_date(rotation, sun);
+
+		T δ = asin(sun[2]);
+		T α = atan2(sun[1], sun[0]);
+
+		T cos_h0 = (sin(min_elevation) - frame.get_sin_φ() * sin(δ)) / (frame.get_cos_φ() * cos(δ));
+
+		// полярный день или ночь: пересечения нет
+		if (cos_h0 >= 1 || cos_h0 <= -1)
+			return end;
+
+		T h0 = acos(cos_h0);
+		T d = (rising ? -h0 : h0) - (atan2(rotation.sin_s, rotation.cos_s) - α);
+
+		// первое приближение - ближайшее пересечение после t, дальше - поправка к нему
+		if (iteration == 0u)
+			d -= 2 * π * floor(d / (2 * π));
+		else
+			d -= 2 * π * round(d / (2 * π));
+
+		moment += d / Ω;
+
+		if (moment >= end)
+			return end;
+		if (fabs(d / Ω) < 1e-3)
+			break;
+	}
 
-	//part 0
-	t -= get_t0();
+	return std::max(moment, t);
+}
 
-	int day = t / 86400;
+template<typename T>
+void sundial_model<T>::add_point(const shadow_point& point) {
+	this->res.append(0, point.shadow.at(0));
+	this->res.append(1, point.shadow.at(1));
+	this->res.append(2, point.shadow.at(2));
+	this->res.append(3, -point.angle);
+	this->res.append(4, point.t - date * 86400.0);
+}
 
-	//part 1
-	Vector<long double> coord{ 3 };
+template<typename T>
+void sundial_model<T>::subdivide(const shadow_point& a, const shadow_point& b, uint64_t depth) {
+	shadow_point middle = point_at((a.t + b.t) / 2);
+
+	Vector<T> chord = a.shadow + b.shadow;
+	chord *= T(0.5);
+	chord -= middle.shadow;
+
+	if (depth >= 12u || chord.length() <= tolerance * std::max<T>(1, middle.shadow.length()))
+		return;
 
-	double s = s_0 + Ω * t + λ;
+	subdivide(a, middle, depth + 1u);
+	add_point(middle);
+	subdivide(middle, b, depth + 1u);
+}
+
+template<typename T>
+void sundial_model<T>::sample_day() {
+	LR5_SCOPE("sundial/sample_day");
+	const T begin = date * 86400.0;
+	const T end = this->get_t1();
+	// начальное разбиение светлого промежутка, чтобы хорда не пропустила изгиб траектории
+	const T max_step = 1800;
+
+	T t = begin;
+	bool light = elevation_at(t) > min_elevation;
+
+	while (t < end) {
+		T next = next_crossing(t, !light);
+
+		if (light) {
+			uint64_t parts = std::max<uint64_t>(1u, uint64_t(ceil((next - t) / max_step)));
+			shadow_point a = point_at(t);
+			add_point(a);
+
+			for (uint64_t part = 1u; part <= parts; ++part) {
+				shadow_point b = point_at(t + (next - t) * part / parts);
+				subdivide(a, b, 0u);
+				add_point(b);
+				a = b;
+			}
+		}
+
+		light = !light;
+		t = next;
+	}
+
+	day_segments.clear();
+}
+
+template<typename T>
+void sundial_model<T>::add_segment(const dense_segment<T>& segment) {
+	const split_epoch<T> begin = split_epoch<T>::from_seconds(date * 86400.0);
+	const split_epoch<T> end = split_epoch<T>::from_seconds(this->get_t1());
+
+	// ночь и дни до date не вычисляются: шаги до начала суток отбрасываются
+	if (begin - segment.t0 > segment.h)
+		return;
+
+	day_segments.push_back(segment);
+
+	if (end - segment.t0 <= segment.h)
+		sample_day();
+}
+
+template<typename T>
+void sundial_model<T>::save_state(std::ostream& out) const {
+	write_binary(out, uint64_t(day_segments.size()));
+	for (const auto& segment : day_segments)
+		write_binary(out, segment);
+
+	model_t<T>::save_state(out);
+}
+
+template<typename T>
+void sundial_model<T>::load_state(std::istream& in) {
+	uint64_t size{};
+	read_binary(in, size);
+
+	day_segments.resize(size);
+	for (auto& segment : day_segments)
+		read_binary(in, segment);
+
+	frame.reset();
+	model_t<T>::load_state(in);
+}
 
-	s = wrap_angle(s);
+template<typename T>
+blag_time_model<T>::blag_time_model() :
+	earth_move_model<T>(Vector<T>({ -2.6005047996994e10, 1.32621705709054e11, 5.7523888683657e10, -2.9832953e4, -4.715287e3, -2.043123e3 }), 2460310.50 * 86400.0, (2460310.50 + 365.0) * 86400.0, 60.0),
+	frame(φ, λ, s_0, Ω) {
+	// время восхода и захода по местному времени, с от начала суток
+	this->res = result_table({
+		{ "sunrise", column_type::int32 },
+		{ "sunset", column_type::int32 },
+	});
+	this->res.reserve(uint64_t((this->get_t1() - this->get_t0()) / 86400.0) + 1u);
+};
 
-	coord.at(0) = Re * cos(φ) * cos(s);
-	coord.at(1) = Re * cos(φ) * sin(s);
-	coord.at(2) = Re * sin(φ);
+template<typename T>
+void blag_time_model<T>::set_site(T φ_, T λ_) {
+	φ = φ_;
+	λ = λ_;
+	frame.set_site(φ, λ);
+	this->invalidate_observer();
+}
 
-	auto ort_r = coord / coord.length();
+template<typename T>
+void blag_time_model<T>::reset_observer() {
+	model_t<T>::reset_observer();
+	time_v = 0.0;
+	time_z = 0.0;
+	state = day_state::sunset;
+	for (int axis = 0; axis < 3; ++axis) {
+		earth_prev[axis] = 0.0;
+		earth_next[axis] = 0.0;
+	}
+	t_prev = 0.0;
+	t_next = 0.0;
+	detector.clear();
+	frame.reset();
+
+	if (stats)
+		stats->clear();
+}
+
+template<typename T>
+T blag_time_model<T>::sun_angle(T x, T y, T z, const site_rotation<T>& r) const {
+	//part 1
+	T ort_r[3];
+	frame.zenith(r, ort_r);
 
 	//part 2
+	T length = sqrt(x * x + y * y + z * z);
+
+	return acos((x * ort_r[0] + y * ort_r[1] + z * ort_r[2]) / length);
+}
+
+template<typename T>
+T blag_time_model<T>::elevation_between(T t) const {
+	using namespace math_const;
+
+	T w = (t - t_prev) / (t_next - t_prev);
+	T earth[3];
+	for (int axis = 0; axis < 3; ++axis)
+		earth[axis] = earth_prev[axis] + (earth_next[axis] - earth_prev[axis]) * w;
+
+	return sun_angle(earth[0], earth[1], earth[2], frame.at(t)) - π / 2;
+}
+
+template<typename T>
+void blag_time_model<T>::add_result(const Vector<T>& X, T t) {
+	LR5_SCOPE("blag_time/add_result");
+	using namespace math_const;
 	
-	Vector<long double> earth_r({ X.at(0), X.at(1), X.at(2) });
-	auto ort_earth_r = earth_r / earth_r.length();
 
-	double angle = acos(ort_earth_r * ort_r);
+	//part 0
+	t -= this->get_t0();
 
-	double time{};
+	// местное время отсчитывается от UTC: без ориентации Земли поправка нулевая
+	T clock = t - frame.clock_offset(t);
+	int day = clock / 86400;
 
-	if (t - day * 86400.0 + UTC_n * 3600.0 > 86400.0)
-		time = t - day * 86400.0 + UTC_n * 3600.0 - 86400.0;
+	T angle = sun_angle(X.at(0), X.at(1), X.at(2), frame.advance(t));
+
+	for (int axis = 0; axis < 3; ++axis) {
+		earth_prev[axis] = earth_next[axis];
+		earth_next[axis] = X.at(axis);
+	}
+	t_prev = t_next;
+	t_next = t;
+
+	// высота Солнца: угол больше π/2 - Солнце над горизонтом
+	detector.add_sample(t, angle - π / 2, [this](T moment) { return elevation_between(moment); });
+
+	T time{};
+
+	if (clock - day * 86400.0 + UTC_n * 3600.0 > 86400.0)
+		time = clock - day * 86400.0 + UTC_n * 3600.0 - 86400.0;
 	else
-		time = t - day * 86400.0 + UTC_n * 3600.0;
+		time = clock - day * 86400.0 + UTC_n * 3600.0;
 
 	if (angle < π / 2) {
 		if (state == day_state::sunrise) {
@@ -168,7 +503,12 @@ void blag_time_model::add_result(const Vector<long double>& X, double t) {
 			time_z = time;
 
 			//add result
-			res.push_row(Vector<long double>({ time_v, time_z}));
+			this->res.append(0, time_v);
+			this->res.append(1, time_z);
+
+			// календарный день - по местной дате захода
+			if (stats)
+				stats->add_day(get_day_of_year(double((this->get_t0() + clock) / 86400.0 + UTC_n / 24.0)), time_v, time_z);
 		}
 		return;
 	}
@@ -182,3 +522,66 @@ void blag_time_model::add_result(const Vector<long double>& X, double t) {
 		angle -= π;
 	}
 }
+
+template<typename T>
+void model_t<T>::save_state(std::ostream& out) const {
+	write_binary(out, res.cols());
+}
+
+template<typename T>
+void model_t<T>::load_state(std::istream& in) {
+	uint64_t cols{};
+	read_binary(in, cols);
+
+	if (cols != res.cols())
+		throw std::logic_error("load state");
+}
+
+template<typename T>
+void model_t<T>::load_rows(std::istream& in, uint64_t count) {
+	res.clear();
+	res.read_rows(in, count);
+	streamed = res.rows();
+}
+
+template<typename T>
+void blag_time_model<T>::save_state(std::ostream& out) const {
+	write_binary(out, time_v);
+	write_binary(out, time_z);
+	write_binary(out, state);
+	for (int axis = 0; axis < 3; ++axis) {
+		write_binary(out, earth_prev[axis]);
+		write_binary(out, earth_next[axis]);
+	}
+	write_binary(out, t_prev);
+	write_binary(out, t_next);
+	detector.save_state(out);
+
+	model_t<T>::save_state(out);
+}
+
+template<typename T>
+void blag_time_model<T>::load_state(std::istream& in) {
+	read_binary(in, time_v);
+	read_binary(in, time_z);
+	read_binary(in, state);
+	for (int axis = 0; axis < 3; ++axis) {
+		read_binary(in, earth_prev[axis]);
+		read_binary(in, earth_next[axis]);
+	}
+	read_binary(in, t_prev);
+	read_binary(in, t_next);
+	detector.load_state(in);
+	frame.reset();
+
+	model_t<T>::load_state(in);
+}
+
+template class model_t<double>;
+template class model_t<long double>;
+template class earth_move_model<double>;
+template class earth_move_model<long double>;
+template class sundial_model<double>;
+template class sundial_model<long double>;
+template class blag_time_model<double>;
+template class blag_time_model<long double>;
@@ -3,72 +3,201 @@
 #include <fstream>
 #include <iomanip>
 #include "funcm.hpp"
+#include "precision.hpp"
+#include "async_writer.hpp"
+#include "column_codec.hpp"
+#include "binary_io.hpp"
+#include "dense_segment.hpp"
+#include "profile.hpp"
+#include "result_table.hpp"
+#include "daylight_stats.hpp"
+#include "horizon_detector.hpp"
+#include "site_frame.hpp"
 #include "quartenion.hpp"
 
 
+template<typename T>
 class model_t {
    
 protected:
-	Matrix<long double> res;
-	long double sample_inc, t0, t1;
-	Vector<long double> x0;
+	result_table res;
+	T sample_inc, t0, t1;
+	Vector<T> x0;
+
+	async_writer* writer = nullptr;
+	uint64_t streamed = 0u;
+	bool keep_rows = true;
+	uint64_t revision = 0u;
+
+	void stream_results();
+	// изменился параметр наблюдателя: выдачу нужно пересчитать по той же траектории
+	void invalidate_observer() noexcept { ++revision; };
 public:
-	model_t(const Vector< long double>& vec,long double t0,long double t1,long double inc);
+	model_t(const Vector<T>& vec, T t0, T t1, T inc);
 
 	void load_res2file(const char* filename);
-	double get_t0() const noexcept { return t0; };
-	double get_t1() const noexcept { return t1; };
-	double get_step() const noexcept { return sample_inc; };
-	Vector<long double> get_init() const noexcept { return x0; };
-	Matrix<long double> get_result() const noexcept { return res; };
-
-	virtual void add_result(const Vector<long double>& X, double t);
-	virtual Vector<long double> get_right(const Vector<long double>& X, long double t) const;
+	// таблица выдачи в сжатом двоичном виде (column_codec), читается read_encoded
+	void save_result(const char* filename, unsigned mantissa_bits = 52u) const;
+	T get_t0() const noexcept { return t0; };
+	T get_t1() const noexcept { return t1; };
+	T get_step() const noexcept { return sample_inc; };
+	Vector<T> get_init() const noexcept { return x0; };
+	const result_table& get_result() const noexcept { return res; };
+	void set_t1(T t) noexcept { t1 = t; };
+	void set_init(const Vector<T>& vec) { x0 = vec; };
+	// новые строки выдачи уходят в поток записи по мере получения (не сохраняется в контрольной точке);
+	// keep = false - записанные строки удаляются из таблицы, память не растёт с длиной расчёта
+	void set_writer(async_writer* output, bool keep = true) noexcept { writer = output; streamed = res.rows(); keep_rows = keep; };
+	// вызывается интегратором после каждого шага
+	void flush_results() { if (writer) stream_results(); };
+
+	// версия параметров наблюдателя - всего, от чего зависит выдача, но не траектория (ключ trajectory_cache)
+	uint64_t observer_revision() const noexcept { return revision; };
+	// сброс выдачи и состояния наблюдателя перед новым проходом по траектории; с подключённым writer -
+	// logic_error (иначе строки прошлого прохода записались бы повторно): set_writer(nullptr) до сброса,
+	// writer для нового прохода - после. Переопределения вызывают его первым
+	virtual void reset_observer();
+
+	// состояние наблюдателя; строки выдачи в него не входят - контрольная точка дописывает их отдельно
+	virtual void save_state(std::ostream& out) const;
+	virtual void load_state(std::istream& in);
+	// заменить выдачу count строками, записанными result_table::write_rows
+	void load_rows(std::istream& in, uint64_t count);
+
+	virtual void add_result(const Vector<T>& X, T t);
+	// false - модель сама выбирает моменты выдачи: вместо add_result на сетке sample_inc
+	// интегратор передаёт ей каждый принятый шаг вместе с плотной выдачей
+	virtual bool uniform_output() const noexcept { return true; };
+	virtual void add_segment(const dense_segment<T>&) {};
+	// true - интегрирование прекращается после текущего шага (событие найдено раньше t1)
+	virtual bool finished() const noexcept { return false; };
+	virtual Vector<T> get_right(const Vector<T>& X, T t) const;
+	virtual const char* rhs_id() const noexcept { return "cr3bp"; };
 };
 
-class earth_move_model : public model_t {
+template<typename T>
+class earth_move_model : public model_t<T> {
 protected:
-	const double mu_s = 132712.43994e15;
+	const T mu_s = 132712.43994e15;
 public:
-	earth_move_model(const Vector<long double>& vec, long double t0, long double t1, long double inc);
+	earth_move_model(const Vector<T>& vec, T t0, T t1, T inc);
 
-	Vector<long double> get_right(const Vector<long double>& X, long double t) const override;
+	Vector<T> get_right(const Vector<T>& X, T t) const override;
+	const char* rhs_id() const noexcept override { return "earth_sun"; };
 };
 
 // l = 1m
-class sundial_model : public earth_move_model {
+template<typename T>
+class sundial_model : public earth_move_model<T> {
 protected:
-	const double Re = 6371300;
-	const double Ω = 7.292115e-5;
-	double φ, λ, date;
-	double s_0;
+	const T Re = 6371300;
+	const T Ω = 7.292115e-5;
+	T φ, λ, date;
+	T s_0;
+	site_frame<T> frame;
+
+	// адаптивная выдача (tolerance > 0): шаги интегратора за сутки date копятся,
+	// по ним находятся восход и заход, и только светлое время делится по кривизне траектории тени
+	T tolerance = 0;
+	T min_elevation = 1e-3;
+	std::vector<dense_segment<T>> day_segments;
+
+	struct shadow_point {
+		T t;
+		Vector<T> shadow;
+		T angle;
+	};
+
+	// false - Солнце не выше горизонта
+	bool shadow_at(const Vector<T>& X, const site_rotation<T>& r, Vector<T>& shadow, T& angle) const;
+	Vector<T> state_at(T t) const;
+	shadow_point point_at(T t) const;
+	T elevation_at(T t) const;
+	T next_crossing(T t, bool rising) const;
+	void add_point(const shadow_point& point);
+	void subdivide(const shadow_point& a, const shadow_point& b, uint64_t depth);
+	void sample_day();
 public:
-	sundial_model(double φ_, double λ_, double date_);
+	sundial_model(T φ_, T λ_, T date_);
 	
-	double get_siderial_time(double Y, double M, double D, double h, double m, double s) const noexcept;
+	T get_siderial_time(double Y, double M, double D, double h, double m, double s) const noexcept;
+
+	// tolerance - допустимое отклонение конца тени от хорды в долях длины тени (не меньше 1 м),
+	// min_elevation - высота Солнца, с которой начинается выдача (тень не длиннее 1/tg(min_elevation))
+	void set_adaptive(T tolerance, T min_elevation = 1e-3);
+	// звёздный угол по истинному звёздному времени с прецессией-нутацией вместо s_0 (nullptr - отключить)
+	void set_orientation(const earth_orientation* eo) { frame.set_orientation(eo, this->get_t0()); this->invalidate_observer(); };
+	// поправка к звёздному углу, рад: неопределённость ориентации Земли
+	void set_rotation_offset(T ds) noexcept { frame.set_angle_offset(ds); this->invalidate_observer(); };
+	// место наблюдения; траектория Земли от него не зависит
+	void set_site(T φ_, T λ_);
+	T get_latitude() const noexcept { return φ; };
+	T get_longitude() const noexcept { return λ; };
 
-	void add_result(const Vector<long double>& X, double t) override;
+	void reset_observer() override;
+
+	void add_result(const Vector<T>& X, T t) override;
+	bool uniform_output() const noexcept override { return tolerance <= 0; };
+	void add_segment(const dense_segment<T>& segment) override;
+	void save_state(std::ostream& out) const override;
+	void load_state(std::istream& in) override;
 };
 
-class blag_time_model : public earth_move_model {
+template<typename T>
+class blag_time_model : public earth_move_model<T> {
 protected:
 	enum day_state {
 		sunrise,
 		sunset,
 	};
 
-	const double Re = 6371300;
-	const double Ω = 7.292115e-5;
-	const double φ = 0.97302106;
-	const double λ = 0.65624380;
-	const double s_0 = 1.75659;
-	const int UTC_n = 3;
+	const T Re = 6371300;
+	const T Ω = 7.292115e-5;
+	T φ = 0.97302106;
+	T λ = 0.65624380;
+	const T s_0 = 1.75659;
+	int UTC_n = 3;
+	site_frame<T> frame;
 
-	double time_v = 0.0;
-	double time_z = 0.0;
+	T time_v = 0.0;
+	T time_z = 0.0;
 	day_state state = day_state::sunset;
+	daylight_stats* stats = nullptr;
+
+	// положение Земли в соседних точках выборки: внутри шага оно интерполируется линейно,
+	// а поворот места наблюдения считается точно
+	T earth_prev[3]{};
+	T earth_next[3]{};
+	T t_prev = 0.0;
+	T t_next = 0.0;
+	horizon_detector<T> detector;
+
+	// угол между направлением на зенит и направлением Солнце - Земля
+	T sun_angle(T x, T y, T z, const site_rotation<T>& r) const;
+	T elevation_between(T t) const;
 public:
 	blag_time_model();
 
-	void add_result(const Vector<long double>& X, double t) override;
+	// каждая пара восход/заход передаётся в статистику в момент захода (состояние статистики в контрольную точку не пишется)
+	void set_daylight_stats(daylight_stats* daylight) noexcept { stats = daylight; this->invalidate_observer(); };
+
+	// пороги высоты Солнца, по которым за тот же проход ищутся уточнённые моменты пересечения
+	void set_thresholds(const std::vector<elevation_threshold>& thresholds) { detector = horizon_detector<T>(thresholds); this->invalidate_observer(); };
+	const horizon_detector<T>& get_detector() const noexcept { return detector; };
+	// звёздный угол по истинному звёздному времени с прецессией-нутацией вместо s_0 = 1.75659,
+	// местное время - от UTC (nullptr - отключить)
+	void set_orientation(const earth_orientation* eo) { frame.set_orientation(eo, this->get_t0()); this->invalidate_observer(); };
+
+	// место наблюдения и часовой пояс (ч): траектория Земли от них не зависит
+	void set_site(T φ_, T λ_);
+	void set_utc_offset(int hours) noexcept { UTC_n = hours; this->invalidate_observer(); };
+	T get_latitude() const noexcept { return φ; };
+	T get_longitude() const noexcept { return λ; };
+	int get_utc_offset() const noexcept { return UTC_n; };
+
+	// статистика светового дня тоже сбрасывается: она - выдача наблюдателя
+	void reset_observer() override;
+	void add_result(const Vector<T>& X, T t) override;
+	void save_state(std::ostream& out) const override;
+	void load_state(std::istream& in) override;
 };
\ No newline at end of file
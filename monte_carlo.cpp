@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <iomanip>
+#include <limits>
+#include <math.h>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "monte_carlo.hpp"
+#include "profile.hpp"
+
+counter_rng::counter_rng(uint64_t seed, uint64_t stream) noexcept :
+	key{ uint32_t(seed), uint32_t(seed >> 32) }, counter{ 0u, 0u, uint32_t(stream), uint32_t(stream >> 32) }, block{} {};
+
+uint32_t counter_rng::next_u32() noexcept {
+	if (used < 4u)
+		return block[used++];
+
+	// 10 раундов Philox4x32: умножение 32x32 -> 64 и перестановка слов
+	uint32_t x[4] = { counter[0], counter[1], counter[2], counter[3] };
+	uint32_t k0 = key[0], k1 = key[1];
+
+	for (int round = 0; round < 10; ++round) {
+		uint64_t p0 = uint64_t(0xD2511F53u) * x[0];
+		uint64_t p1 = uint64_t(0xCD9E8D57u) * x[2];
+
+		uint32_t y0 = uint32_t(p1 >> 32) ^ x[1] ^ k0;
+		uint32_t y1 = uint32_t(p1);
+		uint32_t y2 = uint32_t(p0 >> 32) ^ x[3] ^ k1;
+		uint32_t y3 = uint32_t(p0);
+		x[0] = y0;
+		x[1] = y1;
+		x[2] = y2;
+		x[3] = y3;
+
+		k0 += 0x9E3779B9u;
+		k1 += 0xBB67AE85u;
+	}
+
+	for (int count = 0; count < 4; ++count)
+		block[count] = x[count];
+
+	// номер блока - младшие 64 бита счётчика, номер испытания - старшие
+	if (++counter[0] == 0u)
+		++counter[1];
+
+	used = 1u;
+	return block[0];
+}
+
+uint64_t counter_rng::next_u64() noexcept {
+	uint64_t low = next_u32();
+	return (uint64_t(next_u32()) << 32) | low;
+}
+
+double counter_rng::uniform() noexcept {
+	// 53 старших бита, сдвиг на полшага: 0 и 1 не выпадают
+	return (double(next_u64() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+double counter_rng::normal() noexcept {
+	if (has_spare) {
+		has_spare = false;
+		return spare;
+	}
+
+	double r = sqrt(-2 * log(uniform()));
+	double angle = 6.283185307179586 * uniform();
+
+	spare = r * sin(angle);
+	has_spare = true;
+	return r * cos(angle);
+}
+
+void running_stats::add(double x) noexcept {
+	if (count == 0u)
+		min = max = x;
+	else {
+		min = std::min(min, x);
+		max = std::max(max, x);
+	}
+
+	++count;
+	double delta = x - mean;
+	mean += delta / count;
+	m2 += delta * (x - mean);
+}
+
+void running_stats::merge(const running_stats& other) noexcept {
+	if (other.count == 0u)
+		return;
+	if (count == 0u) {
+		*this = other;
+		return;
+	}
+
+	uint64_t total = count + other.count;
+	double delta = other.mean - mean;
+
+	mean += delta * other.count / total;
+	m2 += other.m2 + delta * delta * (double(count) * other.count / total);
+	min = std::min(min, other.min);
+	max = std::max(max, other.max);
+	count = total;
+}
+
+double running_stats::stddev() const noexcept {
+	return sqrt(variance());
+}
+
+p2_quantile::p2_quantile(double p) noexcept : p(p), q{}, n{ 0, 1, 2, 3, 4 }, np{ 0, 2 * p, 4 * p, 2 + 2 * p, 4 }, dn{ 0, p / 2, p, (1 + p) / 2, 1 } {};
+
+void p2_quantile::add(double x) noexcept {
+	// первые пять значений - сами маркеры
+	if (count < 5u) {
+		q[count++] = x;
+		std::sort(q, q + count);
+		return;
+	}
+	++count;
+
+	int k;
+	if (x < q[0]) {
+		q[0] = x;
+		k = 0;
+	}
+	else if (x >= q[4]) {
+		q[4] = x;
+		k = 3;
+	}
+	else
+		for (k = 0; k < 3 && x >= q[k + 1]; ++k);
+
+	for (int i = k + 1; i < 5; ++i)
+		n[i] += 1;
+	for (int i = 0; i < 5; ++i)
+		np[i] += dn[i];
+
+	// средние маркеры сдвигаются к желаемым положениям: парабола, если она не нарушает порядок, иначе прямая
+	for (int i = 1; i < 4; ++i) {
+		double d = np[i] - n[i];
+
+		if ((d < 1 || n[i + 1] - n[i] <= 1) && (d > -1 || n[i - 1] - n[i] >= -1))
+			continue;
+
+		d = d > 0 ? 1 : -1;
+		double parabolic = q[i] + d / (n[i + 1] - n[i - 1]) *
+			((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) + (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+
+		if (q[i - 1] < parabolic && parabolic < q[i + 1])
+			q[i] = parabolic;
+		else {
+			int j = i + int(d);
+			q[i] += d * (q[j] - q[i]) / (n[j] - n[i]);
+		}
+		n[i] += d;
+	}
+}
+
+double p2_quantile::value() const noexcept {
+	if (count == 0u)
+		return std::numeric_limits<double>::quiet_NaN();
+
+	// пока маркеров меньше пяти, они - упорядоченная выборка
+	if (count < 5u)
+		return q[uint64_t(round(p * (count - 1u)))];
+
+	return q[2];
+}
+
+monte_carlo::monte_carlo(const std::vector<std::string>& outputs, const std::vector<double>& probabilities) :
+	names(outputs), probabilities(probabilities), stats(outputs.size()), missing(outputs.size()) {
+	if (outputs.empty())
+		throw std::logic_error("monte_carlo outputs");
+
+	for (double p : probabilities)
+		if (!(p > 0 && p < 1))
+			throw std::logic_error("monte_carlo probability");
+
+	for (uint64_t output = 0u; output < outputs.size(); ++output)
+		quantiles.emplace_back(probabilities.begin(), probabilities.end());
+};
+
+uint64_t monte_carlo::index(const std::string& name) const {
+	for (uint64_t output = 0u; output < names.size(); ++output)
+		if (names[output] == name)
+			return output;
+
+	throw std::logic_error("monte_carlo name");
+}
+
+void monte_carlo::run(uint64_t count, const trial& f) {
+	LR5_SCOPE("monte_carlo/run");
+	const uint64_t width = names.size();
+	const uint64_t first = done;
+	const uint64_t chunks = (count + chunk - 1u) / chunk;
+
+	std::atomic<uint64_t> next{ 0u };
+	std::mutex mutex;
+	std::condition_variable turn;
+	uint64_t committed = 0u;
+	std::exception_ptr error;
+
+	auto worker = [&] {
+		// выход блока: chunk строк по width величин, память - на поток, а не на испытание
+		std::vector<double> buffer(chunk * width);
+
+		for (uint64_t index = next++; index < chunks; index = next++) {
+			uint64_t begin = index * chunk;
+			uint64_t end = std::min(count, begin + chunk);
+			bool failed = false;
+
+			std::fill(buffer.begin(), buffer.end(), std::numeric_limits<double>::quiet_NaN());
+			try {
+				for (uint64_t sample = begin; sample < end; ++sample) {
+					counter_rng rng(seed, first + sample);
+					f(first + sample, rng, buffer.data() + (sample - begin) * width);
+				}
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!error)
+					error = std::current_exception();
+				failed = true;
+			}
+
+			// блоки добавляются по порядку номеров: P² зависит от порядка значений
+			std::unique_lock<std::mutex> lock(mutex);
+			turn.wait(lock, [&] { return committed == index; });
+
+			if (!failed && !error)
+				for (uint64_t row = 0u; row < end - begin; ++row)
+					for (uint64_t output = 0u; output < width; ++output) {
+						double value = buffer[row * width + output];
+						if (isnan(value)) {
+							++missing[output];
+							continue;
+						}
+
+						stats[output].add(value);
+						for (auto& sketch : quantiles[output])
+							sketch.add(value);
+					}
+
+			++committed;
+			turn.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (uint64_t extra = 1u; extra < std::min(threads, chunks); ++extra)
+		workers.emplace_back(worker);
+
+	worker();
+
+	for (auto& thread : workers)
+		thread.join();
+
+	if (error)
+		std::rethrow_exception(error);
+
+	done += count;
+	LR5_COUNT("monte_carlo/samples", count);
+}
+
+void monte_carlo::write(std::ostream& out) const {
+	out << std::left << std::setw(16) << "output" << std::right << std::setw(10) << "n" << std::setw(16) << "mean"
+		<< std::setw(14) << "stddev" << std::setw(16) << "min" << std::setw(16) << "max";
+	for (double p : probabilities)
+		out << std::setw(15) << ("q" + std::to_string(int(round(p * 100))));
+	out << '\n';
+
+	for (uint64_t output = 0u; output < names.size(); ++output) {
+		const running_stats& s = stats[output];
+		out << std::left << std::setw(16) << names[output] << std::right << std::setw(10) << s.count
+			<< std::setprecision(10) << std::setw(16) << s.mean << std::setprecision(4) << std::setw(14) << s.stddev()
+			<< std::setprecision(10) << std::setw(16) << s.min << std::setw(16) << s.max;
+		for (uint64_t probability = 0u; probability < probabilities.size(); ++probability)
+			out << std::setw(15) << quantile(output, probability);
+		out << '\n';
+	}
+}
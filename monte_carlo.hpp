@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// счётчиковый генератор Philox4x32-10 (Salmon и др., 2011): число - функция ключа (seed)
+// и счётчика (номер испытания, номер блока), поэтому поток испытания воспроизводим
+// независимо от порядка испытаний и числа потоков
+class counter_rng {
+private:
+	uint32_t key[2];
+	uint32_t counter[4];
+	uint32_t block[4];
+	unsigned used = 4u;
+	bool has_spare = false;
+	double spare = 0;
+public:
+	counter_rng(uint64_t seed, uint64_t stream) noexcept;
+
+	uint32_t next_u32() noexcept;
+	uint64_t next_u64() noexcept;
+	// равномерное на (0, 1)
+	double uniform() noexcept;
+	// нормальное N(0, 1), преобразование Бокса - Мюллера
+	double normal() noexcept;
+	double normal(double mean, double sigma) noexcept { return mean + sigma * normal(); };
+};
+
+// среднее и дисперсия за один проход (Уэлфорд), объединение частичных итогов - по Чану
+struct running_stats {
+	uint64_t count = 0u;
+	double mean = 0;
+	double m2 = 0;
+	double min = 0;
+	double max = 0;
+
+	void add(double x) noexcept;
+	void merge(const running_stats& other) noexcept;
+	double variance() const noexcept { return count > 1u ? m2 / (count - 1u) : 0; };
+	double stddev() const noexcept;
+};
+
+// квантиль за один проход по пяти маркерам (P², Jain, Chlamtac, 1985): память O(1), выборка не хранится
+class p2_quantile {
+private:
+	double p;
+	uint64_t count = 0u;
+	double q[5];
+	double n[5];
+	double np[5];
+	double dn[5];
+public:
+	p2_quantile(double p) noexcept;
+
+	void add(double x) noexcept;
+	double probability() const noexcept { return p; };
+	double value() const noexcept;
+};
+
+// метод Монте-Карло: испытания независимы, каждое получает свой поток counter_rng(seed, номер испытания)
+// и пишет выходные величины в outputs; хранятся только итоги (running_stats и p2_quantile на величину),
+// так что память не растёт с числом испытаний. Испытания идут блоками по chunk в нескольких потоках,
+// итоги блоков добавляются строго по порядку - результат не зависит от числа потоков
+class monte_carlo {
+public:
+	// outputs заранее заполнен NaN: неопределённая величина (например, нет восхода) пропускается
+	using trial = std::function<void(uint64_t sample, counter_rng& rng, double* outputs)>;
+private:
+	std::vector<std::string> names;
+	std::vector<double> probabilities;
+	uint64_t seed = 0u;
+	uint64_t threads = 1u;
+	uint64_t chunk = 64u;
+
+	uint64_t done = 0u;
+	std::vector<running_stats> stats;
+	std::vector<std::vector<p2_quantile>> quantiles;
+	std::vector<uint64_t> missing;
+public:
+	monte_carlo(const std::vector<std::string>& outputs, const std::vector<double>& probabilities = { 0.05, 0.5, 0.95 });
+
+	void set_seed(uint64_t value) noexcept { seed = value; };
+	void set_threads(uint64_t count) noexcept { threads = count ? count : 1u; };
+	void set_chunk(uint64_t size) noexcept { chunk = size ? size : 1u; };
+
+	// ещё count испытаний, начиная с номера samples(): прогон можно продолжать
+	void run(uint64_t count, const trial& f);
+
+	uint64_t samples() const noexcept { return done; };
+	uint64_t outputs() const noexcept { return names.size(); };
+	uint64_t index(const std::string& name) const;
+	const running_stats& get_stats(uint64_t output) const { return stats.at(output); };
+	double quantile(uint64_t output, uint64_t probability) const { return quantiles.at(output).at(probability).value(); };
+	uint64_t get_missing(uint64_t output) const { return missing.at(output); };
+
+	// таблица итогов: величина, n, среднее, СКО, min, max, квантили
+	void write(std::ostream& out) const;
+};
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include "monte_carlo.hpp"
+#include "integrator.hpp"
+
+// monte_carlo_tool [испытаний] [потоков] [seed]
+// разброс восхода, захода и полуденной тени солнечных часов sundial_model (55°, 37°, 15.03.2024)
+// при ошибках начального состояния Земли и её ориентации
+int main(int argc, char** argv) {
+	uint64_t samples = argc > 1 ? atoll(argv[1]) : 200u;
+	uint64_t threads = argc > 2 ? atoll(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+	uint64_t seed = argc > 3 ? atoll(argv[3]) : 1u;
+
+	if (!samples) {
+		std::cout << "usage: monte_carlo_tool [samples] [threads] [seed]" << '\n';
+		return 1;
+	}
+
+	// СКО: положение 10 км, скорость 1 мм/с, звёздный угол 1 с вращения
+	const real_t sigma_r = 1e4, sigma_v = 1e-3, sigma_s = 7.292115e-5;
+	const real_t date = get_JDN(2024, 3, 15, 0, 0, 0);
+
+	monte_carlo mc({ "sunrise", "sunset", "noon_shadow" });
+	mc.set_seed(seed);
+	mc.set_threads(threads);
+
+	auto start = std::chrono::steady_clock::now();
+	mc.run(samples, [&](uint64_t, counter_rng& rng, double* outputs) {
+		sundial_model<real_t> model(rad(55), rad(37), date);
+		model.set_adaptive(1e-3);
+
+		Vector<real_t> X = model.get_init();
+		for (uint64_t axis = 0u; axis < 3u; ++axis) {
+			X.at(axis) += sigma_r * rng.normal();
+			X.at(3 + axis) += sigma_v * rng.normal();
+		}
+		model.set_init(X);
+		model.set_rotation_offset(sigma_s * rng.normal());
+
+		DormandPrinceIntegrator<real_t> integrator(scalar_traits<real_t>::tolerance);
+		integrator.run(model);
+
+		// светлое время - строки выдачи: первая и последняя - восход и заход, самая короткая тень - около полудня
+		const result_table& res = model.get_result();
+		if (res.rows() == 0u)
+			return;
+
+		double shortest = 0;
+		for (uint64_t row = 0u; row < res.rows(); ++row) {
+			double x = res.value(row, 0), y = res.value(row, 1), z = res.value(row, 2);
+			double length = sqrt(x * x + y * y + z * z);
+			if (row == 0u || length < shortest)
+				shortest = length;
+		}
+
+		outputs[0] = res.value(0, 4);
+		outputs[1] = res.value(res.rows() - 1u, 4);
+		outputs[2] = shortest;
+	});
+	auto end = std::chrono::steady_clock::now();
+
+	mc.write(std::cout);
+	std::cout << "Samples: " << mc.samples() << ", threads: " << threads << ", "
+		<< std::chrono::duration<double>(end - start).count() << " s" << '\n';
+
+	return 0;
+}
@@ -0,0 +1,332 @@
+#include "nbody.hpp"
+#include "fnv_hash.hpp"
+
+// средние элементы орбит на J2000 и их скорости изменения за юлианское столетие (Standish, табл. 1):
+// a, а.е.; e; I, L, ϖ (долгота перигелия), Ω, градусы; эклиптика и равноденствие J2000
+struct mean_elements {
+	const char* name;
+	double mu;
+	double a, e, I, L, ϖ, Ω;
+	double da, de, dI, dL, dϖ, dΩ;
+};
+
+static const double au = 1.495978707e11;
+static const double mu_sun = 132712.43994e15;
+static const double mu_earth = 398600.4418e9;
+static const double mu_moon = 4902.800066e9;
+
+static const mean_elements planets[] = {
+	{ "mercury", 2.2031780e13, 0.38709927, 0.20563593, 7.00497902, 252.25032350, 77.45779628, 48.33076593,
+		0.00000037, 0.00001906, -0.00594749, 149472.67411175, 0.16047689, -0.12534081 },
+	{ "venus", 3.24858592e14, 0.72333566, 0.00677672, 3.39467605, 181.97909950, 131.60246718, 76.67984255,
+		0.00000390, -0.00004107, -0.00078890, 58517.81538729, 0.00268329, -0.27769418 },
+	{ "earth", mu_earth + mu_moon, 1.00000261, 0.01671123, -0.00001531, 100.46457166, 102.93768193, 0.0,
+		0.00000562, -0.00004392, -0.01294668, 35999.37244981, 0.32327364, 0.0 },
+	{ "mars", 4.2828375e13, 1.52371034, 0.09339410, 1.84969142, -4.55343205, -23.94362959, 49.55953891,
+		0.00001847, 0.00007882, -0.00813131, 19140.30268499, 0.44441088, -0.29257343 },
+	{ "jupiter", 1.26712765e17, 5.20288700, 0.04838624, 1.30439695, 34.39644051, 14.72847983, 100.47390909,
+		-0.00011607, -0.00013253, -0.00183714, 3034.74612775, 0.21252668, 0.20469106 },
+	{ "saturn", 3.7940585e16, 9.53667594, 0.05386179, 2.48599187, 49.95424423, 92.59887831, 113.66242448,
+		-0.00125060, -0.00050991, 0.00193609, 1222.49362201, -0.41897216, -0.28867794 },
+	{ "uranus", 5.794549e15, 19.18916464, 0.04725744, 0.77263783, 313.23810451, 170.95427630, 74.01692503,
+		-0.00196176, -0.00004397, -0.00242939, 428.48202785, 0.40805281, 0.04240589 },
+	{ "neptune", 6.836527e15, 30.06992276, 0.00859048, 1.77004347, -55.12002969, 44.96476227, 131.78422574,
+		0.00026291, 0.00005105, 0.00035372, 218.45945325, -0.32241464, -0.00508664 },
+};
+
+// положение и скорость на кеплеровой орбите в эклиптике J2000 по элементам (углы в радианах)
+static void kepler_state(double mu, double a, double e, double I, double M, double ω, double Ω, double* r, double* v) {
+	// уравнение Кеплера методом Ньютона
+	double E = M + e * sin(M);
+	for (int iteration = 0; iteration < 30; ++iteration) {
+		double dE = (E - e * sin(E) - M) / (1.0 - e * cos(E));
+		E -= dE;
+		if (fabs(dE) < 1e-15)
+			break;
+	}
+
+	double b = a * sqrt(1.0 - e * e);
+	double n = sqrt(mu / (a * a * a));
+	double rate = n / (1.0 - e * cos(E));
+
+	// в плоскости орбиты: ось x - на перицентр
+	double px = a * (cos(E) - e), py = b * sin(E);
+	double qx = -a * sin(E) * rate, qy = b * cos(E) * rate;
+
+	double cω = cos(ω), sω = sin(ω), cΩ = cos(Ω), sΩ = sin(Ω), cI = cos(I), sI = sin(I);
+	double m[6] = {
+		cω * cΩ - sω * sΩ * cI, -sω * cΩ - cω * sΩ * cI,
+		cω * sΩ + sω * cΩ * cI, -sω * sΩ + cω * cΩ * cI,
+		sω * sI, cω * sI,
+	};
+
+	for (int axis = 0; axis < 3; ++axis) {
+		r[axis] = m[axis * 2] * px + m[axis * 2 + 1] * py;
+		v[axis] = m[axis * 2] * qx + m[axis * 2 + 1] * qy;
+	}
+}
+
+// эклиптика J2000 -> экватор J2000
+static void ecliptic_to_equator(double* vec) {
+	const double ε = rad(23.43928);
+	double y = vec[1], z = vec[2];
+	vec[1] = cos(ε) * y - sin(ε) * z;
+	vec[2] = sin(ε) * y + cos(ε) * z;
+}
+
+template<typename T>
+std::vector<nbody_body<T>> solar_system(double jd, bool with_moon) {
+	double T_c = (jd - 2451545.0) / 36525.0;
+
+	std::vector<nbody_body<T>> output;
+	output.push_back({ "sun", T(mu_sun), Vector<T>(3), Vector<T>(3) });
+
+	for (const auto& p : planets) {
+		double a = (p.a + p.da * T_c) * au;
+		double e = p.e + p.de * T_c;
+		double I = rad(p.I + p.dI * T_c);
+		double L = rad(p.L + p.dL * T_c);
+		double ϖ = rad(p.ϖ + p.dϖ * T_c);
+		double Ω = rad(p.Ω + p.dΩ * T_c);
+
+		double r[3], v[3];
+		kepler_state(mu_sun + p.mu, a, e, I, L - ϖ, ϖ - Ω, Ω, r, v);
+		ecliptic_to_equator(r);
+		ecliptic_to_equator(v);
+
+		if (std::string(p.name) != "earth" || !with_moon) {
+			output.push_back({ p.name, T(p.mu), Vector<T>({ r[0], r[1], r[2] }), Vector<T>({ v[0], v[1], v[2] }) });
+			continue;
+		}
+
+		// элементы относятся к барицентру Земля - Луна: Луна - по средним элементам орбиты (Meeus, гл. 47)
+		double Lm = rad(218.3164477 + 481267.88123421 * T_c);
+		double Mm = rad(134.9633964 + 477198.8675055 * T_c);
+		double Ωm = rad(125.0445479 - 1934.1362891 * T_c);
+
+		double rm[3], vm[3];
+		kepler_state(mu_earth + mu_moon, 384748.0e3, 0.0549, rad(5.145), Mm, Lm - Mm - Ωm, Ωm, rm, vm);
+		ecliptic_to_equator(rm);
+		ecliptic_to_equator(vm);
+
+		double earth_share = mu_moon / (mu_earth + mu_moon);
+		double moon_share = mu_earth / (mu_earth + mu_moon);
+
+		output.push_back({ "earth", T(mu_earth),
+			Vector<T>({ r[0] - earth_share * rm[0], r[1] - earth_share * rm[1], r[2] - earth_share * rm[2] }),
+			Vector<T>({ v[0] - earth_share * vm[0], v[1] - earth_share * vm[1], v[2] - earth_share * vm[2] }) });
+		output.push_back({ "moon", T(mu_moon),
+			Vector<T>({ r[0] + moon_share * rm[0], r[1] + moon_share * rm[1], r[2] + moon_share * rm[2] }),
+			Vector<T>({ v[0] + moon_share * vm[0], v[1] + moon_share * vm[1], v[2] + moon_share * vm[2] }) });
+	}
+
+	// перенос в барицентр: суммарный импульс и центр масс - нулевые
+	Vector<T> center(3), momentum(3);
+	T total = 0;
+	for (const auto& body : output) {
+		center.axpy(body.mu, body.r);
+		momentum.axpy(body.mu, body.v);
+		total += body.mu;
+	}
+	center *= 1 / total;
+	momentum *= 1 / total;
+
+	for (auto& body : output) {
+		body.r -= center;
+		body.v -= momentum;
+	}
+
+	return output;
+}
+
+template<typename T>
+static Vector<T> pack_state(const std::vector<nbody_body<T>>& bodies) {
+	uint64_t N = bodies.size();
+	Vector<T> output(6 * N);
+
+	for (uint64_t body = 0u; body < N; ++body)
+		for (uint64_t axis = 0u; axis < 3u; ++axis) {
+			output.at(axis * N + body) = bodies[body].r.at(axis);
+			output.at((3 + axis) * N + body) = bodies[body].v.at(axis);
+		}
+
+	return output;
+}
+
+template<typename T>
+nbody_model<T>::nbody_model(const std::vector<nbody_body<T>>& bodies, T t0, T t1, T inc) : model_t<T>(pack_state(bodies), t0, t1, inc) {
+	if (bodies.empty())
+		throw std::logic_error("nbody bodies");
+
+	uint64_t hash = fnv_offset;
+	std::vector<result_table::column_info> columns;
+
+	for (const auto& body : bodies) {
+		names.push_back(body.name);
+		mu.push_back(body.mu);
+
+		hash_value(hash, body.mu);
+
+		columns.push_back({ body.name + "_x", column_type::float64 });
+		columns.push_back({ body.name + "_y", column_type::float64 });
+		columns.push_back({ body.name + "_z", column_type::float64 });
+	}
+
+	// параметры тел не входят в начальное состояние: их хэш - часть ключа кэша траекторий
+	id = "nbody" + std::to_string(bodies.size()) + "_" + hash_hex(hash);
+
+	// выдача - положения всех тел
+	this->res = result_table(columns);
+};
+
+template<typename T>
+nbody_model<T>::nbody_model(const nbody_model& other) :
+	model_t<T>(other), names(other.names), mu(other.mu), id(other.id), threads(other.threads), parallel_from(other.parallel_from) {};
+
+template<typename T>
+nbody_model<T>& nbody_model<T>::operator=(const nbody_model& other) {
+	if (this != &other) {
+		model_t<T>::operator=(other);
+		names = other.names;
+		mu = other.mu;
+		id = other.id;
+		threads = other.threads;
+		parallel_from = other.parallel_from;
+		pool.reset();
+	}
+	return *this;
+}
+
+template<typename T>
+uint64_t nbody_model<T>::index(const std::string& name) const {
+	for (uint64_t body = 0u; body < names.size(); ++body)
+		if (names[body] == name)
+			return body;
+
+	throw std::logic_error("nbody name");
+}
+
+template<typename T>
+Vector<T> nbody_model<T>::position(const Vector<T>& X, uint64_t body) const {
+	uint64_t N = count();
+	return Vector<T>({ X.at(body), X.at(N + body), X.at(2 * N + body) });
+}
+
+template<typename T>
+Vector<T> nbody_model<T>::velocity(const Vector<T>& X, uint64_t body) const {
+	uint64_t N = count();
+	return Vector<T>({ X.at(3 * N + body), X.at(4 * N + body), X.at(5 * N + body) });
+}
+
+template<typename T>
+void nbody_model<T>::add_result(const Vector<T>& X, T) {
+	LR5_SCOPE("nbody/add_result");
+	uint64_t N = count();
+
+	if (this->res.rows() == 0u)
+		this->res.reserve(uint64_t((this->get_t1() - this->get_t0()) / this->get_step()) + 1u);
+
+	for (uint64_t body = 0u; body < N; ++body)
+		for (uint64_t axis = 0u; axis < 3u; ++axis)
+			this->res.append(body * 3 + axis, X.at(axis * N + body));
+}
+
+template<typename T>
+void nbody_model<T>::accelerations_pairwise(const T* x, const T* y, const T* z, T* ax, T* ay, T* az) const {
+	uint64_t N = count();
+	const T* m = mu.data();
+
+	// каждая пара считается один раз: 1/r^3 через один sqrt вместо pow
+	for (uint64_t i = 0u; i < N; ++i) {
+		T sx = 0, sy = 0, sz = 0;
+
+		for (uint64_t j = i + 1u; j < N; ++j) {
+			T dx = x[j] - x[i];
+			T dy = y[j] - y[i];
+			T dz = z[j] - z[i];
+			T r2 = dx * dx + dy * dy + dz * dz;
+			T inv_r3 = 1 / (r2 * sqrt(r2));
+
+			sx += m[j] * inv_r3 * dx;
+			sy += m[j] * inv_r3 * dy;
+			sz += m[j] * inv_r3 * dz;
+
+			ax[j] -= m[i] * inv_r3 * dx;
+			ay[j] -= m[i] * inv_r3 * dy;
+			az[j] -= m[i] * inv_r3 * dz;
+		}
+
+		ax[i] += sx;
+		ay[i] += sy;
+		az[i] += sz;
+	}
+}
+
+template<typename T>
+void nbody_model<T>::accelerations(const T* x, const T* y, const T* z, T* ax, T* ay, T* az, uint64_t begin, uint64_t end) const {
+	uint64_t N = count();
+	const T* m = mu.data();
+
+	// строки [begin, end) пишутся только своим потоком
+	for (uint64_t i = begin; i < end; ++i) {
+		T sx = 0, sy = 0, sz = 0;
+
+		for (uint64_t j = 0u; j < N; ++j) {
+			if (j == i)
+				continue;
+
+			T dx = x[j] - x[i];
+			T dy = y[j] - y[i];
+			T dz = z[j] - z[i];
+			T r2 = dx * dx + dy * dy + dz * dz;
+			T inv_r3 = m[j] / (r2 * sqrt(r2));
+
+			sx += inv_r3 * dx;
+			sy += inv_r3 * dy;
+			sz += inv_r3 * dz;
+		}
+
+		ax[i] = sx;
+		ay[i] = sy;
+		az[i] = sz;
+	}
+}
+
+template<typename T>
+Vector<T> nbody_model<T>::get_right(const Vector<T>& X, T) const {
+	LR5_SCOPE("nbody/get_right");
+	uint64_t N = count();
+	Vector<T> dX(6 * N);
+
+	const T* x = X.data();
+	T* d = dX.data();
+
+	// dr/dt = v
+	for (uint64_t count = 0u; count < 3 * N; ++count)
+		d[count] = x[3 * N + count];
+
+	T* ax = d + 3 * N;
+	T* ay = d + 4 * N;
+	T* az = d + 5 * N;
+
+	if (threads <= 1u || N < parallel_from) {
+		accelerations_pairwise(x, x + N, x + 2 * N, ax, ay, az);
+		return dX;
+	}
+
+	if (!pool)
+		pool.reset(new worker_pool(threads));
+
+	uint64_t rows = (N + threads - 1u) / threads;
+	pool->run(threads, [&](uint64_t part) {
+		uint64_t begin = std::min(N, part * rows), end = std::min(N, begin + rows);
+		accelerations(x, x + N, x + 2 * N, ax, ay, az, begin, end);
+	});
+
+	return dX;
+}
+
+template std::vector<nbody_body<double>> solar_system(double jd, bool with_moon);
+template std::vector<nbody_body<long double>> solar_system(double jd, bool with_moon);
+template class nbody_model<double>;
+template class nbody_model<long double>;
@@ -0,0 +1,58 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "model.hpp"
+#include "worker_pool.hpp"
+
+// тело задачи N тел: гравитационный параметр, м^3/с^2, положение и скорость, м, м/с
+template<typename T>
+struct nbody_body {
+	std::string name;
+	T mu;
+	Vector<T> r;
+	Vector<T> v;
+};
+
+// Солнце, планеты и Луна на юлианскую дату jd (TT) по средним элементам орбит JPL
+// (Standish, 1800-2050 гг.; положения планет ~1e-3 а.е.), Луна - по средним элементам
+// кеплеровой орбиты вокруг Земли; система координат - экватор J2000, начало - барицентр
+template<typename T>
+std::vector<nbody_body<T>> solar_system(double jd, bool with_moon = true);
+
+// все тела интегрируются вместе; вектор состояния хранится по компонентам (SoA):
+// x[N], y[N], z[N], vx[N], vy[N], vz[N] - так ядро попарного притяжения идёт подряд по памяти
+template<typename T>
+class nbody_model : public model_t<T> {
+protected:
+	std::vector<std::string> names;
+	std::vector<T> mu;
+	std::string id;
+	uint64_t threads = 1u;
+	uint64_t parallel_from = 256u;
+	mutable std::unique_ptr<worker_pool> pool; // создаётся при первом параллельном вызове get_right
+
+	// ускорения тел [begin, end) от всех N тел (в потоке), либо по парам i < j (последовательно)
+	void accelerations(const T* x, const T* y, const T* z, T* ax, T* ay, T* az, uint64_t begin, uint64_t end) const;
+	void accelerations_pairwise(const T* x, const T* y, const T* z, T* ax, T* ay, T* az) const;
+public:
+	nbody_model(const std::vector<nbody_body<T>>& bodies, T t0, T t1, T inc);
+	// пул не копируется: копия заводит свой
+	nbody_model(const nbody_model& other);
+	nbody_model& operator=(const nbody_model& other);
+
+	uint64_t count() const noexcept { return mu.size(); };
+	uint64_t index(const std::string& name) const;
+	const std::string& name(uint64_t body) const { return names.at(body); };
+
+	// при N >= from правая часть делится между потоками по строкам i; потоки пула живут с моделью
+	void set_threads(uint64_t count, uint64_t from = 256u) noexcept { threads = count ? count : 1u; parallel_from = from; pool.reset(); };
+
+	// положение и скорость тела из вектора состояния
+	Vector<T> position(const Vector<T>& X, uint64_t body) const;
+	Vector<T> velocity(const Vector<T>& X, uint64_t body) const;
+
+	void add_result(const Vector<T>& X, T t) override;
+	Vector<T> get_right(const Vector<T>& X, T t) const override;
+	const char* rhs_id() const noexcept override { return id.c_str(); };
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+// скалярный тип цепочки модель - интегратор;
+// модели, интеграторы и кэш траекторий явно инстанцированы для double и long double
+#if defined(LR5_REAL_DOUBLE)
+using real_t = double;
+#else
+using real_t = long double;
+#endif
+
+template<typename T>
+struct scalar_traits;
+
+template<>
+struct scalar_traits<double> {
+	static constexpr const char* name = "double";
+	static constexpr double tolerance = 1e-13;
+};
+
+template<>
+struct scalar_traits<long double> {
+	static constexpr const char* name = "long double";
+	static constexpr long double tolerance = 1e-16l;
+};
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "profile.hpp"
+
+namespace profile {
+
+namespace {
+
+struct stat {
+	uint64_t calls = 0u;
+	uint64_t total = 0u;
+	double sum = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+};
+
+struct event {
+	uint32_t id;
+	uint64_t begin;
+	uint64_t duration;
+};
+
+// буфер пишет только свой поток; lock - против чтения reset/report/write_trace из другого потока
+struct thread_data {
+	std::mutex lock;
+	uint32_t tid;
+	std::vector<stat> stats;
+	std::vector<event> events;
+};
+
+struct registry {
+	std::mutex lock;
+	std::vector<std::string> names;
+	std::vector<kind> kinds;
+	std::vector<std::shared_ptr<thread_data>> threads;
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+registry& global() {
+	static registry instance;
+	return instance;
+}
+
+std::atomic<bool> trace_enabled{ false };
+std::atomic<uint64_t> trace_limit{ 1000000u };
+
+// буфер текущего потока регистрируется один раз и переживает сам поток
+thread_data& local() {
+	thread_local std::shared_ptr<thread_data> data;
+	if (!data) {
+		registry& reg = global();
+		std::lock_guard<std::mutex> guard(reg.lock);
+		data = std::make_shared<thread_data>();
+		data->tid = uint32_t(reg.threads.size());
+		reg.threads.push_back(data);
+	}
+	return *data;
+}
+
+stat& local_stat(thread_data& data, uint32_t id) {
+	if (id >= data.stats.size())
+		data.stats.resize(id + 1u);
+	return data.stats[id];
+}
+
+void json_string(std::ostream& out, const std::string& str) {
+	out << '"';
+	for (char ch : str) {
+		if (ch == '"' || ch == '\\')
+			out << '\\';
+		out << ch;
+	}
+	out << '"';
+}
+}
+
+site::site(const char* name, kind type) {
+	registry& reg = global();
+	std::lock_guard<std::mutex> guard(reg.lock);
+
+	for (uint32_t count = 0u; count < reg.names.size(); ++count)
+		if (reg.names[count] == name && reg.kinds[count] == type) {
+			id = count;
+			return;
+		}
+
+	id = uint32_t(reg.names.size());
+	reg.names.push_back(name);
+	reg.kinds.push_back(type);
+}
+
+uint64_t now_ns() noexcept {
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - global().start).count());
+}
+
+void add_time(const site& point, uint64_t begin, uint64_t end) {
+	thread_data& data = local();
+	std::lock_guard<std::mutex> guard(data.lock);
+	stat& s = local_stat(data, point.id);
+	uint64_t duration = end - begin;
+
+	if (s.calls == 0u || duration < s.min)
+		s.min = double(duration);
+	if (s.calls == 0u || duration > s.max)
+		s.max = double(duration);
+	++s.calls;
+	s.total += duration;
+
+	if (trace_enabled.load(std::memory_order_relaxed)) {
+		if (data.events.size() < trace_limit.load(std::memory_order_relaxed))
+			data.events.push_back({ point.id, begin, duration });
+	}
+}
+
+void add_count(const site& point, uint64_t value) {
+	thread_data& data = local();
+	std::lock_guard<std::mutex> guard(data.lock);
+	stat& s = local_stat(data, point.id);
+	++s.calls;
+	s.total += value;
+}
+
+void add_value(const site& point, double value) {
+	thread_data& data = local();
+	std::lock_guard<std::mutex> guard(data.lock);
+	stat& s = local_stat(data, point.id);
+	if (s.calls == 0u || value < s.min)
+		s.min = value;
+	if (s.calls == 0u || value > s.max)
+		s.max = value;
+	++s.calls;
+	s.sum += value;
+}
+
+void set_trace(bool enabled, uint64_t max_events) noexcept {
+	trace_limit.store(max_events);
+	trace_enabled.store(enabled);
+}
+
+void reset() {
+	registry& reg = global();
+	std::lock_guard<std::mutex> guard(reg.lock);
+
+	for (auto& data : reg.threads) {
+		std::lock_guard<std::mutex> data_guard(data->lock);
+		data->stats.clear();
+		data->events.clear();
+	}
+}
+
+void report(std::ostream& out) {
+	registry& reg = global();
+	std::lock_guard<std::mutex> guard(reg.lock);
+
+	// сведение буферов всех потоков
+	std::vector<stat> total(reg.names.size());
+	for (const auto& data : reg.threads) {
+		std::lock_guard<std::mutex> data_guard(data->lock);
+		for (uint32_t id = 0u; id < data->stats.size(); ++id) {
+			const stat& s = data->stats[id];
+			stat& t = total[id];
+			if (s.calls == 0u)
+				continue;
+			t.min = t.calls ? std::min(t.min, s.min) : s.min;
+			t.max = t.calls ? std::max(t.max, s.max) : s.max;
+			t.calls += s.calls;
+			t.total += s.total;
+			t.sum += s.sum;
+		}
+	}
+
+	std::ios state(nullptr);
+	state.copyfmt(out);
+
+	out << std::left << std::setw(32) << "timer" << std::right << std::setw(12) << "calls" << std::setw(16) << "total ms"
+		<< std::setw(16) << "mean ns" << std::setw(12) << "min ns" << std::setw(14) << "max ns" << '\n';
+	out << std::fixed;
+	for (uint32_t id = 0u; id < total.size(); ++id)
+		if (reg.kinds[id] == kind::timer && total[id].calls)
+			out << std::left << std::setw(32) << reg.names[id] << std::right << std::setw(12) << total[id].calls
+				<< std::setw(16) << std::setprecision(3) << total[id].total * 1e-6
+				<< std::setw(16) << std::setprecision(1) << double(total[id].total) / total[id].calls
+				<< std::setw(12) << std::setprecision(0) << total[id].min << std::setw(14) << total[id].max << '\n';
+
+	out << std::defaultfloat << std::setprecision(6);
+	for (uint32_t id = 0u; id < total.size(); ++id)
+		if (reg.kinds[id] == kind::counter && total[id].calls)
+			out << std::left << std::setw(32) << reg.names[id] << std::right << std::setw(12) << total[id].total << '\n';
+
+	for (uint32_t id = 0u; id < total.size(); ++id)
+		if (reg.kinds[id] == kind::value && total[id].calls)
+			out << std::left << std::setw(32) << reg.names[id] << std::right << std::setw(12) << total[id].calls
+				<< "  mean " << total[id].sum / total[id].calls << "  min " << total[id].min << "  max " << total[id].max << '\n';
+
+	out.copyfmt(state);
+}
+
+void write_trace(const char* filename) {
+	std::ofstream f(filename, std::ios::trunc);
+
+	if (!f.is_open())
+		throw std::logic_error("write trace");
+
+	registry& reg = global();
+	std::lock_guard<std::mutex> guard(reg.lock);
+
+	f << std::fixed << std::setprecision(3);
+	f << "{\"traceEvents\":[";
+
+	bool first = true;
+	for (const auto& data : reg.threads) {
+		std::lock_guard<std::mutex> data_guard(data->lock);
+		for (const event& e : data->events) {
+			f << (first ? "\n" : ",\n") << "{\"name\":";
+			json_string(f, reg.names[e.id]);
+			f << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << data->tid << ",\"ts\":" << e.begin * 1e-3 << ",\"dur\":" << e.duration * 1e-3 << '}';
+			first = false;
+		}
+	}
+
+	f << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+
+// инструментирование горячих путей: таймеры областей, счётчики и выборки значений.
+// Макросы LR5_SCOPE/LR5_COUNT/LR5_VALUE раскрываются в пустоту без LR5_PROFILE;
+// данные копятся в буферах потоков под их собственной блокировкой, поэтому отчёт, трассу и сброс
+// можно вызывать и при работающих потоках (nbody, Монте-Карло, CR3BP)
+namespace profile {
+
+enum class kind : uint8_t {
+	timer,
+	counter,
+	value,
+};
+
+// точка измерения; одноимённые точки (например, из разных инстанцирований шаблона) объединяются
+struct site {
+	uint32_t id;
+	site(const char* name, kind type);
+};
+
+uint64_t now_ns() noexcept;
+void add_time(const site& point, uint64_t begin, uint64_t end);
+void add_count(const site& point, uint64_t value);
+void add_value(const site& point, double value);
+
+class scoped_timer {
+private:
+	const site& point;
+	uint64_t begin;
+public:
+	explicit scoped_timer(const site& point) noexcept : point(point), begin(now_ns()) {};
+	scoped_timer(const scoped_timer&) = delete;
+	scoped_timer& operator=(const scoped_timer&) = delete;
+	~scoped_timer() { add_time(point, begin, now_ns()); };
+};
+
+// запись событий трассы (по умолчанию выключена), не более max_events на поток
+void set_trace(bool enabled, uint64_t max_events = 1000000u) noexcept;
+void reset();
+void report(std::ostream& out);
+// формат Chrome trace (chrome://tracing, Perfetto)
+void write_trace(const char* filename);
+}
+
+#if defined(LR5_PROFILE)
+#define LR5_PROFILE_CONCAT_(a, b) a##b
+#define LR5_PROFILE_CONCAT(a, b) LR5_PROFILE_CONCAT_(a, b)
+#define LR5_SCOPE(name) \
+	static const profile::site LR5_PROFILE_CONCAT(lr5_site_, __LINE__)(name, profile::kind::timer); \
+	profile::scoped_timer LR5_PROFILE_CONCAT(lr5_timer_, __LINE__)(LR5_PROFILE_CONCAT(lr5_site_, __LINE__))
+#define LR5_COUNT(name, n) \
+	do { static const profile::site lr5_site(name, profile::kind::counter); profile::add_count(lr5_site, (n)); } while (0)
+#define LR5_VALUE(name, v) \
+	do { static const profile::site lr5_site(name, profile::kind::value); profile::add_value(lr5_site, double(v)); } while (0)
+#else
+#define LR5_SCOPE(name) ((void)0)
+#define LR5_COUNT(name, n) ((void)0)
+#define LR5_VALUE(name, v) ((void)0)
+#endif
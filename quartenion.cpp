@@ -14,19 +14,57 @@ Quartenion::Quartenion(double phi,const Vector<double>& e) : q(cos(phi / 2)){
 }
 
 Quartenion::Quartenion(const Quartenion& quar): q(quar.q){
-	Q = new Vector<double>({0,0,0});
-	(*Q) = quar.vec();
+	Q = new Vector<double>(*quar.Q);
+}
+
+Quartenion::Quartenion(Quartenion&& quar) noexcept : q(quar.q), Q(quar.Q) {
+	quar.Q = nullptr;
 }
 
 Quartenion& Quartenion::operator=(const Quartenion& quar){
 	if (this != &quar) {
 		q = quar.q;
-		(*Q) = quar.vec();
+		if (Q)
+			(*Q) = *quar.Q;
+		else
+			Q = new Vector<double>(*quar.Q);
 	}
 
 	return *this;
 }
 
+Quartenion& Quartenion::operator=(Quartenion&& quar) noexcept {
+	std::swap(q, quar.q);
+	std::swap(Q, quar.Q);
+
+	return *this;
+}
+
+Quartenion& Quartenion::operator+=(const Quartenion& quar) {
+	q += quar.q;
+	(*Q) += *quar.Q;
+
+	return *this;
+}
+
+Quartenion& Quartenion::operator-=(const Quartenion& quar) {
+	q -= quar.q;
+	(*Q) -= *quar.Q;
+
+	return *this;
+}
+
+Quartenion& Quartenion::operator*=(const Quartenion& quar) {
+	return *this = (*this) * quar;
+}
+
+Quartenion& Quartenion::operator*=(double s) noexcept {
+	q *= s;
+	(*Q) *= s;
+
+	return *this;
+}
+
 Quartenion::~Quartenion(){
 	delete Q;
 }
@@ -45,9 +83,9 @@ Quartenion Quartenion::operator-(const Quartenion& quar) const {
 };
 
 Quartenion Quartenion::operator*(const Quartenion& quar) const {
-	double scal = this->scal() * quar.scal() - vec() * quar.vec();
-	Vector<double> part = this->scal() * quar.vec() + quar.scal() * this->vec();
-	Vector<double> last = part + (this->vec() ^ quar.vec());
+	double scal = this->scal() * quar.scal() - (*Q) * (*quar.Q);
+	Vector<double> last = this->scal() * (*quar.Q) + quar.scal() * (*Q);
+	last += (*Q) ^ (*quar.Q);
 	return { scal, last.at(0), last.at(1), last.at(2) };
 };
 
@@ -10,7 +10,10 @@ public:
 	Quartenion(double l0, double l1, double l2, double l3);
 	Quartenion(double phi,const Vector<double>& e);
 	Quartenion(const Quartenion& quar);
+	// после перемещения объект можно только присвоить или уничтожить
+	Quartenion(Quartenion&& quar) noexcept;
 	Quartenion& operator=(const Quartenion& quar);
+	Quartenion& operator=(Quartenion&& quar) noexcept;
 	~Quartenion();
 
 	double scal() const;
@@ -20,6 +23,11 @@ public:
 	Quartenion conj() const;
 	static Quartenion fromKrylovAngles(double yaw, double pitch, double roll);
 
+	Quartenion& operator+=(const Quartenion& quar);
+	Quartenion& operator-=(const Quartenion& quar);
+	Quartenion& operator*=(const Quartenion& quar);
+	Quartenion& operator*=(double s) noexcept;
+
 	Quartenion operator-() const;
 	Quartenion operator+(const Quartenion& quar) const;
 	Quartenion operator-(const Quartenion& quar) const;
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include "result_table.hpp"
+#include "binary_io.hpp"
+
+uint64_t result_table::column::size() const noexcept {
+	switch (info.type) {
+	case column_type::float32:
+		return f32.size();
+	case column_type::float64:
+		return f64.size();
+	case column_type::int32:
+		return i32.size();
+	}
+	return 0u;
+}
+
+result_table::result_table(std::initializer_list<column_info> infos) {
+	for (const auto& info : infos)
+		columns.push_back({ info, {}, {}, {} });
+}
+
+result_table::result_table(const std::vector<column_info>& infos) {
+	for (const auto& info : infos)
+		columns.push_back({ info, {}, {}, {} });
+}
+
+uint64_t result_table::rows() const noexcept {
+	if (columns.empty())
+		return 0u;
+
+	uint64_t output = columns.front().size();
+	for (const auto& c : columns)
+		output = std::min(output, c.size());
+	return output;
+}
+
+uint64_t result_table::bytes() const noexcept {
+	uint64_t output{};
+	for (const auto& c : columns)
+		output += c.f32.size() * sizeof(float) + c.f64.size() * sizeof(double) + c.i32.size() * sizeof(int32_t);
+	return output;
+}
+
+uint64_t result_table::index(const std::string& name) const {
+	for (uint64_t col = 0u; col < columns.size(); ++col)
+		if (columns[col].info.name == name)
+			return col;
+
+	throw std::out_of_range("column " + name);
+}
+
+void result_table::reserve(uint64_t rows) {
+	for (auto& c : columns)
+		switch (c.info.type) {
+		case column_type::float32:
+			c.f32.reserve(rows);
+			break;
+		case column_type::float64:
+			c.f64.reserve(rows);
+			break;
+		case column_type::int32:
+			c.i32.reserve(rows);
+			break;
+		}
+}
+
+void result_table::clear() noexcept {
+	for (auto& c : columns) {
+		c.f32.clear();
+		c.f64.clear();
+		c.i32.clear();
+	}
+}
+
+double result_table::value(uint64_t row, uint64_t col) const {
+	const column& c = columns.at(col);
+	switch (c.info.type) {
+	case column_type::float32:
+		return c.f32.at(row);
+	case column_type::float64:
+		return c.f64.at(row);
+	case column_type::int32:
+		return c.i32.at(row);
+	}
+	return 0.0;
+}
+
+// формат строки как у Vector: значения через пробел
+void result_table::write_row(std::ostream& out, uint64_t row) const {
+	for (uint64_t col = 0u; col < columns.size(); ++col) {
+		const column& c = columns[col];
+
+		if (col)
+			out << ' ';
+
+		switch (c.info.type) {
+		case column_type::float32:
+			out << c.f32.at(row);
+			break;
+		case column_type::float64:
+			out << c.f64.at(row);
+			break;
+		case column_type::int32:
+			out << c.i32.at(row);
+			break;
+		}
+	}
+}
+
+uint64_t result_table::row_bytes() const noexcept {
+	uint64_t output{};
+	for (const auto& c : columns)
+		switch (c.info.type) {
+		case column_type::float32:
+			output += sizeof(float);
+			break;
+		case column_type::float64:
+			output += sizeof(double);
+			break;
+		case column_type::int32:
+			output += sizeof(int32_t);
+			break;
+		}
+	return output;
+}
+
+void result_table::write_rows(std::ostream& out, uint64_t first, uint64_t last) const {
+	for (uint64_t row = first; row < last; ++row)
+		for (const auto& c : columns)
+			switch (c.info.type) {
+			case column_type::float32:
+				write_binary(out, c.f32.at(row));
+				break;
+			case column_type::float64:
+				write_binary(out, c.f64.at(row));
+				break;
+			case column_type::int32:
+				write_binary(out, c.i32.at(row));
+				break;
+			}
+}
+
+void result_table::read_rows(std::istream& in, uint64_t count) {
+	for (uint64_t row = 0u; row < count; ++row)
+		for (auto& c : columns)
+			switch (c.info.type) {
+			case column_type::float32:
+				read_binary(in, c.f32.emplace_back());
+				break;
+			case column_type::float64:
+				read_binary(in, c.f64.emplace_back());
+				break;
+			case column_type::int32:
+				read_binary(in, c.i32.emplace_back());
+				break;
+			}
+}
+
+template<typename V>
+static void write_column(std::ostream& out, const std::vector<V>& data) {
+	write_binary(out, uint64_t(data.size()));
+	out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(V));
+}
+
+template<typename V>
+static void read_column(std::istream& in, std::vector<V>& data) {
+	uint64_t size{};
+	read_binary(in, size);
+
+	data.resize(size);
+	if (!in.read(reinterpret_cast<char*>(data.data()), size * sizeof(V)))
+		throw std::logic_error("read binary");
+}
+
+void write_binary(std::ostream& out, const result_table& table) {
+	write_binary(out, uint64_t(table.columns.size()));
+	for (const auto& c : table.columns) {
+		write_binary(out, uint64_t(c.info.name.size()));
+		out.write(c.info.name.data(), c.info.name.size());
+		write_binary(out, c.info.type);
+		write_column(out, c.f32);
+		write_column(out, c.f64);
+		write_column(out, c.i32);
+	}
+}
+
+void read_binary(std::istream& in, result_table& table) {
+	uint64_t count{};
+	read_binary(in, count);
+
+	table.columns.resize(count);
+	for (auto& c : table.columns) {
+		uint64_t size{};
+		read_binary(in, size);
+
+		c.info.name.resize(size);
+		if (!in.read(&c.info.name[0], size))
+			throw std::logic_error("read binary");
+
+		read_binary(in, c.info.type);
+		read_column(in, c.f32);
+		read_column(in, c.f64);
+		read_column(in, c.i32);
+	}
+}
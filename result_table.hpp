@@ -0,0 +1,138 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "vector.hpp"
+
+enum class column_type : uint8_t {
+	float32,
+	float64,
+	int32,
+};
+
+// непрерывный столбец без копирования; действителен до следующего добавления в таблицу
+template<typename V>
+class column_view {
+private:
+	const V* _data = nullptr;
+	uint64_t _size = 0u;
+public:
+	column_view() noexcept {};
+	column_view(const V* data, uint64_t size) noexcept : _data(data), _size(size) {};
+
+	const V& operator[](uint64_t index) const noexcept { return _data[index]; };
+	const V* data() const noexcept { return _data; };
+	const V* begin() const noexcept { return _data; };
+	const V* end() const noexcept { return _data + _size; };
+	uint64_t size() const noexcept { return _size; };
+};
+
+// таблица результатов по столбцам (SoA): у каждого столбца имя и тип хранения,
+// значения приводятся к типу столбца при добавлении
+class result_table {
+public:
+	struct column_info {
+		std::string name;
+		column_type type;
+	};
+private:
+	struct column {
+		column_info info;
+		std::vector<float> f32;
+		std::vector<double> f64;
+		std::vector<int32_t> i32;
+
+		uint64_t size() const noexcept;
+	};
+
+	std::vector<column> columns;
+public:
+	result_table() noexcept {};
+	result_table(std::initializer_list<column_info> infos);
+	result_table(const std::vector<column_info>& infos);
+
+	uint64_t cols() const noexcept { return columns.size(); };
+	// число полностью заполненных строк
+	uint64_t rows() const noexcept;
+	uint64_t bytes() const noexcept;
+	const column_info& info(uint64_t col) const { return columns.at(col).info; };
+	uint64_t index(const std::string& name) const;
+
+	void reserve(uint64_t rows);
+	void clear() noexcept;
+
+	template<typename V> void append(uint64_t col, V value);
+	template<typename T, typename A> void push_row(const Vector<T, A>& row);
+
+	double value(uint64_t row, uint64_t col) const;
+	template<typename V> column_view<V> column_as(uint64_t col) const;
+	template<typename V> column_view<V> column_as(const std::string& name) const { return column_as<V>(index(name)); };
+
+	void write_row(std::ostream& out, uint64_t row) const;
+	// строки [first, last) подряд, значения в типе столбца: дозапись в файл без заголовка
+	uint64_t row_bytes() const noexcept;
+	void write_rows(std::ostream& out, uint64_t first, uint64_t last) const;
+	// дописать count строк, записанных write_rows
+	void read_rows(std::istream& in, uint64_t count);
+
+	friend void write_binary(std::ostream& out, const result_table& table);
+	friend void read_binary(std::istream& in, result_table& table);
+};
+
+void write_binary(std::ostream& out, const result_table& table);
+void read_binary(std::istream& in, result_table& table);
+
+template<typename V>
+void result_table::append(uint64_t col, V value) {
+	column& c = columns.at(col);
+	switch (c.info.type) {
+	case column_type::float32:
+		c.f32.push_back(float(value));
+		break;
+	case column_type::float64:
+		c.f64.push_back(double(value));
+		break;
+	case column_type::int32: {
+		// округлённое значение должно уместиться в int32 (NaN тоже отвергается)
+		double rounded = double(value);
+		if (!(rounded > -2147483648.5 && rounded < 2147483647.5))
+			throw std::out_of_range("column " + c.info.name);
+		c.i32.push_back(int32_t(llround(value)));
+		break;
+	}
+	}
+}
+
+template<typename T, typename A>
+void result_table::push_row(const Vector<T, A>& row) {
+	if (uint64_t(row.dimension()) != columns.size())
+		throw std::logic_error("push row");
+
+	for (uint64_t col = 0u; col < columns.size(); ++col)
+		append(col, row.at(col));
+}
+
+template<> inline column_view<float> result_table::column_as<float>(uint64_t col) const {
+	const column& c = columns.at(col);
+	if (c.info.type != column_type::float32)
+		throw std::logic_error("column type");
+	return { c.f32.data(), c.f32.size() };
+}
+
+template<> inline column_view<double> result_table::column_as<double>(uint64_t col) const {
+	const column& c = columns.at(col);
+	if (c.info.type != column_type::float64)
+		throw std::logic_error("column type");
+	return { c.f64.data(), c.f64.size() };
+}
+
+template<> inline column_view<int32_t> result_table::column_as<int32_t>(uint64_t col) const {
+	const column& c = columns.at(col);
+	if (c.info.type != column_type::int32)
+		throw std::logic_error("column type");
+	return { c.i32.data(), c.i32.size() };
+}
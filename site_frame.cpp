@@ -0,0 +1,132 @@
+#include "site_frame.hpp"
+#include "funcm.hpp"
+#include "profile.hpp"
+
+template<typename T>
+site_frame<T>::site_frame(T φ, T λ, T s_0, T Ω) : sin_φ(sin(φ)), cos_φ(cos(φ)), s_base(s_0 + λ), Ω(Ω), λ(λ) {};
+
+template<typename T>
+void site_frame<T>::set_site(T φ_, T λ_) {
+	sin_φ = sin(φ_);
+	cos_φ = cos(φ_);
+	s_base += λ_ - λ;
+	λ = λ_;
+	valid = false;
+}
+
+template<typename T>
+void site_frame<T>::set_orientation(const earth_orientation* eo, T t0) {
+	orientation = eo;
+	orientation_offset = eo ? T(t0 - T(eo->get_epoch().jd1) * 86400 - T(eo->get_epoch().jd2) * 86400) : T(0);
+	valid = false;
+}
+
+template<typename T>
+T site_frame<T>::clock_offset(T t) const {
+	return orientation ? T(orientation->tt_minus_utc(double(t + orientation_offset))) : T(0);
+}
+
+template<typename T>
+T site_frame<T>::angle(T t) const {
+	if (orientation)
+		return wrap_angle(T(orientation->sidereal_angle(double(t + orientation_offset))) + λ + angle_offset);
+	return wrap_angle(s_base + angle_offset + Ω * t);
+}
+
+template<typename T>
+site_rotation<T> site_frame<T>::at(T t) const {
+	T s = angle(t);
+	site_rotation<T> output{ cos(s), sin(s), false, {} };
+
+	if (orientation) {
+		double pn[9];
+		orientation->precession_nutation(double(t + orientation_offset), pn);
+		output.precessed = true;
+		for (int count = 0; count < 9; ++count)
+			output.pn[count] = pn[count];
+	}
+
+	return output;
+}
+
+template<typename T>
+site_rotation<T> site_frame<T>::advance(T t) {
+	// истинное звёздное время не линейно по t: каждый момент считается через таблицу узлов
+	if (orientation)
+		return at(t);
+
+	T dt = t - t_last;
+
+	if (!valid || since_sync >= resync_every || dt != dt_step) {
+		LR5_COUNT("site_frame/sync", 1u);
+
+		// шаг запоминается, если предыдущий момент был, - со следующего вызова работает рекуррентность
+		if (valid && dt != dt_step) {
+			dt_step = dt;
+			step = { cos(Ω * dt), sin(Ω * dt), false, {} };
+		}
+
+		current = at(t);
+		since_sync = 0u;
+	}
+	else {
+		current = {
+			current.cos_s * step.cos_s - current.sin_s * step.sin_s,
+			current.sin_s * step.cos_s + current.cos_s * step.sin_s,
+			false,
+			{},
+		};
+		++since_sync;
+	}
+
+	valid = true;
+	t_last = t;
+	return current;
+}
+
+template<typename T>
+void site_frame<T>::zenith(const site_rotation<T>& r, T* out) const noexcept {
+	out[0] = cos_φ * r.cos_s;
+	out[1] = cos_φ * r.sin_s;
+	out[2] = sin_φ;
+
+	// зенит задан на истинном экваторе даты: в J2000 - транспонированной матрицей N * P
+	if (r.precessed) {
+		T tod[3] = { out[0], out[1], out[2] };
+		for (int axis = 0; axis < 3; ++axis)
+			out[axis] = r.pn[axis] * tod[0] + r.pn[3 + axis] * tod[1] + r.pn[6 + axis] * tod[2];
+	}
+}
+
+template<typename T>
+void site_frame<T>::to_date(const site_rotation<T>& r, T* vec) const noexcept {
+	if (!r.precessed)
+		return;
+
+	T j2000[3] = { vec[0], vec[1], vec[2] };
+	for (int axis = 0; axis < 3; ++axis)
+		vec[axis] = r.pn[axis * 3] * j2000[0] + r.pn[axis * 3 + 1] * j2000[1] + r.pn[axis * 3 + 2] * j2000[2];
+}
+
+template<typename T>
+Vector<T> site_frame<T>::zenith(const site_rotation<T>& r) const {
+	Vector<T> output(3);
+	zenith(r, &output.at(0));
+	return output;
+}
+
+template<typename T>
+Vector<T> site_frame<T>::to_local(const site_rotation<T>& r, const Vector<T>& vec) const {
+	Vector<T> output(3);
+	T v[3] = { vec.at(0), vec.at(1), vec.at(2) };
+	to_date(r, v);
+
+	output.at(0) = -sin_φ * r.cos_s * v[0] - sin_φ * r.sin_s * v[1] + cos_φ * v[2];
+	output.at(1) = -cos_φ * r.cos_s * v[0] - cos_φ * r.sin_s * v[1] - sin_φ * v[2];
+	output.at(2) = -r.sin_s * v[0] + r.cos_s * v[1];
+
+	return output;
+}
+
+template class site_frame<double>;
+template class site_frame<long double>;
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <math.h>
+#include "vector.hpp"
+#include "earth_orientation.hpp"
+
+// поворот Земли на звёздный угол s: cos s, sin s;
+// с учётом прецессии-нутации - ещё и матрица N * P (от экватора J2000 к истинному экватору даты)
+template<typename T>
+struct site_rotation {
+	T cos_s;
+	T sin_s;
+	bool precessed = false;
+	T pn[9] = {};
+};
+
+// место наблюдения на вращающейся Земле: члены, зависящие от широты, считаются один раз,
+// звёздный угол s = s_0 + λ + Ω t при равномерной выдаче продвигается поворотом на Ω dt
+// (рекуррентность комплексного умножения) и раз в resync_every шагов пересчитывается заново
+template<typename T>
+class site_frame {
+private:
+	T sin_φ = 0;
+	T cos_φ = 1;
+	T s_base = 0;
+	T Ω = 0;
+
+	// состояние рекуррентности
+	bool valid = false;
+	T t_last = 0;
+	site_rotation<T> current{ 1, 0, false, {} };
+	T dt_step = 0;
+	site_rotation<T> step{ 1, 0, false, {} };
+	uint64_t since_sync = 0u;
+
+	// звёздный угол по истинному звёздному времени: t + orientation_offset - секунды TT от эпохи orientation
+	const earth_orientation* orientation = nullptr;
+	T orientation_offset = 0;
+	T λ = 0;
+	T angle_offset = 0;
+public:
+	static constexpr uint64_t resync_every = 1024u;
+
+	site_frame() noexcept {};
+	site_frame(T φ, T λ, T s_0, T Ω);
+
+	// звёздный угол в момент t (с от t0), приведённый к (-π, π]
+	T angle(T t) const;
+	// прямой расчёт, состояние рекуррентности не меняется
+	site_rotation<T> at(T t) const;
+	// следующий момент равномерной выдачи: при том же шаге, что и в прошлый раз, - без sin/cos
+	site_rotation<T> advance(T t);
+	// рекуррентность - как у нового объекта: повторный проход выдачи совпадает с первым до бита
+	void reset() noexcept { valid = false; t_last = 0; current = { 1, 0, false, {} }; dt_step = 0; step = { 1, 0, false, {} }; since_sync = 0u; };
+	// поправка к звёздному углу (ошибка ориентации Земли), в обоих режимах
+	void set_angle_offset(T ds) noexcept { angle_offset = ds; valid = false; };
+	// другое место наблюдения, ориентация и поправка угла сохраняются
+	void set_site(T φ_, T λ_);
+
+	// s = GAST + λ и прецессия-нутация вместо s_0 + λ + Ω t; t0 - начало отсчёта t, с от JD 0 (TT)
+	void set_orientation(const earth_orientation* eo, T t0);
+	const earth_orientation* get_orientation() const noexcept { return orientation; };
+	// TT - UTC в момент t, с (0 без ориентации): модельное время - TT, местное - UTC
+	T clock_offset(T t) const;
+
+	T get_sin_φ() const noexcept { return sin_φ; };
+	T get_cos_φ() const noexcept { return cos_φ; };
+
+	// единичный вектор на зенит в инерциальной системе
+	void zenith(const site_rotation<T>& r, T* out) const noexcept;
+	Vector<T> zenith(const site_rotation<T>& r) const;
+	// вектор из системы J2000 в систему истинного экватора даты (на месте)
+	void to_date(const site_rotation<T>& r, T* vec) const noexcept;
+	// перевод вектора в систему места: (на север вниз по меридиану, к надиру, на восток) - как в sundial_model
+	Vector<T> to_local(const site_rotation<T>& r, const Vector<T>& vec) const;
+};
@@ -0,0 +1,121 @@
+#include "trajectory_cache.hpp"
+#include "fnv_hash.hpp"
+
+template<typename T>
+trajectory_cache<T>::trajectory_cache(const std::string& directory) : directory(directory) {};
+
+template<typename T>
+std::string trajectory_cache<T>::make_key(const model_t<T>& system, T eps) {
+	uint64_t hash = fnv_offset;
+
+	std::string id = system.rhs_id();
+	std::string scalar = scalar_traits<T>::name;
+	hash_bytes(hash, id.data(), id.size());
+	hash_bytes(hash, scalar.data(), scalar.size());
+
+	Vector<T> x0 = system.get_init();
+	for (uint64_t count = 0u; count < x0.dimension(); ++count)
+		hash_value(hash, x0.at(count));
+	hash_value(hash, system.get_t0());
+	hash_value(hash, eps);
+
+	return id + "_" + hash_hex(hash);
+}
+
+template<typename T>
+std::string trajectory_cache<T>::file_name(const std::string& key) const {
+	return directory + "/" + key + ".traj";
+}
+
+template<typename T>
+typename trajectory_cache<T>::entry& trajectory_cache<T>::get(const std::string& key) {
+	auto found = entries.find(key);
+	if (found != entries.end())
+		return found->second;
+
+	entry& value = entries[key];
+	if (directory.empty())
+		return value;
+
+	std::ifstream f(file_name(key), std::ios::binary);
+	if (!f.is_open())
+		return value;
+
+	char magic[4]{};
+	uint32_t version{};
+	uint64_t size{};
+
+	f.read(magic, 4);
+	read_binary(f, version);
+	if (std::string(magic, 4) != "LR5T" || version != 2)
+		throw std::logic_error("trajectory cache");
+
+	read_binary(f, size);
+	value.segments.resize(size);
+	for (auto& segment : value.segments)
+		read_binary(f, segment);
+	read_binary(f, value.tail);
+
+	return value;
+}
+
+template<typename T>
+void trajectory_cache<T>::save(const std::string& key) const {
+	if (directory.empty())
+		return;
+
+	auto found = entries.find(key);
+	if (found == entries.end())
+		throw std::logic_error("trajectory cache");
+
+	std::string temp_name = file_name(key) + ".tmp";
+	std::ofstream f(temp_name, std::ios::binary | std::ios::trunc);
+
+	if (!f.is_open())
+		throw std::logic_error("trajectory cache");
+
+	f.write("LR5T", 4);
+	write_binary(f, uint32_t(2));
+	write_binary(f, uint64_t(found->second.segments.size()));
+	for (const auto& segment : found->second.segments)
+		write_binary(f, segment);
+	write_binary(f, found->second.tail);
+
+	f.close();
+
+	if (std::rename(temp_name.c_str(), file_name(key).c_str()) != 0)
+		throw std::logic_error("trajectory cache");
+}
+
+template<typename T>
+void trajectory_cache<T>::clear() noexcept {
+	entries.clear();
+}
+
+template<typename T>
+run_stage incremental_runner<T>::run(model_t<T>& system) {
+	LR5_SCOPE("incremental/run");
+	std::string key = trajectory_cache<T>::make_key(system, eps);
+
+	if (last == &system && key == last_key && system.observer_revision() == last_revision && system.get_t1() == last_t1)
+		return run_stage::none;
+
+	typename trajectory_cache<T>::entry& cached = cache.get(key);
+	uint64_t known = cached.segments.size();
+
+	system.reset_observer();
+	integrator.set_cache(&cache);
+	integrator.run(system);
+
+	last = &system;
+	last_key = key;
+	last_revision = system.observer_revision();
+	last_t1 = system.get_t1();
+
+	return known == 0u || cached.segments.size() != known ? run_stage::trajectory : run_stage::observer;
+}
+
+template class trajectory_cache<double>;
+template class trajectory_cache<long double>;
+template class incremental_runner<double>;
+template class incremental_runner<long double>;
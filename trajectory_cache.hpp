@@ -0,0 +1,59 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include "integrator.hpp"
+
+// траектории, уже проинтегрированные для данных (правая часть, x0, t0, eps)
+template<typename T>
+class trajectory_cache {
+public:
+	struct entry {
+		std::vector<dense_segment<T>> segments;
+		step_state<T> tail;
+	};
+private:
+	std::string directory;
+	std::map<std::string, entry> entries;
+
+	std::string file_name(const std::string& key) const;
+public:
+	trajectory_cache(const std::string& directory = "");
+
+	static std::string make_key(const model_t<T>& system, T eps);
+
+	entry& get(const std::string& key);
+	void save(const std::string& key) const;
+	void clear() noexcept;
+};
+
+enum class run_stage : uint8_t {
+	none,       // выдача действительна
+	observer,   // выдача пересчитана по сохранённой траектории
+	trajectory, // траектория проинтегрирована (целиком или продолжена до нового t1)
+};
+
+// повторный расчёт по стадиям: траектория зависит от правой части, x0, t0 и eps (ключ кэша) и t1,
+// наблюдатель - от остального (observer_revision модели). При смене только параметров наблюдателя
+// модель заново проходит сохранённую плотную выдачу без интегрирования
+template<typename T>
+class incremental_runner {
+private:
+	trajectory_cache<T> cache;
+	DormandPrinceIntegrator<T> integrator;
+	T eps;
+
+	// последний расчёт: модель, ключ траектории, версия наблюдателя, t1
+	const model_t<T>* last = nullptr;
+	std::string last_key;
+	uint64_t last_revision = 0u;
+	T last_t1 = 0;
+public:
+	// directory - каталог кэша траекторий ("" - только в памяти)
+	incremental_runner(T eps, const std::string& directory = "") : cache(directory), integrator(eps), eps(eps) {};
+
+	run_stage run(model_t<T>& system);
+	// следующий run пересчитает выдачу, даже если параметры не менялись
+	void invalidate() noexcept { last = nullptr; };
+	trajectory_cache<T>& get_cache() noexcept { return cache; };
+};
@@ -0,0 +1,93 @@
+#include "unscented.hpp"
+
+template<typename T>
+T unscented_transform<T>::weight_mean(uint64_t n, uint64_t index) const noexcept {
+	T l = lambda(n);
+	return index == 0u ? l / (n + l) : 1 / (2 * (n + l));
+}
+
+template<typename T>
+T unscented_transform<T>::weight_covariance(uint64_t n, uint64_t index) const noexcept {
+	T l = lambda(n);
+	return index == 0u ? l / (n + l) + (1 - alpha * alpha + beta) : 1 / (2 * (n + l));
+}
+
+template<typename T>
+std::vector<Vector<T>> unscented_transform<T>::sigma_points(const gaussian_state<T>& state) const {
+	const uint64_t n = state.mean.dimension();
+
+	if (state.covariance.rows() != n || state.covariance.cols() != n)
+		throw std::logic_error("unscented covariance");
+
+	Matrix<T> L = state.covariance.cholesky();
+	L *= sqrt(n + lambda(n));
+
+	std::vector<Vector<T>> output(2 * n + 1, state.mean);
+	for (uint64_t col = 0u; col < n; ++col)
+		for (uint64_t row = col; row < n; ++row) {
+			output[1 + col].at(row) += L.at(row, col);
+			output[1 + n + col].at(row) -= L.at(row, col);
+		}
+
+	return output;
+}
+
+template<typename T>
+gaussian_state<T> unscented_transform<T>::recover(const std::vector<Vector<T>>& points) const {
+	const uint64_t n = (points.size() - 1u) / 2u;
+
+	if (points.size() != 2 * n + 1 || n == 0u)
+		throw std::logic_error("unscented points");
+
+	const Vector<T>& center = points.front();
+	std::vector<Vector<T>> deviation(points.size(), Vector<T>(n));
+	for (uint64_t index = 1u; index < points.size(); ++index)
+		for (uint64_t row = 0u; row < n; ++row)
+			deviation[index].at(row) = points[index].at(row) - center.at(row);
+
+	// сдвиг среднего относительно центральной точки
+	Vector<T> shift(n);
+	for (uint64_t index = 1u; index < points.size(); ++index)
+		shift.axpy(weight_mean(n, index), deviation[index]);
+
+	gaussian_state<T> output{ center + shift, Matrix<T>(n, n) };
+
+	for (uint64_t index = 0u; index < points.size(); ++index) {
+		T weight = weight_covariance(n, index);
+		Vector<T> d = deviation[index] - shift;
+
+		for (uint64_t row = 0u; row < n; ++row)
+			for (uint64_t col = 0u; col <= row; ++col)
+				output.covariance.at(row, col) += weight * d.at(row) * d.at(col);
+	}
+
+	for (uint64_t row = 0u; row < n; ++row)
+		for (uint64_t col = 0u; col < row; ++col)
+			output.covariance.at(col, row) = output.covariance.at(row, col);
+
+	return output;
+}
+
+template<typename T>
+gaussian_state<T> unscented_propagator<T>::propagate(const gaussian_state<T>& initial, const factory& make) const {
+	LR5_SCOPE("unscented/propagate");
+	std::vector<Vector<T>> points = transform.sigma_points(initial);
+
+	std::unique_ptr<batch_model<T>> model = make(points);
+	if (!model || model->lanes() != points.size())
+		throw std::logic_error("unscented model");
+
+	batch_integrator<T> integrator(eps);
+	integrator.set_shared_step(shared_step);
+	integrator.run(*model);
+
+	for (uint64_t lane = 0u; lane < points.size(); ++lane)
+		points[lane] = integrator.state(lane);
+
+	return transform.recover(points);
+}
+
+template class unscented_transform<double>;
+template class unscented_transform<long double>;
+template class unscented_propagator<double>;
+template class unscented_propagator<long double>;
@@ -0,0 +1,51 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include "batch_integrator.hpp"
+
+// среднее и ковариация состояния
+template<typename T>
+struct gaussian_state {
+	Vector<T> mean;
+	Matrix<T> covariance;
+};
+
+// масштабированное сигма-точечное преобразование (Julier; Wan, van der Merwe):
+// 2n + 1 точек x0 = m, x(±i) = m ± sqrt(n + λ) * L(:, i), где P = L L^T, λ = α^2 (n + κ) - n
+template<typename T>
+class unscented_transform {
+protected:
+	T alpha, beta, kappa;
+public:
+	unscented_transform(T alpha = 1, T beta = 2, T kappa = 0) : alpha(alpha), beta(beta), kappa(kappa) {};
+
+	T lambda(uint64_t n) const noexcept { return alpha * alpha * (n + kappa) - n; };
+	// веса среднего и ковариации: для центральной точки (index = 0) и для остальных
+	T weight_mean(uint64_t n, uint64_t index) const noexcept;
+	T weight_covariance(uint64_t n, uint64_t index) const noexcept;
+
+	std::vector<Vector<T>> sigma_points(const gaussian_state<T>& state) const;
+	// среднее и ковариация по образам сигма-точек; отклонения берутся от центральной точки,
+	// иначе на |x| ~ 1e11 м сумма с большими весами теряет разряды
+	gaussian_state<T> recover(const std::vector<Vector<T>>& points) const;
+};
+
+// режим распространения неопределённости: сигма-точки интегрируются одним пакетом (полосы batch_integrator)
+template<typename T>
+class unscented_propagator {
+public:
+	// пакетная модель по начальным условиям полос, например earth_move_batch на [t0, t1]
+	using factory = std::function<std::unique_ptr<batch_model<T>>(const std::vector<Vector<T>>& init)>;
+protected:
+	unscented_transform<T> transform;
+	T eps;
+	bool shared_step = true;
+public:
+	unscented_propagator(T eps, const unscented_transform<T>& transform = unscented_transform<T>()) : transform(transform), eps(eps) {};
+
+	// общий шаг по умолчанию: все сигма-точки проходят одну сетку времени
+	void set_shared_step(bool shared) noexcept { shared_step = shared; };
+
+	gaussian_state<T> propagate(const gaussian_state<T>& initial, const factory& make) const;
+};
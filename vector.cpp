@@ -1,24 +1,51 @@
+#include <type_traits>
 #include "vector.hpp"
 #include "quartenion.hpp"
 
-template<typename T>
-Quartenion Vector<T>::operator*(const Quartenion& quar) const {
-	Quartenion q(0, _data.at(0), _data.at(1), _data.at(2));
+// кватернионы хранятся в double: компоненты Vector<T> приводятся к double и обратно
+template<typename T, typename Alloc>
+static Vector<double> to_double(const Vector<T, Alloc>& vec) {
+	if constexpr (std::is_same<Vector<T, Alloc>, Vector<double>>::value)
+		return vec;
+	else {
+		Vector<double> output(vec.dimension());
+		for (int count = 0; count < vec.dimension(); ++count)
+			output.at(count) = double(vec.at(count));
+		return output;
+	}
+}
+
+template<typename T, typename Alloc>
+static Vector<T, Alloc> from_double(const Vector<double>& vec) {
+	if constexpr (std::is_same<Vector<T, Alloc>, Vector<double>>::value)
+		return vec;
+	else {
+		Vector<T, Alloc> output(vec.dimension());
+		for (int count = 0; count < vec.dimension(); ++count)
+			output.at(count) = T(vec.at(count));
+		return output;
+	}
+}
+
+template<typename T, typename Alloc>
+Quartenion Vector<T, Alloc>::operator*(const Quartenion& quar) const {
+	Quartenion q(0, double(_data.at(0)), double(_data.at(1)), double(_data.at(2)));
 	return q * quar;
 }
 
-template<typename T>
-Vector<T> Vector<T>::rotate(double phi, const Vector<T>& axis) const {
-	Quartenion quat(phi, axis);
-	Quartenion output = quat * (*this) * (quat.conj());
-	return output.vec();
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::rotate(double phi, const Vector<T, Alloc>& axis) const {
+	Quartenion quat(phi, to_double(axis));
+	Quartenion output = quat * to_double(*this) * (quat.conj());
+	return from_double<T, Alloc>(output.vec());
 }
 
-template<typename T>
-Vector<T> Vector<T>::rotateByQuartenion(const Quartenion& L) const{
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::rotateByQuartenion(const Quartenion& L) const{
 	Quartenion temp(L);
 	temp.normalization();
-	return (temp*(*this)*(!temp)).vec();
+	return from_double<T, Alloc>((temp*to_double(*this)*(!temp)).vec());
 };
 
-template class Vector<double>;
\ No newline at end of file
+template class Vector<double>;
+template class Vector<long double>;
\ No newline at end of file
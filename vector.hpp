@@ -1,21 +1,28 @@
 #pragma once 
 
 #include <vector>
+#include <utility>
+#include "arena.hpp"
 #include "matrix.hpp"
 #include "quartenion.hpp"
 
 class Quartenion;
 
-template<typename T>
+template<typename T, typename Alloc>
 class Vector {
 protected:
-	std::vector<T> _data;
+	std::vector<T, Alloc> _data;
 public:
 	Vector();
 	Vector(uint64_t size);
 	Vector(const std::vector<T>& vec);
-	Vector(const Vector<T>& vec);
-	Vector<T>& operator=(const Vector<T>& rval);
+	Vector(const Vector<T, Alloc>& vec);
+	// забирает память источника вместе с его аллокатором
+	Vector(Vector<T, Alloc>&& vec) noexcept;
+	Vector<T, Alloc>& operator=(const Vector<T, Alloc>& rval);
+	// без переноса аллокатора перемещение между разными аренами копирует элементы:
+	// так результат шага покидает арену, не ссылаясь на неё после reset()
+	Vector<T, Alloc>& operator=(Vector<T, Alloc>&& rval) noexcept(std::allocator_traits<Alloc>::is_always_equal::value);
 	~Vector();
 	
 	T& operator[](int64_t index);
@@ -28,132 +35,201 @@ public:
 	T at(const int index) const;
 
 	int dimension() const noexcept;
+	// непрерывный массив элементов для ядер, работающих с указателями
+	T* data() noexcept;
+	const T* data() const noexcept;
 	void resize(uint64_t size);
-	long double cross(const Vector<T>& vec) const;
-	long double length() const noexcept;
-	Vector<T> vec_cross(const Vector<T>& vec) const;
-	Vector<T> rotateByRodrigFormula(double phi, Vector<T> axis) const;
-	Vector<T> rotate(double phi, const Vector<T>& axis) const;
-	Vector<T> rotateByQuartenion(const Quartenion& L) const;
-	Vector<T>& normalization();
-	Vector<T>& push_back(const T& element) noexcept;
-	Vector<T>& concat(const Vector<T>& vec) noexcept;
-	Vector<T>& add(const Vector<T>& vec);
-	template<typename S> Vector<T>& scale_mult(const S& s) noexcept;
-	template<typename S> Vector<T>& mat_mult(const Matrix<S>& mat) noexcept;
-
-	long double operator*(const Vector<T>& vec) const;
-	Vector<T> operator-() const;
-	Vector<T> operator+(const Vector<T>& vec) const;
-	Vector<T> operator-(const Vector<T>& vec) const;
-	Vector<T> operator*(double s) const;
-	Vector<T> operator*(const Matrix<T>& mat) const;
-	Vector<T> operator^(const Vector<T>& vec) const;
+	void reserve(uint64_t size);
+	T cross(const Vector<T, Alloc>& vec) const;
+	T length() const noexcept;
+	Vector<T, Alloc> vec_cross(const Vector<T, Alloc>& vec) const;
+	Vector<T, Alloc> rotateByRodrigFormula(double phi, Vector<T, Alloc> axis) const;
+	Vector<T, Alloc> rotate(double phi, const Vector<T, Alloc>& axis) const;
+	Vector<T, Alloc> rotateByQuartenion(const Quartenion& L) const;
+	Vector<T, Alloc>& normalization();
+	Vector<T, Alloc>& push_back(const T& element) noexcept;
+	Vector<T, Alloc>& concat(const Vector<T, Alloc>& vec) noexcept;
+	Vector<T, Alloc>& add(const Vector<T, Alloc>& vec);
+	Vector<T, Alloc>& axpy(T s, const Vector<T, Alloc>& vec);
+	template<typename S> Vector<T, Alloc>& scale_mult(const S& s) noexcept;
+	template<typename S, typename A> Vector<T, Alloc>& mat_mult(const Matrix<S, A>& mat) noexcept;
+
+	T operator*(const Vector<T, Alloc>& vec) const;
+	Vector<T, Alloc>& operator+=(const Vector<T, Alloc>& vec);
+	Vector<T, Alloc>& operator-=(const Vector<T, Alloc>& vec);
+	Vector<T, Alloc>& operator*=(T s) noexcept;
+
+	// перегрузки для временных объектов переиспользуют их память
+	Vector<T, Alloc> operator-() const &;
+	Vector<T, Alloc> operator-() &&;
+	Vector<T, Alloc> operator+(const Vector<T, Alloc>& vec) const &;
+	Vector<T, Alloc> operator+(const Vector<T, Alloc>& vec) &&;
+	Vector<T, Alloc> operator-(const Vector<T, Alloc>& vec) const &;
+	Vector<T, Alloc> operator-(const Vector<T, Alloc>& vec) &&;
+	Vector<T, Alloc> operator*(T s) const &;
+	Vector<T, Alloc> operator*(T s) &&;
+	Vector<T, Alloc> operator*(const Matrix<T, Alloc>& mat) const;
+	Vector<T, Alloc> operator^(const Vector<T, Alloc>& vec) const;
 	Quartenion operator*(const Quartenion& quar) const;
-	template<typename S> Vector<T> operator/(const S& arg);
+	template<typename S> Vector<T, Alloc> operator/(const S& arg);
 
-	template<typename S> friend bool operator>(const Vector<S>& lval, const Vector<S>& rval);
-	template<typename S> friend bool operator<(const Vector<S>& lval, const Vector<S>& rval);
-	template<typename S> friend bool operator==(const Vector<S>& lval, const Vector<S>& rval);
-	template<typename S> friend Vector<S> operator*(double s, const Vector<S>& vec);
-	template<typename S> friend std::ostream& operator<<(std::ostream& out, const Vector<S>& vec);
-	template<typename S> friend std::ofstream& operator<<(std::ofstream& out, const Vector<S>& vec);
+	template<typename S, typename A> friend bool operator>(const Vector<S, A>& lval, const Vector<S, A>& rval);
+	template<typename S, typename A> friend bool operator<(const Vector<S, A>& lval, const Vector<S, A>& rval);
+	template<typename S, typename A> friend bool operator==(const Vector<S, A>& lval, const Vector<S, A>& rval);
+	template<typename S, typename U, typename A> friend Vector<U, A> operator*(const S& s, const Vector<U, A>& vec);
+	template<typename S, typename A> friend std::ostream& operator<<(std::ostream& out, const Vector<S, A>& vec);
+	template<typename S, typename A> friend std::ofstream& operator<<(std::ofstream& out, const Vector<S, A>& vec);
 };
 
-template<typename T>
-Vector<T>::Vector(const std::vector<T>& vec) : _data(vec) {};
+template<typename T, typename Alloc>
+Vector<T, Alloc>::Vector(const std::vector<T>& vec) : _data(vec.begin(), vec.end()) {};
 
-template<typename T>
-Vector<T>::Vector() {
+template<typename T, typename Alloc>
+Vector<T, Alloc>::Vector() {
 	_data.reserve(3);
 };
 
-template<typename T>
-Vector<T>::Vector(uint64_t size) {
-	_data = std::vector<T>(size, 0);
+template<typename T, typename Alloc>
+Vector<T, Alloc>::Vector(uint64_t size) {
+	_data.assign(size, 0);
 };
 
-template<typename T>
-Vector<T>::Vector(const Vector<T>& vec) {
-	_data = vec._data;
-};
+template<typename T, typename Alloc>
+Vector<T, Alloc>::Vector(const Vector<T, Alloc>& vec) : _data(vec._data) {};
+
+template<typename T, typename Alloc>
+Vector<T, Alloc>::Vector(Vector<T, Alloc>&& vec) noexcept : _data(std::move(vec._data)) {};
 
-template<typename T>
-Vector<T>& Vector<T>::operator=(const Vector<T>& rval) {
+template<typename T, typename Alloc>
+Vector<T, Alloc>& Vector<T, Alloc>::operator=(const Vector<T, Alloc>& rval) {
 	if (this != &rval)
 		this->_data = rval._data;
 	return *this;
 };
 
-template<typename T>
-void Vector<T>::resize(uint64_t size) {
+template<typename T, typename Alloc>
+Vector<T, Alloc>& Vector<T, Alloc>::operator=(Vector<T, Alloc>&& rval) noexcept(std::allocator_traits<Alloc>::is_always_equal::value) {
+	if (this != &rval)
+		this->_data = std::move(rval._data);
+	return *this;
+};
+
+template<typename T, typename Alloc>
+void Vector<T, Alloc>::resize(uint64_t size) {
 	_data.resize(size);
 };
 
-template<typename T>
-T& Vector<T>::operator[](int64_t index) {
+template<typename T, typename Alloc>
+void Vector<T, Alloc>::reserve(uint64_t size) {
+	_data.reserve(size);
+};
+
+template<typename T, typename Alloc>
+T& Vector<T, Alloc>::operator[](int64_t index) {
 	return this->at(index);
 };
 
-template<typename T>
-T Vector<T>::operator[](int64_t index) const {
+template<typename T, typename Alloc>
+T Vector<T, Alloc>::operator[](int64_t index) const {
 	return this->at(index);
 };
 
-template<typename T>
-T& Vector<T>::operator()(int64_t index) {
+template<typename T, typename Alloc>
+T& Vector<T, Alloc>::operator()(int64_t index) {
 	return this->at(index);
 };
 
-template<typename T>
-T Vector<T>::operator()(int64_t index) const {
+template<typename T, typename Alloc>
+T Vector<T, Alloc>::operator()(int64_t index) const {
 	return this->at(index);
 };
 
-template<typename T>
-Vector<T>::~Vector() {
+template<typename T, typename Alloc>
+Vector<T, Alloc>::~Vector() {
 	_data.clear();
 };
 
-template<typename T>
-Vector<T>& Vector<T>::normalization() {
+template<typename T, typename Alloc>
+Vector<T, Alloc>& Vector<T, Alloc>::normalization() {
 	for (auto& el : _data)
 		el /= length();
 	return *this;
 };
 
-template<typename T>
-Vector<T>& Vector<T>::push_back(const T& element) noexcept {
+template<typename T, typename Alloc>
+Vector<T, Alloc>& Vector<T, Alloc>::push_back(const T& element) noexcept {
 	_data.push_back(element);
 
 	return *this;
 };
 
-template<typename T>
-Vector<T>& Vector<T>::concat(const Vector<T>& vec) noexcept {
+template<typename T, typename Alloc>
+Vector<T, Alloc>& Vector<T, Alloc>::concat(const Vector<T, Alloc>& vec) noexcept {
 	for (const auto& el : vec._data)
 		_data.push_back(el);
 
 	return *this;
 };
 
-template<typename T>
-Vector<T>& Vector<T>::add(const Vector<T>& vec) {
+template<typename T, typename Alloc>
+Vector<T, Alloc>& Vector<T, Alloc>::add(const Vector<T, Alloc>& vec) {
 	if (this->dimension() != vec.dimension())
 		throw std::logic_error("Dimension vectors are other!");
 
-	for (uint64_t count = 0u; count < this->dimension(); ++count)
-		_data.at(count) += vec._data.at(count);
+	for (uint64_t count = 0u; count < _data.size(); ++count)
+		_data[count] += vec._data[count];
+
+	return *this;
+};
+
+// this += s * vec
+template<typename T, typename Alloc>
+Vector<T, Alloc>& Vector<T, Alloc>::axpy(T s, const Vector<T, Alloc>& vec) {
+	if (this->dimension() != vec.dimension())
+		throw std::logic_error("Dimension vectors are other!");
+
+	for (uint64_t count = 0u; count < _data.size(); ++count)
+		_data[count] += vec._data[count] * s;
+
+	return *this;
+};
+
+template<typename T, typename Alloc>
+Vector<T, Alloc>& Vector<T, Alloc>::operator+=(const Vector<T, Alloc>& vec) {
+	if (this->dimension() != vec.dimension())
+		throw std::logic_error("n+m");
+
+	for (uint64_t count = 0u; count < _data.size(); ++count)
+		_data[count] += vec._data[count];
+
+	return *this;
+};
+
+template<typename T, typename Alloc>
+Vector<T, Alloc>& Vector<T, Alloc>::operator-=(const Vector<T, Alloc>& vec) {
+	if (this->dimension() != vec.dimension())
+		throw std::logic_error("n-m");
+
+	for (uint64_t count = 0u; count < _data.size(); ++count)
+		_data[count] -= vec._data[count];
+
+	return *this;
+};
+
+template<typename T, typename Alloc>
+Vector<T, Alloc>& Vector<T, Alloc>::operator*=(T s) noexcept {
+	for (auto& el : _data)
+		el *= s;
 
 	return *this;
 };
 
-template<typename T>
-long double Vector<T>::cross(const Vector<T>& vec) const {
+template<typename T, typename Alloc>
+T Vector<T, Alloc>::cross(const Vector<T, Alloc>& vec) const {
 	if (this->dimension() != vec.dimension())
 		throw std::logic_error("Dimension vectors are other!");
 
-	long double sum{};
+	T sum{};
 
 	for (uint64_t count = 0u; count < _data.size(); ++count)
 		sum += _data.at(count) * vec._data.at(count);
@@ -161,29 +237,39 @@ long double Vector<T>::cross(const Vector<T>& vec) const {
 	return sum;
 };
 
-template<typename T>
-int Vector<T>::dimension() const noexcept {
+template<typename T, typename Alloc>
+int Vector<T, Alloc>::dimension() const noexcept {
 	return _data.size();
 };
 
-template<typename T>
-T& Vector<T>::at(const int index) {
+template<typename T, typename Alloc>
+T* Vector<T, Alloc>::data() noexcept {
+	return _data.data();
+};
+
+template<typename T, typename Alloc>
+const T* Vector<T, Alloc>::data() const noexcept {
+	return _data.data();
+};
+
+template<typename T, typename Alloc>
+T& Vector<T, Alloc>::at(const int index) {
 	if (index >= _data.size())
 		throw std::out_of_range("at vec");
 
 	return _data.at(index);
 };
 
-template<typename T>
-T Vector<T>::at(const int index) const {
+template<typename T, typename Alloc>
+T Vector<T, Alloc>::at(const int index) const {
 	if (index >= _data.size())
 		throw std::out_of_range("at vec");
 
 	return _data.at(index);
 };
 
-template<typename T>
-Vector<T> Vector<T>::vec_cross(const Vector<T>& vec) const {
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::vec_cross(const Vector<T, Alloc>& vec) const {
 	if (this->dimension() != 3 || vec.dimension() != 3)
 		throw std::logic_error("Vec cross vector dimension must be 3!");
 
@@ -191,22 +277,22 @@ Vector<T> Vector<T>::vec_cross(const Vector<T>& vec) const {
 	T c_2 = at(2) * vec.at(0) - at(0) * vec.at(2);
 	T c_3 = at(0) * vec.at(1) - at(1) * vec.at(0);
 
-	return Vector<T>{ {c_1, c_2, c_3}};
+	return Vector<T, Alloc>{ {c_1, c_2, c_3}};
 };
 
-template<typename T>
+template<typename T, typename Alloc>
 template<typename S>
-Vector<T>& Vector<T>::scale_mult(const S& s) noexcept {
+Vector<T, Alloc>& Vector<T, Alloc>::scale_mult(const S& s) noexcept {
 	for (uint64_t count = 0u; count < this->dimension(); ++count)
 		this->at(count) *= s;
 
 	return *this;
 };
 
-template<typename T>
-template<typename S>
-Vector<T>& Vector<T>::mat_mult(const Matrix<S>& mat) noexcept {
-	Vector<T> temp{ *this };
+template<typename T, typename Alloc>
+template<typename S, typename A>
+Vector<T, Alloc>& Vector<T, Alloc>::mat_mult(const Matrix<S, A>& mat) noexcept {
+	Vector<T, Alloc> temp{ *this };
 
 	for (uint64_t count = 0u; count < this->dimension(); ++count) {
 		this->at(count) = 0u;
@@ -218,9 +304,9 @@ Vector<T>& Vector<T>::mat_mult(const Matrix<S>& mat) noexcept {
 	return *this;
 };
 
-template<typename T>
-long double Vector<T>::length() const noexcept {
-	long double len{};
+template<typename T, typename Alloc>
+T Vector<T, Alloc>::length() const noexcept {
+	T len{};
 
 	for (const auto& el : _data)
 		len += el*el;
@@ -228,49 +314,66 @@ long double Vector<T>::length() const noexcept {
 	return sqrt(len);
 };
 
-template<typename T>
-Vector<T> Vector<T>::operator-() const {
-	Vector<T> temp{ *this };
-	for (uint64_t count = 0u; count < temp.dimension(); ++count)
-		temp.at(count) = -temp.at(count);
-	return Vector<T>(temp);
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::operator-() const & {
+	Vector<T, Alloc> temp{ *this };
+	return -std::move(temp);
 };
 
-template<typename T>
-Vector<T> Vector<T>::operator+(const Vector<T>& vec) const {
-	if (this->dimension() != vec.dimension())
-		throw std::logic_error("n+m");
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::operator-() && {
+	for (auto& el : _data)
+		el = -el;
+	return std::move(*this);
+};
 
-	Vector<T> temp{ *this };
-	for (uint64_t count = 0u; count < temp.dimension(); ++count)
-		temp.at(count) += vec.at(count);
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::operator+(const Vector<T, Alloc>& vec) const & {
+	Vector<T, Alloc> temp{ *this };
+	temp += vec;
+	return temp;
+};
 
-	return Vector<T>(temp);
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::operator+(const Vector<T, Alloc>& vec) && {
+	*this += vec;
+	return std::move(*this);
 };
 
-template<typename T>
-Vector<T> Vector<T>::operator-(const Vector<T>& vec) const {
-	return this->operator+(-vec);
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::operator-(const Vector<T, Alloc>& vec) const & {
+	Vector<T, Alloc> temp{ *this };
+	temp -= vec;
+	return temp;
 };
 
-template<typename T>
-long double Vector<T>::operator*(const Vector<T>& vec) const {
-	return this->cross(vec);
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::operator-(const Vector<T, Alloc>& vec) && {
+	*this -= vec;
+	return std::move(*this);
 };
 
-template<typename T>
-Vector<T> Vector<T>::operator*(double s) const {
-	Vector<T> temp{ *this };
+template<typename T, typename Alloc>
+T Vector<T, Alloc>::operator*(const Vector<T, Alloc>& vec) const {
+	return this->cross(vec);
+};
 
-	for (uint64_t count = 0u; count < temp.dimension(); ++count)
-		temp.at(count) *= s;
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::operator*(T s) const & {
+	Vector<T, Alloc> temp{ *this };
+	temp *= s;
+	return temp;
+};
 
-	return Vector<T>(temp);
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::operator*(T s) && {
+	*this *= s;
+	return std::move(*this);
 };
 
-template<typename T>
-Vector<T> Vector<T>::operator*(const Matrix<T>& mat) const {
-	Vector<T> temp{ *this };
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::operator*(const Matrix<T, Alloc>& mat) const {
+	Vector<T, Alloc> temp{ *this };
 
 	for (uint64_t count = 0u; count < this->dimension(); ++count) {
 		temp.at(count) = 0u;
@@ -279,34 +382,34 @@ Vector<T> Vector<T>::operator*(const Matrix<T>& mat) const {
 		}
 	}
 
-	return Vector<T>(temp);
+	return temp;
 };
 
-template<typename T>
-inline Vector<T> Vector<T>::operator^(const Vector<T>& vec) const {
+template<typename T, typename Alloc>
+inline Vector<T, Alloc> Vector<T, Alloc>::operator^(const Vector<T, Alloc>& vec) const {
 	return this->vec_cross(vec);
 }
 
-template<typename T>
-Vector<T> Vector<T>::rotateByRodrigFormula(double phi, Vector<T> axis) const {
+template<typename T, typename Alloc>
+Vector<T, Alloc> Vector<T, Alloc>::rotateByRodrigFormula(double phi, Vector<T, Alloc> axis) const {
 	axis.normalization();
-	Vector<T> output{ *this };
+	Vector<T, Alloc> output{ *this };
 	output = output * cos(phi) + (axis ^ output) * sin(phi) + axis * (axis * output) * (1 - cos(phi));
 	return output;
 }
 
-template<typename T>
+template<typename T, typename Alloc>
 template<typename S>
-Vector<T> Vector<T>::operator/(const S& arg) {
-	Vector<T> output{ *this };
+Vector<T, Alloc> Vector<T, Alloc>::operator/(const S& arg) {
+	Vector<T, Alloc> output{ *this };
 	for (auto& el : output._data)
 		el = el / arg;
 	return output;
 };
 
 
-template<typename S>
-inline std::ostream& operator<<(std::ostream& out, const Vector<S>& vec) {
+template<typename S, typename A>
+inline std::ostream& operator<<(std::ostream& out, const Vector<S, A>& vec) {
 	for (uint64_t count = 0u; count < vec.dimension(); ++count) {
 		if (count == vec.dimension() - 1u)
 			out << vec.at(count);
@@ -318,8 +421,8 @@ inline std::ostream& operator<<(std::ostream& out, const Vector<S>& vec) {
 	return out;
 };
 
-template<typename S>
-inline std::ofstream& operator<<(std::ofstream& out, const Vector<S>& vec) {
+template<typename S, typename A>
+inline std::ofstream& operator<<(std::ofstream& out, const Vector<S, A>& vec) {
 	for (uint64_t count = 0u; count < vec.dimension(); ++count) {
 		if (count == vec.dimension() - 1u)
 			out << vec.at(count);
@@ -331,18 +434,18 @@ inline std::ofstream& operator<<(std::ofstream& out, const Vector<S>& vec) {
 	return out;
 }
 
-template<typename S>
-inline bool operator>(const Vector<S>& lval, const Vector<S>& rval) {
+template<typename S, typename A>
+inline bool operator>(const Vector<S, A>& lval, const Vector<S, A>& rval) {
 	return lval.length() > rval.length();
 };
 
-template<typename S>
-inline bool operator<(const Vector<S>& lval, const Vector<S>& rval) {
+template<typename S, typename A>
+inline bool operator<(const Vector<S, A>& lval, const Vector<S, A>& rval) {
 	return lval.length() < rval.length();
 };
 
-template<typename S>
-inline bool operator==(const Vector<S>& lval, const Vector<S>& rval) {
+template<typename S, typename A>
+inline bool operator==(const Vector<S, A>& lval, const Vector<S, A>& rval) {
 	if (rval.dimension() != lval.dimension())
 		return false;
 
@@ -353,7 +456,12 @@ inline bool operator==(const Vector<S>& lval, const Vector<S>& rval) {
 	return true;
 }
 
-template<typename S>
-inline Vector<S> operator*(double s, const Vector<S>& vec) {
+template<typename S, typename U, typename A>
+inline Vector<U, A> operator*(const S& s, const Vector<U, A>& vec) {
 	return vec * s;
 }
+
+template<typename S, typename U, typename A, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+inline Vector<U, A> operator*(const S& s, Vector<U, A>&& vec) {
+	return std::move(vec) * s;
+}
@@ -0,0 +1,85 @@
+#include "worker_pool.hpp"
+
+worker_pool::worker_pool(uint64_t threads) {
+	for (uint64_t worker = 1u; worker < threads; ++worker)
+		workers.emplace_back(&worker_pool::loop, this);
+}
+
+worker_pool::~worker_pool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	start.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+void worker_pool::drain() {
+	for (uint64_t part = next.fetch_add(1u); part < parts; part = next.fetch_add(1u)) {
+		try {
+			call(context, part);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error)
+				error = std::current_exception();
+		}
+	}
+}
+
+void worker_pool::loop() {
+	uint64_t seen = 0u;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+		}
+
+		drain();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--active == 0u)
+			done.notify_one();
+	}
+}
+
+void worker_pool::dispatch(uint64_t count, call_t function, const void* data) {
+	if (workers.empty() || count <= 1u) {
+		for (uint64_t part = 0u; part < count; ++part)
+			function(data, part);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		call = function;
+		context = data;
+		parts = count;
+		next.store(0u, std::memory_order_relaxed);
+		error = nullptr;
+		active = workers.size();
+		++generation;
+	}
+	start.notify_all();
+
+	drain();
+
+	std::exception_ptr failure;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&] { return active == 0u; });
+		call = nullptr;
+		context = nullptr;
+		failure = error;
+		error = nullptr;
+	}
+
+	if (failure)
+		std::rethrow_exception(failure);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// постоянные потоки для коротких параллельных вызовов (правая часть на каждой стадии шага):
+// run раздаёт номера частей [0, parts) через общий счётчик, вызывающий поток работает наравне
+// с остальными и ждёт, пока все потоки закончат (барьер). Потоки создаются один раз в конструкторе.
+// run не реентерабелен: пул принадлежит одному владельцу и вызывается из одного потока
+class worker_pool {
+private:
+	using call_t = void (*)(const void* context, uint64_t part);
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable start, done;
+
+	call_t call = nullptr;
+	const void* context = nullptr;
+	uint64_t parts = 0u;
+	alignas(64) std::atomic<uint64_t> next{ 0u };
+
+	uint64_t generation = 0u; // номер вызова run, по нему потоки узнают о новой работе
+	uint64_t active = 0u;     // потоки, ещё не закончившие текущий вызов
+	bool stopping = false;
+	std::exception_ptr error;
+
+	void drain();
+	void loop();
+	void dispatch(uint64_t count, call_t function, const void* data);
+public:
+	// threads - всего потоков вместе с вызывающим
+	explicit worker_pool(uint64_t threads);
+	~worker_pool();
+
+	worker_pool(const worker_pool&) = delete;
+	worker_pool& operator=(const worker_pool&) = delete;
+
+	uint64_t size() const noexcept { return workers.size() + 1u; };
+
+	// job(part) для каждой части; первое исключение выбрасывается после барьера
+	template<typename F>
+	void run(uint64_t count, const F& job) {
+		dispatch(count, [](const void* data, uint64_t part) { (*static_cast<const F*>(data))(part); }, &job);
+	};
+};